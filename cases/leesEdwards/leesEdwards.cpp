@@ -40,7 +40,8 @@ int main (int argc, char * argv[]) {
     new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
 
   hemocell.lattice->toggleInternalStatistics(false);
-  LeesEdwardsBC<T, DESCRIPTOR> LEbc (*hemocell.lattice, param::shearrate_lbm, dt, &hemocell.LEcurrentDisplacement);
+  // Sheared across the z boundary along x, applied by hemocell.iterate()
+  LeesEdwardsBC LEbc (hemocell, param::shearrate_lbm, dt, 2, 0);
   LEbc.initialize();
 
   hemocell.lattice->initialize();
@@ -61,6 +62,7 @@ int main (int argc, char * argv[]) {
     for (plint itrt = 0; itrt < (*cfg)["parameters"]["warmup"].read<plint>(); ++itrt)
     {
       hemocell.lattice->collideAndStream();
+      LEbc.apply();
     }
   }
 
@@ -70,7 +72,6 @@ int main (int argc, char * argv[]) {
   while (hemocell.iter < tmax)
   {
     hemocell.iterate();
-    LEbc.updateLECurDisplacement(hemocell.iter);
 
     if (hemocell.iter % tmeas == 0) {
       hemocell.writeOutput();
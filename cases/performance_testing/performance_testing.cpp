@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "cellInfo.h"
 #include "fluidInfo.h"
 #include "particleInfo.h"
+#include "guoBodyForceDynamics.h"
 #include <fenv.h>
 #include "palabos3D.h"
 #include "palabos3D.hh"
@@ -50,13 +51,18 @@ int main(int argc, char *argv[]) {
   param::lbm_pipe_parameters((*cfg),nx);
   param::printParameters();
 
+  //Driving Force, applied by the collision together with the immersed boundary force
+  double rPipe = (*cfg)["domain"]["refDirN"].read<int>()/2.0;
+  double poiseuilleForce =  8 * param::nu_lbm * (param::u_lbm_max * 0.5) / rPipe / rPipe;
+
   hlog << "(unbounded) (Fluid) Initializing Palabos Fluid Field" << endl;
   hemocell.lattice = new MultiBlockLattice3D<double, DESCRIPTOR>(
             defaultMultiBlockPolicy3D().getMultiBlockManagement(nx, ny, nz, (*cfg)["domain"]["fluidEnvelope"].read<int>()),
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<double, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<double, DESCRIPTOR>(1.0/param::tau));
+            new GuoBodyForceBGKdynamics<double, DESCRIPTOR>(1.0/param::tau,
+              plb::Array<double, DESCRIPTOR<double>::d>(poiseuilleForce, poiseuilleForce, poiseuilleForce)));
 
   //hemocell.lattice = new MultiBlockLattice3D<double, DESCRIPTOR>(
   //nx+2, ny+2, nz+2, new BGKdynamics<double,DESCRIPTOR>(1.0/param::tau) );
@@ -69,16 +75,9 @@ int main(int argc, char *argv[]) {
 
   hlog << getMultiBlockInfo(*hemocell.lattice) << endl;
 
-  //Driving Force
-  hlog << "(PipeFlow) (Fluid) Setting up driving Force" << endl;
-  double rPipe = (*cfg)["domain"]["refDirN"].read<int>()/2.0;
-  double poiseuilleForce =  8 * param::nu_lbm * (param::u_lbm_max * 0.5) / rPipe / rPipe;
-  setExternalVector(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
-  DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-  plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, poiseuilleForce, poiseuilleForce));
-
-
   hemocell.lattice->initialize();
+  // The driving force is in the dynamics, the external force only holds the spread force
+  hemocell.enableSparseForceReset();
 
   //Adding all the cells
   hemocell.initializeCellfield();
@@ -125,12 +124,6 @@ int main(int argc, char *argv[]) {
   while (hemocell.iter < tmax ) {
     hemocell.iterate();
 
-    //Set driving force as required after each iteration
-    setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
-                DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-		      plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, poiseuilleForce, poiseuilleForce));
-
-
        if (hemocell.iter % tmeas == 0) {
       hlog << "(main) Stats. @ " <<  hemocell.iter << " (" << hemocell.iter * param::dt << " s):" << endl;
       hlog << "\t # of cells: " << CellInformationFunctionals::getTotalNumberOfCells(&hemocell);
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "cellInfo.h"
 #include "fluidInfo.h"
 #include "particleInfo.h"
+#include "guoTRTdynamics.h"
 #include <fenv.h>
 #include "palabos3D.h"
 #include "palabos3D.hh"
@@ -159,7 +160,7 @@ int main(int argc, char *argv[]) {
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<double, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<double, DESCRIPTOR>(1.0/param::tau));
+            createFluidDynamics(*cfg, 1.0/param::tau));
 
  // pcout << "(PipeFlow) (Fluid) Setting up boundaries in Palabos Fluid Field" << endl;
  // defineDynamics(*hemocell.lattice, *flagMatrix, (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
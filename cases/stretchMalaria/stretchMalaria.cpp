@@ -150,11 +150,8 @@ int main(int argc, char* argv[])
       hemocell.writeOutput();
 
       // Fill up the static info structure with desired data
-      CellInformationFunctionals::calculateCellVolume(&hemocell);
-      CellInformationFunctionals::calculateCellArea(&hemocell);
-      CellInformationFunctionals::calculateCellPosition(&hemocell);
-      CellInformationFunctionals::calculateCellStretch(&hemocell);
-      CellInformationFunctionals::calculateCellBoundingBox(&hemocell);
+      CellInformationFunctionals::calculateCellInformation(&hemocell, CELLINFO_VOLUME | CELLINFO_AREA |
+          CELLINFO_SHAPE | CELLINFO_BOUNDING_BOX);
 
       double volume = (CellInformationFunctionals::info_per_cell[0].volume)/pow(1e-6/param::dx,3);
       double surface = (CellInformationFunctionals::info_per_cell[0].area)/pow(1e-6/param::dx,2);
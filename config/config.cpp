@@ -191,6 +191,24 @@ void loadGlobalConfigValues(hemo::Config * cfg) {
    }
 #endif
   } catch(std::invalid_argument & e) {}
+  try {
+    std::string cellInfoOutput = (*cfg)["parameters"]["cellInfoOutput"].read<std::string>();
+    global.cellInfoCSV = (cellInfoOutput == "csv" || cellInfoOutput == "both");
+    global.cellInfoHDF5 = (cellInfoOutput == "hdf5" || cellInfoOutput == "both");
+    if (!global.cellInfoCSV && !global.cellInfoHDF5 && cellInfoOutput != "none") {
+      hlog << "(Hemocell) (Config) Error cellInfoOutput should be one of csv, hdf5, both or none, not " << cellInfoOutput << std::endl;
+      exit(1);
+    }
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.cellInfoWriters = (*cfg)["parameters"]["cellInfoWriters"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.exactCellStretch = (*cfg)["parameters"]["exactCellStretch"].read<bool>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.fusedCollideAndStream = (*cfg)["parameters"]["fusedCollideAndStream"].read<bool>();
+  } catch(std::invalid_argument & e) {}
 }
 
 }
@@ -85,6 +85,15 @@ struct ConfigValues {
   bool enableSolidifyMechanics = false;
 
   bool enableInteriorViscosity = false;
+
+  // Per-cell information written by HemoCell::writeOutput()
+  bool cellInfoCSV = true;
+  bool cellInfoHDF5 = false;
+  int cellInfoWriters = 1;
+  // Compare all vertex pairs for CellInformation::stretch instead of the O(V) search
+  bool exactCellStretch = false;
+  // Collide and stream the fluid with the HemoCell kernel for Guo forced BGK nodes
+  bool fusedCollideAndStream = false;
   
   std::string checkpointDirectory = "./checkpoint/";
 
@@ -29,12 +29,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mpi.h>
 
 #include "readPositionsBloodCells.h"
+#include "fusedCollideAndStream.h"
+#include "leesEdwardsBC.h"
 #include "hemoCellFunctional.h"
 #include "hemoCellParticle.h"
 #include "hemoCellField.h"
 #include "ParticleHdf5IO.h"
 #include "FluidHdf5IO.h"
 #include "writeCellInfoCSV.h"
+#include "writeCellInfoHDF5.h"
 #include "genericFunctions.h"
 
 #include "palabos3D.h"
@@ -276,7 +279,12 @@ void HemoCell::writeOutput() {
   if (global.enableCEPACfield) {
     writeCEPACField_HDF5(*cellfields,param::dx,param::dt,iter);
   }
-  writeCellInfo_CSV(*this);
+  if (global.cellInfoCSV) {
+    writeCellInfo_CSV(*this);
+  }
+  if (global.cellInfoHDF5) {
+    writeCellInfo_HDF5(*this);
+  }
   global.statistics.getCurrent().stop();
 
   // Repoint surfaceparticle forces for speed
@@ -302,6 +310,7 @@ void HemoCell::iterate() {
     sanityCheck();
     cellfields->calculateCommunicationStructure();
   }
+  std::chrono::high_resolution_clock::time_point iterateStart = std::chrono::high_resolution_clock::now();
   global.statistics.getCurrent()["iterate"].start();
   // ### 1 ### Particle Force to Fluid
   if(repulsionEnabled && iter % cellfields->repulsionTimescale == 0) {
@@ -310,13 +319,24 @@ void HemoCell::iterate() {
   if(boundaryRepulsionEnabled && iter % cellfields->boundaryRepulsionTimescale == 0) {
     cellfields->applyBoundaryRepulsionForce();
   }
-  cellfields->spreadParticleForce();
+  // The fused collision takes the spread force from the particle fields, so it never enters the lattice
+  const bool fused = global.fusedCollideAndStream && fusedCollideAndStreamApplies(*lattice);
+  cellfields->spreadParticleForce(fused);
 
   // #### 2 #### LBM
   global.statistics.getCurrent()["collideAndStream"].start();
-  lattice->collideAndStream();
+  if (fused) {
+    fusedCollideAndStream(*lattice, global.enableInteriorViscosity ? InteriorViscosityHelper::get(*cellfields).getTauField() : 0,
+                          cellfields->immersedParticles, !sparseForceReset);
+  } else {
+    lattice->collideAndStream();
+  }
   global.statistics.getCurrent().stop();
 
+  if (leesEdwards) {
+    leesEdwards->apply();
+  }
+
   if (global.enableCEPACfield)
     {
       global.statistics.getCurrent()["CEPACcollideAndStream"].start();
@@ -324,9 +344,18 @@ void HemoCell::iterate() {
       global.statistics.getCurrent().stop();
   }
 
+  // With sparseForceReset the spread force is only cleared after the
+  // interpolation, so the velocity keeps the half force correction of the
+  // immersed boundary force. With the fused collision it stays in the force
+  // tiles until the next spreading and the lattice has nothing to clear
   if(iter %cellfields->particleVelocityUpdateTimescale == 0) {
     // #### 3 #### IBM interpolation
     cellfields->interpolateFluidVelocity();
+  }
+  if (sparseForceReset && !fused) {
+    cellfields->resetSpreadForce();
+  }
+  if(iter %cellfields->particleVelocityUpdateTimescale == 0) {
     // ### 4 ### sync the particles
     cellfields->syncEnvelopes();
   }
@@ -364,15 +393,21 @@ void HemoCell::iterate() {
     cellfields->deleteNonLocalParticles(3);
   }
 
-  global.statistics.getCurrent()["setExternalVector"].start();
-  // Reset Forces on the lattice, TODO do own efficient implementation
-  setExternalVector(*lattice, (*lattice).getBoundingBox(),
-          DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-          plb::Array<T, DESCRIPTOR<T>::d>(0.0, 0.0, 0.0));
-  global.statistics.getCurrent().stop();
+  // Reset Forces on the lattice, unless only the kernel nodes were cleared above
+  if (!sparseForceReset) {
+    global.statistics.getCurrent()["setExternalVector"].start();
+    setExternalVector(*lattice, (*lattice).getBoundingBox(),
+            DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+            plb::Array<T, DESCRIPTOR<T>::d>(0.0, 0.0, 0.0));
+    global.statistics.getCurrent().stop();
+  }
   
   iter++;
   global.statistics.getCurrent().stop();
+
+  if (loadBalancer->autoBalanceEnabled()) {
+    loadBalancer->monitorStep(std::chrono::high_resolution_clock::now() - iterateStart);
+  }
 }
 
 T HemoCell::calculateFractionalLoadImbalance() {
@@ -385,6 +420,11 @@ void HemoCell::setMaterialTimeScaleSeparation(string name, unsigned int separati
   (*cellfields)[name]->timescale = separation;
 }
 
+void HemoCell::setMaterialSubsteps(string name, unsigned int substeps){
+  hlog << "(HemoCell) (Substeps) Sub-cycling the membrane of " << name << " " << substeps << " times per fluid step" << endl;
+  (*cellfields)[name]->substeps = substeps ? substeps : 1;
+}
+
 void HemoCell::setParticleVelocityUpdateTimeScaleSeparation(unsigned int separation) {
   hlog << "(HemoCell) (Timescale separation) Setting update separation of all particles to " << separation << " timesteps" << endl;
   hlogfile << "(HemoCell) WARNING time-scale separation can introduce numerical error! " << endl;
@@ -409,6 +449,11 @@ void HemoCell::setInteriorViscosityTimeScaleSeperation(unsigned int separation,
   cellfields->interiorViscosityEntireGridTimescale = separation_entire_grid;
 }
 
+void HemoCell::setInteriorViscosityRefreshDisplacement(T displacement){
+  hlog << "(HemoCell) (Interior Viscosity) Refreshing only cells that moved more than " << displacement << " lattice units" << endl;
+  cellfields->interiorViscosityRefreshDisplacement = displacement;
+}
+
 void HemoCell::setInitialMinimumDistanceFromSolid(string name, T distance) {
   hlog << "(HemoCell) (Set Distance) Setting minimum distance from solid to " << distance << " micrometer for " << name << endl; 
   if (loadParticlesIsCalled) {
@@ -426,12 +471,12 @@ void HemoCell::setRepulsion(T repulsionConstant, T repulsionCutoff) {
 }
 
 void HemoCell::enableBoundaryParticles(T boundaryRepulsionConstant, T boundaryRepulsionCutoff, unsigned int timestep) {
-  cellfields->populateBoundaryParticles();
   hlog << "(HemoCell) (Repulsion) Setting boundary repulsion constant to " << boundaryRepulsionConstant << ". boundary repulsionCutoff to" << boundaryRepulsionCutoff << " µm" << endl;
   hlogfile << "(HemoCell) (Repulsion) Enabling boundary repulsion" << endl;
   cellfields->boundaryRepulsionConstant = boundaryRepulsionConstant;
   cellfields->boundaryRepulsionCutoff = boundaryRepulsionCutoff*(1e-6/param::dx);
   cellfields->boundaryRepulsionTimescale = timestep;
+  cellfields->populateBoundaryParticles();
   boundaryRepulsionEnabled = true;
 }
 
@@ -460,13 +505,34 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
 
     }
     catch (const std::invalid_argument& e) {
-      hlog << "(HemoCell) Using default domain management." << endl;
+      plint sfcBlocksPerProcess = 0;
+      try {
+        sfcBlocksPerProcess = (*cfg)["domain"]["sfcBlocksPerProcess"].read<plint>();
+      } catch (const std::invalid_argument& e) {}
+
+      if (sfcBlocksPerProcess > 0) {
+        // Split the given (possibly sparse) management into finer blocks and distribute them along a space filling curve
+        SpaceFillingCurve curve = SpaceFillingCurve::Hilbert;
+        try {
+          curve = spaceFillingCurveFromString((*cfg)["domain"]["partitioner"].read<string>());
+        } catch (const std::invalid_argument& e) {}
+        hlog << "(HemoCell) Using space filling curve domain management with " << sfcBlocksPerProcess << " atomic blocks per process." << endl;
+        domain_lattice_management = createSfcManagement3D(management, sfcBlocksPerProcess, curve);
+
+        lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(*domain_lattice_management,
+              defaultMultiBlockPolicy3D().getBlockCommunicator(),
+              defaultMultiBlockPolicy3D().getCombinedStatistics(),
+              defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
+              new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+      } else {
+        hlog << "(HemoCell) Using default domain management." << endl;
  
-      lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(management,
-            defaultMultiBlockPolicy3D().getBlockCommunicator(),
-            defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+        lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(management,
+              defaultMultiBlockPolicy3D().getBlockCommunicator(),
+              defaultMultiBlockPolicy3D().getCombinedStatistics(),
+              defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
+              new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+      }
     }
 
     domain_lattice = lattice;
@@ -570,12 +636,14 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
   }
 }
 
-#ifdef HEMO_PARMETIS
 void HemoCell::doLoadBalance() {
 	pcout << "(HemoCell) (LoadBalancer) Balancing Atomic Block over mpi processes" << endl;
   loadBalancer->doLoadBalance();
 }
-#endif
+
+void HemoCell::setAutoLoadBalance(unsigned int checkEvery, T minimumImbalance, unsigned int horizon) {
+  loadBalancer->enableAutoBalance(checkEvery, minimumImbalance, horizon);
+}
 
 void HemoCell::doRestructure(bool checkpoint_avail) {
   hlog << "(HemoCell) (LoadBalancer) Restructuring Atomic Blocks on processors" << endl;
@@ -624,6 +692,10 @@ void HemoCell::sanityCheck() {
       hlog << "(HemoCell) Error, Velocity timescale separation cannot divide all material timescale separations, exiting ..." <<endl;
       exit(1);
     }
+    if ((*cellfields)[i]->substeps > 1 && (*cellfields)[i]->timescale != 1) {
+      hlog << "(HemoCell) Error, " << (*cellfields)[i]->name << " is sub-cycled, its material timescale separation must be 1, exiting ..." <<endl;
+      exit(1);
+    }
   }
   
   // Cellfields Sanity
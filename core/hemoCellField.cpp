@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "readPositionsBloodCells.h"
 #include "meshMetrics.h"
 #include "meshGeneratingFunctions.h"
+#include "scanlineVoxelizer.h"
 
 #include <climits>
 
@@ -46,6 +47,17 @@ HemoCellField::HemoCellField(HemoCellFields& cellFields_, string & name_, unsign
   string materialXML = name + ".xml";
   materialCfg = new Config(materialXML.c_str());
 
+  // Solidification thresholds, cached since they are tested for every particle near a binding site
+  try {
+    const T distanceThreshold = (*materialCfg)["MaterialModel"]["distanceThreshold"].read<T>();
+    solidifyShearThreshold = (*materialCfg)["MaterialModel"]["shearThreshold"].read<T>();
+    solidifyDistanceThreshold = distanceThreshold;
+  } catch (std::invalid_argument & e) {
+    if (global.enableSolidifyMechanics) {
+      hlog << "(HemoCell) (AddCellType) Error: solidification is enabled but " << materialXML << " does not set both distanceThreshold and shearThreshold, cells of type " << name << " will never solidify" << endl;
+    }
+  }
+
   T aspectRatio = 0.3;
   if (constructType == ELLIPSOID_FROM_SPHERE) {
     aspectRatio = (*materialCfg)["MaterialModel"]["aspectRatio"].read<T>();
@@ -114,9 +126,47 @@ HemoCellField::HemoCellField(HemoCellFields& cellFields_, string & name_, unsign
 #endif
      }
    } catch (std::invalid_argument & e) {}
+   try {
+     const string kernel = materialCfg["MaterialModel"]["kernel"].read<string>();
+     plint kernelWidth = 2;
+     if (kernel == "phi2") {
+       kernelMethod = interpolationCoefficientsPhi2;
+     } else if (kernel == "phi3") {
+       kernelMethod = interpolationCoefficientsPhi3;
+       kernelWidth = 3;
+     } else if (kernel == "phi4") {
+       kernelMethod = interpolationCoefficientsPhi4;
+       kernelWidth = 4;
+     } else if (kernel == "phi4c") {
+       kernelMethod = interpolationCoefficientsPhi4c;
+       kernelWidth = 4;
+     } else {
+       hlog << "(HemoCell) (AddCellType) (" << name << ") Unknown kernel " << kernel << ", choose one of phi2, phi3, phi4 or phi4c" << endl;
+       exit(1);
+     }
+     // A particle spreads at most half of the kernel width over the edge of its block
+     const plint envelopeWidth = cellFields.fluidEnvelopeSize;
+     if ((kernelWidth + 1)/2 > envelopeWidth) {
+       hlog << "(HemoCell) (AddCellType) (" << name << ") The " << kernel << " kernel spans " << kernelWidth << " nodes and needs a fluid envelope of " << (kernelWidth + 1)/2 << " nodes, which is more than the " << envelopeWidth << " nodes the fluid lattice was created with, exiting ..." << endl;
+       exit(1);
+     }
+     hlog << "(HemoCell) (AddCellType) (" << name << ") Using the " << kernel << " immersed boundary kernel" << endl;
+   } catch (std::invalid_argument & e) {}
+   try {
+     substeps = materialCfg["MaterialModel"]["substeps"].read<unsigned int>();
+     if (substeps < 1) {
+       substeps = 1;
+     }
+     if (substeps > 1) {
+       hlog << "(HemoCell) (AddCellType) (" << name << ") Sub-cycling the membrane " << substeps << " times per fluid step" << endl;
+     }
+   } catch (std::invalid_argument & e) {}
  } catch (std::invalid_argument & e) {}
 }
 HemoCellField::~HemoCellField() {
+  if (voxelizer) {
+    delete voxelizer;
+  }
   if (innerViscosityDynamics) {
     delete innerViscosityDynamics;
   }
@@ -136,6 +186,12 @@ HemoCellField::~HemoCellField() {
     delete materialCfg;
   }
 }
+ScanlineVoxelizer & HemoCellField::getVoxelizer() {
+  if (!voxelizer) {
+    voxelizer = new ScanlineVoxelizer(triangle_list);
+  }
+  return *voxelizer;
+}
 void HemoCellField::setOutputVariables(const vector<int> & outputs) { desiredOutputVariables = outputs;
          std::vector<int>::iterator it = std::find(desiredOutputVariables.begin(), desiredOutputVariables.end(),OUTPUT_TRIANGLES);
          if (it != desiredOutputVariables.end()) {
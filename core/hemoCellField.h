@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
 class HemoCellField;
+class ScanlineVoxelizer;
 }
 #include "config.h"
 #include "constant_defaults.h"
@@ -61,6 +62,8 @@ class HemoCellField{
   T volumeFractionOfLspPerNode = 0;
   T restingCellVolume = 0;
   unsigned int timescale = 1;
+  ///Membrane sub-steps per fluid step, the mechanics of stiff cells are sub-cycled in advanceParticles()
+  unsigned int substeps = 1;
   unsigned int minimumDistanceFromSolid = 0;
   bool outputTriangles = false;
   vector<hemo::Array<plint,3>> triangle_list;
@@ -78,9 +81,16 @@ class HemoCellField{
   hemo::Array<T,6> getOriginalBoundingBox();
   plb::MeshMetrics<T> * meshmetric = 0;
   bool doSolidifyMechanics = false;
+  ///From the material xml (distanceThreshold, shearThreshold), a negative distance means this celltype never solidifies
+  T solidifyDistanceThreshold = -1.;
+  T solidifyShearThreshold = 0.;
   bool doInteriorViscosity = false;
   T interiorViscosityTau = 1.0;
   plb::Dynamics<T,DESCRIPTOR> * innerViscosityDynamics = 0;
+  ///Inner node finder for the topology of this celltype, shared by all blocks, created on first use
+  ScanlineVoxelizer & getVoxelizer();
+private:
+  ScanlineVoxelizer * voxelizer = 0;
 };
 }
 
@@ -40,6 +40,7 @@ HemoCellFields::HemoCellFields( MultiBlockLattice3D<T, DESCRIPTOR> & lattice_, u
   lattice(&lattice_), hemocell(hemocell_)
 {   
   envelopeSize=particleEnvelopeWidth;
+  fluidEnvelopeSize=hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth();
   hlog << "(Hemocell) (HemoCellFields) (Init) particle envelope: " << particleEnvelopeWidth << " [lu]" << std::endl;
   if (hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth() < 2) {
     hlog << "(Hemocell) (ERROR) fluid envelope is less than 2, this will cause incorrect forces over the block boundaries" <<endl;
@@ -514,8 +515,9 @@ void HemoCellFields::advanceParticles() {
 void HemoCellFields::HemoSpreadParticleForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
     dynamic_cast<HemoCellParticleField*>(blocks[0])->spreadParticleForce(domain);
 }
-void HemoCellFields::spreadParticleForce() {
+void HemoCellFields::spreadParticleForce(bool inTiles) {
   global.statistics.getCurrent()["spreadParticleForce"].start();
+  spreadForceInTiles = inTiles;
 
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(immersedParticles);
@@ -524,6 +526,19 @@ void HemoCellFields::spreadParticleForce() {
   global.statistics.getCurrent().stop();
 }
 
+void HemoCellFields::HemoResetSpreadForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
+    dynamic_cast<HemoCellParticleField*>(blocks[0])->resetSpreadForce(domain);
+}
+void HemoCellFields::resetSpreadForce() {
+  global.statistics.getCurrent()["resetSpreadForce"].start();
+
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(immersedParticles);
+  applyProcessingFunctional(new HemoResetSpreadForce(),immersedParticles->getBoundingBox(),wrapper);
+
+  global.statistics.getCurrent().stop();
+}
+
 void HemoCellFields::HemoApplyConstitutiveModel::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
     dynamic_cast<HemoCellParticleField*>(blocks[0])->applyConstitutiveModel(forced);
 }
@@ -712,6 +727,7 @@ HemoCellFields::HemoFindInternalParticleGridPoints *  HemoCellFields::HemoFindIn
 HemoCellFields::HemoSeperateForceVectors * HemoCellFields::HemoSeperateForceVectors::clone() const { return new HemoCellFields::HemoSeperateForceVectors(*this);}
 HemoCellFields::HemoUnifyForceVectors *    HemoCellFields::HemoUnifyForceVectors::clone() const    { return new HemoCellFields::HemoUnifyForceVectors(*this);}
 HemoCellFields::HemoSpreadParticleForce *  HemoCellFields::HemoSpreadParticleForce::clone() const { return new HemoCellFields::HemoSpreadParticleForce(*this);}
+HemoCellFields::HemoResetSpreadForce *  HemoCellFields::HemoResetSpreadForce::clone() const { return new HemoCellFields::HemoResetSpreadForce(*this);}
 HemoCellFields::HemoInterpolateFluidVelocity * HemoCellFields::HemoInterpolateFluidVelocity::clone() const { return new HemoCellFields::HemoInterpolateFluidVelocity(*this);}
 HemoCellFields::HemoAdvanceParticles *     HemoCellFields::HemoAdvanceParticles::clone() const { return new HemoCellFields::HemoAdvanceParticles(*this);}
 HemoCellFields::HemoApplyConstitutiveModel * HemoCellFields::HemoApplyConstitutiveModel::clone() const { return new HemoCellFields::HemoApplyConstitutiveModel(*this);}
@@ -111,8 +111,11 @@ public:
   ///Interpolate the velocity of the fluid to the individual particles
   void interpolateFluidVelocity();
   
-  ///Spread the force of all particles over the fluid in this iteration
-  void spreadParticleForce();
+  ///Spread the force of all particles over the fluid in this iteration, into the IbmForceTiles of the particle fields when inTiles is set
+  void spreadParticleForce(bool inTiles = false);
+
+  ///Clear the force spread by spreadParticleForce() from the kernel nodes of the particles
+  void resetSpreadForce();
   
   /// Separate the force vectors of particles so it becomes clear what the vector for each separate force is
   void separate_force_vectors();
@@ -171,6 +174,10 @@ public:
   vector<HemoCellField *> cellFields;
   ///The envelopeSize for the particles
   pluint envelopeSize;
+  ///The envelope the fluid atomic blocks are allocated with, before HemoCell::initializeCellfield() resets it to 1
+  pluint fluidEnvelopeSize;
+  ///Whether the last spreadParticleForce() accumulated in the IbmForceTiles of the particle fields instead of in the lattice
+  bool spreadForceInTiles = false;
   /// palabos field storing the particles
   plb::MultiParticleField3D<HemoCellParticleField> * immersedParticles = 0;
   /// seperate preinlet and domain pointers whenever necessary
@@ -200,6 +207,8 @@ public:
   
   pluint interiorViscosityTimescale = 1;
   pluint interiorViscosityEntireGridTimescale = 1;
+  /// Only refresh the interior of cells that moved further than this (lattice units), 0 refreshes all cells
+  T interiorViscosityRefreshDisplacement = 0.;
   
   ///Limit of cycles in a direction (xyz)
   int periodicity_limit[3] = {100};
@@ -241,6 +250,10 @@ public:
    void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
    HemoSpreadParticleForce * clone() const;
   }; 
+  class HemoResetSpreadForce: public HemoCellFunctional {
+   void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
+   HemoResetSpreadForce * clone() const;
+  };
   class HemoFindInternalParticleGridPoints: public HemoCellFunctional {
    void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
    HemoFindInternalParticleGridPoints * clone() const;
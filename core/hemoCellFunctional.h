@@ -78,10 +78,93 @@ public:
         }
         
     }
+    //Every process receives the values of all processes
     static void gather(std::map<int,GatherType> & gatherValues) {
+        std::vector<unsigned char> sendbuffer = serialize(gatherValues);
+        int sendsize = sendbuffer.size();
+        
+        std::vector<int> sendcounts(plb::global::mpi().getSize());
+        MPI_Allgather(&sendsize,sizeof(int),MPI_BYTE,&sendcounts[0],sizeof(int),MPI_BYTE,MPI_COMM_WORLD);
+              
+        std::vector<int> displacements;
+        std::vector<unsigned char> receivebuffer(displace(sendcounts,displacements));
+        
+        MPI_Allgatherv(&sendbuffer[0],sendsize,MPI_BYTE,&receivebuffer[0],&sendcounts[0],&displacements[0],MPI_BYTE,MPI_COMM_WORLD);
+        deserialize(receivebuffer,displacements,gatherValues);
+    }
+
+    //Only the root process receives the values of all processes (e.g. for
+    //writing output), the map of the other processes is left untouched
+    static void gatherToRoot(std::map<int,GatherType> & gatherValues, int root = 0) {
+        std::vector<unsigned char> sendbuffer = serialize(gatherValues);
+        int sendsize = sendbuffer.size();
+        bool isRoot = plb::global::mpi().getRank() == root;
+
+        std::vector<int> sendcounts(isRoot ? plb::global::mpi().getSize() : 1);
+        MPI_Gather(&sendsize,1,MPI_INT,&sendcounts[0],1,MPI_INT,root,MPI_COMM_WORLD);
+
+        std::vector<int> displacements(1,0);
+        std::vector<unsigned char> receivebuffer(1);
+        if (isRoot) {
+          receivebuffer.resize(displace(sendcounts,displacements));
+        }
+
+        MPI_Gatherv(&sendbuffer[0],sendsize,MPI_BYTE,&receivebuffer[0],&sendcounts[0],&displacements[0],MPI_BYTE,root,MPI_COMM_WORLD);
+        if (isRoot) {
+          deserialize(receivebuffer,displacements,gatherValues);
+        }
+    }
+
+    //Reduce all values into one, available on every process. Instead of
+    //sending every entry only one value per process is communicated.
+    //GatherType must provide a static GatherType combine(GatherType const &, GatherType const &),
+    //for which a value-initialized GatherType is the neutral element
+    static GatherType reduce(std::map<int,GatherType> const & gatherValues) {
+        GatherType local = combineLocal(gatherValues);
+        GatherType result = GatherType();
+        MPI_Allreduce(&local,&result,1,reduceType(),reduceOperation(),MPI_COMM_WORLD);
+        return result;
+    }
+
+    //Handle for a reduction in flight, must stay in place until wait() or a
+    //successful test() returned
+    class PendingReduction {
+      friend class HemoCellGatheringFunctional<GatherType>;
+      MPI_Request request = MPI_REQUEST_NULL;
+      GatherType local = GatherType();
+      GatherType result = GatherType();
+    public:
+      PendingReduction() {}
+      PendingReduction(PendingReduction const &) = delete;
+      PendingReduction & operator=(PendingReduction const &) = delete;
+      ~PendingReduction() { wait(); }
+      bool test() {
+        int done = 1;
+        if (request != MPI_REQUEST_NULL) {
+          MPI_Test(&request,&done,MPI_STATUS_IGNORE);
+        }
+        return done;
+      }
+      GatherType const & wait() {
+        if (request != MPI_REQUEST_NULL) {
+          MPI_Wait(&request,MPI_STATUS_IGNORE);
+        }
+        return result;
+      }
+    };
+
+    //Non-blocking version of reduce(), the result is available from pending.wait()
+    static void ireduce(std::map<int,GatherType> const & gatherValues, PendingReduction & pending) {
+        pending.wait();
+        pending.local = combineLocal(gatherValues);
+        pending.result = GatherType();
+        MPI_Iallreduce(&pending.local,&pending.result,1,reduceType(),reduceOperation(),MPI_COMM_WORLD,&pending.request);
+    }
+
+private:
+    static std::vector<unsigned char> serialize(std::map<int,GatherType> const & gatherValues) {
         int be = 0;
-        int sendsize = sizeof(int) + sizeof(IDandGatherType)*gatherValues.size();
-        std::vector<unsigned char> sendbuffer(sendsize);
+        std::vector<unsigned char> sendbuffer(sizeof(int) + sizeof(IDandGatherType)*gatherValues.size());
 
         byteint local_number;
         local_number.i = gatherValues.size();
@@ -96,24 +179,26 @@ public:
             *((IDandGatherType*)&sendbuffer[be]) = bg;
             be+=sizeof(IDandGatherType);
         }
-        
-        std::vector<int> sendcounts(plb::global::mpi().getSize());
-        MPI_Allgather(&sendsize,sizeof(int),MPI_BYTE,&sendcounts[0],sizeof(int),MPI_BYTE,MPI_COMM_WORLD);
-              
+        return sendbuffer;
+    }
+
+    //Fill the displacements from the counts, returns the total size
+    static int displace(std::vector<int> const & counts, std::vector<int> & displacements) {
         int receivesize = 0;
-        std::vector<int> displacements(1,0);
-        for (int & size : sendcounts) {
+        displacements.assign(1,0);
+        for (int size : counts) {
           receivesize += size;
           displacements.push_back(displacements.back() + size);
         }
         displacements.pop_back();
-        std::vector<unsigned char> receivebuffer(receivesize);        
-        
-        MPI_Allgatherv(&sendbuffer[0],sendsize,MPI_BYTE,&receivebuffer[0],&sendcounts[0],&displacements[0],MPI_BYTE,MPI_COMM_WORLD);
-        be = 0;
-        
-        for (int j = 0 ; j < plb::global::mpi().getSize() ; j++) {
-            be = displacements[j];
+        return receivesize;
+    }
+
+    static void deserialize(std::vector<unsigned char> const & receivebuffer, std::vector<int> const & displacements,
+                            std::map<int,GatherType> & gatherValues) {
+        byteint local_number;
+        for (unsigned int j = 0 ; j < displacements.size() ; j++) {
+            int be = displacements[j];
             for (unsigned int i = 0; i < sizeof(int) ; i++) {
                 local_number.b[i] = receivebuffer[be];
                 be++;
@@ -125,9 +210,42 @@ public:
                 gatherValues[bg.ID] = bg.g;
             }
         }
-        
     }
-        
+
+    static GatherType combineLocal(std::map<int,GatherType> const & gatherValues) {
+        GatherType local = GatherType();
+        for (auto const & entry : gatherValues) {
+            local = GatherType::combine(local,entry.second);
+        }
+        return local;
+    }
+
+    static void combineValues(void * in, void * inout, int * len, MPI_Datatype *) {
+        GatherType * a = (GatherType *)in;
+        GatherType * b = (GatherType *)inout;
+        for (int i = 0 ; i < *len ; i++) {
+            b[i] = GatherType::combine(a[i],b[i]);
+        }
+    }
+
+    //Created on first use and kept for the lifetime of the program
+    static MPI_Datatype reduceType() {
+        static MPI_Datatype type = MPI_DATATYPE_NULL;
+        if (type == MPI_DATATYPE_NULL) {
+            MPI_Type_contiguous(sizeof(GatherType),MPI_BYTE,&type);
+            MPI_Type_commit(&type);
+        }
+        return type;
+    }
+    static MPI_Op reduceOperation() {
+        static MPI_Op op = MPI_OP_NULL;
+        if (op == MPI_OP_NULL) {
+            MPI_Op_create(&combineValues,1,&op);
+        }
+        return op;
+    }
+
+public:
     //This map should be set in the processingGenericBlocks function and is local to the mpi processor;
     std::map<int,GatherType> & gatherValues; 
 };
@@ -30,6 +30,7 @@ namespace hemo {
 #include "core/cell.hh"
 
 #include <cstdint> 
+#include <limits>
 
 #ifndef PARTICLE_ID
 #define PARTICLE_ID 0
@@ -39,6 +40,8 @@ namespace hemo {
 
 class HemoCellParticle {
 public:
+  /// Marks the previous velocity of a particle that has not been advanced yet
+  static constexpr T noPreviousVelocity = std::numeric_limits<T>::max();
 
   //VARIABLES
   //Store variables in struct for fast serialization
@@ -67,7 +70,6 @@ public:
   hemo::Array<T,3> force_total;
   plint tag;
   #ifdef INTERIOR_VISCOSITY
-  hemo::Array<T,3> normalDirection;
   //Is vector, optimize with hemo::Array possible
   std::vector<hemo::Array<plint, 3>> kernelCoordinates;
   #endif
@@ -92,7 +94,6 @@ public:
     kernelLocations = copy.kernelLocations;
     kernelWeights = copy.kernelWeights;
     #ifdef INTERIOR_VISCOSITY
-    normalDirection = copy.normalDirection;
     kernelCoordinates = copy.kernelCoordinates;
     #endif
     
@@ -108,6 +109,9 @@ public:
   
   HemoCellParticle (hemo::Array<T,3> position_, plint cellId_, plint vertexId_,pluint celltype_) {
     sv.v = {0.,0.,0.};
+#if HEMOCELL_MATERIAL_INTEGRATION == 2
+    sv.vPrevious = {noPreviousVelocity,noPreviousVelocity,noPreviousVelocity};
+#endif
     sv.position = position_;
     sv.force = {0.,0.,0.};
     sv.force_repulsion = {0.,0.,0.};
@@ -119,9 +123,6 @@ public:
     sv.solidify = false;
 #endif
     force_total = {0.,0.,0.};
-#ifdef INTERIOR_VISCOSITY
-    normalDirection = {0.,0.,0.};
-#endif
     tag = -1;
     
     if (vertexId_ > UINT16_MAX) {
@@ -141,7 +142,6 @@ public:
     kernelLocations = copy.kernelLocations;
     kernelWeights = copy.kernelWeights;
     #ifdef INTERIOR_VISCOSITY
-    normalDirection = copy.normalDirection;
     kernelCoordinates = copy.kernelCoordinates;
     #endif
     
@@ -184,20 +184,29 @@ public:
       force_inner_link = &sv.force;
     }
 
-    /// Implements Euler integration with velocity alone.
+    /// Integrates the position over one fluid step with the interpolated velocity.
     void advance() {
+        advance(sv.v, 1.);
+    }
+
+    /// Integrates the position over a fraction of a fluid step with velocity v,
+    /// sub-cycled cell types advance with a corrected velocity per sub-step.
+    void advance(const hemo::Array<T,3> & v, const T fraction) {
 
         /* scheme:
          *  1: Euler 
-         *  2: Adams-Bashforth
+         *  2: Adams-Bashforth, the first step of a new particle uses its
+         *     current velocity as the previous one (an Euler step)
          */
         #if HEMOCELL_MATERIAL_INTEGRATION == 1
-              sv.position += sv.v;
+              sv.position += v*fraction;
 
         #elif HEMOCELL_MATERIAL_INTEGRATION == 2
-              hemo::Array<T,3> dxyz = (1.5*v - 0.5*vPrevious);
-              position +=  dxyz;
-              vPrevious = v;  // Store velocity
+              if (sv.vPrevious[0] == noPreviousVelocity) {
+                sv.vPrevious = v;
+              }
+              sv.position += (1.5*v - 0.5*sv.vPrevious)*fraction;
+              sv.vPrevious = v;  // Store velocity
         #endif
         //v = {0.0,0.0,0.0};
     }
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hemoCellParticleDataTransfer.h"
 #include "hemoCellParticleField.h"
 #include "hemocell.h"
+#include "leesEdwardsBC.h"
 
 namespace hemo
 {
@@ -149,6 +150,9 @@ void HemoCellParticleDataTransfer::receive(Box3D domain, std::vector<NoInitChar>
 
   int offset = getOffset(absoluteOffset);
   hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
+  if (particleField->cellFields->hemocell.leesEdwards) {
+    realAbsoluteOffset += particleField->cellFields->hemocell.leesEdwards->particleShift(absoluteOffset);
+  }
   unsigned int posInBuffer = 0;
   unsigned int size = buffer.size();
   HemoCellParticle::serializeValues_t *newParticle;
@@ -280,6 +284,9 @@ void HemoCellParticleDataTransfer::receive(char *buffer, unsigned int size, modi
   {
     int offset = getOffset(absoluteOffset);
     hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
+    if (particleField->cellFields->hemocell.leesEdwards) {
+      realAbsoluteOffset += particleField->cellFields->hemocell.leesEdwards->particleShift(absoluteOffset);
+    }
     unsigned int posInBuffer = 0;
 
     HemoCellParticle::serializeValues_t *newParticle;
@@ -322,6 +329,9 @@ void HemoCellParticleDataTransfer::receive(Box3D const &domain, char *buffer, un
   {
     int offset = getOffset(absoluteOffset);
     hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
+    if (particleField->cellFields->hemocell.leesEdwards) {
+      realAbsoluteOffset += particleField->cellFields->hemocell.leesEdwards->particleShift(absoluteOffset);
+    }
     unsigned int posInBuffer = 0;
 
     HemoCellParticle::serializeValues_t *newParticle;
@@ -426,14 +436,8 @@ void HemoCellParticleDataTransfer::attribute(
     //fromParticleField.findParticles(fromDomain, particles);
     int offset = getOffset(absoluteOffset);
     hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
-    plint nZ = this->particleField->cellFields->hemocell.lattice->getNz();
-    if (this->particleField->cellFields->hemocell.leesEdwardsBC) {
-      if (absoluteOffset.z == -nZ) {
-        realAbsoluteOffset[0] += *this->particleField->cellFields->hemocell.LEcurrentDisplacement;
-      }
-      if (absoluteOffset.z == nZ) {
-        realAbsoluteOffset[0] -= *this->particleField->cellFields->hemocell.LEcurrentDisplacement;
-      }
+    if (particleField->cellFields->hemocell.leesEdwards) {
+      realAbsoluteOffset += particleField->cellFields->hemocell.leesEdwards->particleShift(absoluteOffset);
     }
     //Calling addParticle on self can invalidate particles pointer array on realloc from vector
     //Do for every local communication to accomodate overcoupling particle field in the future.
@@ -24,14 +24,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "hemoCellParticleField.h"
 #include "hemocell.h"
-#include "octree.h"
+#include "scanlineVoxelizer.h"
 #include "mollerTrumbore.h"
 #include "bindingField.h"
 #include "interiorViscosity.h"
-#pragma GCC diagnostic push 
-#pragma GCC diagnostic ignored "-Wint-in-bool-context"
-#include <Eigen3/Eigenvalues>
-#pragma GCC diagnostic pop
+#include "geometryUtils.h"
+#include "wallDistanceField.h"
+#include <algorithm>
+#include <iterator>
 
 namespace hemo { 
 /* *************** class HemoParticleField3D ********************** */
@@ -72,13 +72,21 @@ HemoCellParticleField::~HemoCellParticleField()
     delete[] particle_grid_size;
     particle_grid_size = 0;
   }
+  if (nearBindingSite) {
+    delete nearBindingSite;
+    nearBindingSite = 0;
+  }
+  if (trescaField) {
+    delete trescaField;
+    trescaField = 0;
+  }
+  if (wallDistance) {
+    delete wallDistance;
+    wallDistance = 0;
+  }
   
   // Sanitize for MultiBlockLattice destructor (releasememory). It can't handle releasing non-background dynamics that are not singular
   if (global.enableInteriorViscosity) {
-    for (const Dot3D & internalPoint : internalPoints ) {
-      atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
-      atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&atomicLattice->getBackgroundDynamics());
-    }
     InteriorViscosityHelper::get(*cellFields).empty(*this);
   }
 }
@@ -127,6 +135,7 @@ void HemoCellParticleField::update_ppt() {
 }
 void HemoCellParticleField::update_ppc() {
   _particles_per_cell.clear();
+  _vertices_per_cell.clear();
   
   for (unsigned int i = 0 ; i <  particles.size() ; i++) { 
      insert_ppc(&particles[i],i);
@@ -234,6 +243,13 @@ outer_else:
   }
 }
 
+void HemoCellParticleField::addParticles(const vector<HemoCellParticle::serializeValues_t> & svs) {
+  particles.reserve(particles.size() + svs.size());
+  for (const HemoCellParticle::serializeValues_t & sv : svs) {
+    addParticle(sv);
+  }
+}
+
 void HemoCellParticleField::addParticlePreinlet(const HemoCellParticle::serializeValues_t & sv) {
   HemoCellParticle * local_sparticle, * particle;
   const hemo::Array<T,3> & pos = sv.position;
@@ -284,11 +300,15 @@ outer_else:
 }
 
 void inline HemoCellParticleField::insert_ppc(HemoCellParticle* sparticle, unsigned int index) {
-  if (_particles_per_cell.find(sparticle->sv.cellId) == _particles_per_cell.end()) {
-    _particles_per_cell[sparticle->sv.cellId].resize((*cellFields)[sparticle->sv.celltype]->numVertex,-1);
+  auto cell = _particles_per_cell.find(sparticle->sv.cellId);
+  if (cell == _particles_per_cell.end()) {
+    cell = _particles_per_cell.emplace(sparticle->sv.cellId, vector<int>((*cellFields)[sparticle->sv.celltype]->numVertex,-1)).first;
   }
-  _particles_per_cell.at(sparticle->sv.cellId)[sparticle->sv.vertexId] = index;
-
+  int & slot = cell->second[sparticle->sv.vertexId];
+  if (slot == -1) {
+    _vertices_per_cell[sparticle->sv.cellId]++;
+  }
+  slot = index;
 }
 void inline HemoCellParticleField::insert_preinlet_ppc(HemoCellParticle* sparticle, unsigned int index) {
   if (_preinlet_particles_per_cell.find(sparticle->sv.cellId) == _preinlet_particles_per_cell.end()) {
@@ -301,92 +321,98 @@ void inline HemoCellParticleField::insert_preinlet_ppc(HemoCellParticle* spartic
 
 }
 
-void HemoCellParticleField::removeParticles(plint tag) {
-//Almost the same, but we save a lot of branching by making a seperate function
-
-  const unsigned int old_size = particles.size();
+void HemoCellParticleField::compactParticles() {
+  // Stable compaction, remembering where every kept particle went
+  _compaction_index.resize(particles.size());
+  unsigned int kept = 0;
   for (unsigned int i = 0 ; i < particles.size() ; i++) {
-    if (particles[i].getTag() == tag) {
-      particles[i] = particles.back();
-      particles.pop_back();
-      i--;
+    if (_removal_mask[i]) {
+      _compaction_index[i] = -1;
+      continue;
     }
+    if (kept != i) {
+      particles[kept] = particles[i];
+    }
+    _compaction_index[i] = kept++;
   }
-  if (particles.size() != old_size) {
+  if (kept == particles.size()) { return; }
+  particles.resize(kept);
+
+  // Renumber the particles per cell instead of rebuilding them, a cell that
+  // lost only some of its particles may have lost its local ones as well
+  bool partiallyRemoved = false;
+  if (ppc_up_to_date) {
+    for (auto cell = _particles_per_cell.begin() ; cell != _particles_per_cell.end() ; ) {
+      unsigned int & present = _vertices_per_cell[cell->first];
+      const unsigned int before = present;
+      for (int & index : cell->second) {
+        if (index == -1) { continue; }
+        index = _compaction_index[index];
+        if (index == -1) { present--; }
+      }
+      if (present == 0) {
+        _lpc.erase(cell->first);
+        _vertices_per_cell.erase(cell->first);
+        cell = _particles_per_cell.erase(cell);
+        continue;
+      }
+      if (present != before) { partiallyRemoved = true; }
+      ++cell;
+    }
+  } else {
+    partiallyRemoved = true;
+  }
+
+  if (partiallyRemoved) {
     lpc_up_to_date = false;
-    ppt_up_to_date = false;
-    ppc_up_to_date = false;
-    pg_up_to_date = false;
-  } 
+  }
+  ppt_up_to_date = false;
+  pg_up_to_date = false;
+}
+
+void HemoCellParticleField::removeParticles(plint tag) {
+  _removal_mask.resize(particles.size());
+  for (unsigned int i = 0 ; i < particles.size() ; i++) {
+    _removal_mask[i] = particles[i].getTag() == tag;
+  }
+  compactParticles();
 }
 
 void HemoCellParticleField::removeParticles(Box3D domain, plint tag) {
-//Almost the same, but we save a lot of branching by making a seperate function
   Box3D finalDomain;
   
   intersect(domain, this->getBoundingBox(), finalDomain);
 
-  const unsigned int old_size = particles.size();
+  _removal_mask.resize(particles.size());
   for (unsigned int i = 0 ; i < particles.size() ; i++) {
-    if (particles[i].getTag() == tag && this->isContainedABS(particles[i].sv.position,finalDomain)) {
-      particles[i] = particles.back();
-      particles.pop_back();
-      i--;
-    }
+    _removal_mask[i] = particles[i].getTag() == tag && this->isContainedABS(particles[i].sv.position,finalDomain);
   }
-  if (particles.size() != old_size) {
-    lpc_up_to_date = false;
-    ppt_up_to_date = false;
-    ppc_up_to_date = false;
-    pg_up_to_date = false;
-  } 
+  compactParticles();
 }
 
 void HemoCellParticleField::removeParticles(Box3D domain) {
-//Almost the same, but we save a lot of branching by making a seperate function
-
   Box3D finalDomain;
   
   intersect(domain, this->getBoundingBox(), finalDomain);
 
-  const unsigned int old_size = particles.size();
+  _removal_mask.resize(particles.size());
   for (unsigned int i = 0 ; i < particles.size() ; i++) {
-    if (this->isContainedABS(particles[i].sv.position,finalDomain)) {
-      particles[i] = particles.back();
-      particles.pop_back();
-      i--;
-    }
+    _removal_mask[i] = this->isContainedABS(particles[i].sv.position,finalDomain);
   }
-  if (particles.size() != old_size) {
-    lpc_up_to_date = false;
-    ppt_up_to_date = false;
-    ppc_up_to_date = false;
-    pg_up_to_date = false;
-  } 
+  compactParticles();
 }
 
 //remove everything outside this domain
 void HemoCellParticleField::removeParticles_inverse(Box3D domain) {
-//Almost the same, but we save a lot of branching by making a seperate function
-
   Box3D finalDomain;
   
   intersect(domain, this->getBoundingBox(), finalDomain);
 
-  const unsigned int old_size = particles.size();
+  _removal_mask.resize(particles.size());
   for (unsigned int i = 0 ; i < particles.size() ; i++) {
-    if (!this->isContainedABS(particles[i].sv.position,finalDomain)) {
-      particles[i] = particles.back();
-      particles.pop_back();
-      i--;
-    }
+    _removal_mask[i] = !this->isContainedABS(particles[i].sv.position,finalDomain);
   }
-  if (particles.size() != old_size) {
-    lpc_up_to_date = false;
-    ppt_up_to_date = false;
-    ppc_up_to_date = false;
-    pg_up_to_date = false;
-  } 
+  compactParticles();
 }
 
 void HemoCellParticleField::syncEnvelopes() {
@@ -467,87 +493,50 @@ void HemoCellParticleField::issueWarning(HemoCellParticle & p){
 }
 
 int HemoCellParticleField::deleteIncompleteCells(pluint ctype, bool verbose) {
-  int deleted = 0;
-
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  //Warning, TODO, high complexity, should be rewritten 
-  //For now abuse tagging and the remove function
-  for ( const auto &lpc_it : particles_per_cell ) {
-    int cellid = lpc_it.first;
-    bool broken = false;
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size() ; i++) {
-      if (particles_per_cell.at(cellid)[i] == -1) {
-        broken = true;
-        break;
-      }
-    }
-    if (!broken) {continue;}
-
-    bool warningIssued = false;
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size() ; i++) {
-      if (particles_per_cell.at(cellid)[i] == -1) {continue;}
-
-      //issue warning
-      if (verbose) {
-        if (!warningIssued) {
-          if (isContainedABS(particles[particles_per_cell.at(cellid)[i]].sv.position,localDomain)) {
-                  issueWarning(particles[particles_per_cell.at(cellid)[i]]);
-            warningIssued = true;
-          }
-        }
-      }
-      
-      //actually add to tobedeleted list
-      particles[particles_per_cell.at(cellid)[i]].setTag(1);
-      deleted++;
-    }
-  } 
-
-  //We have our list, now abuse the removeall function
-  removeParticles(1);
-
-  return deleted; 
+  return removeIncompleteCells(ctype, verbose, false);
 }
 
 int HemoCellParticleField::deleteIncompleteCells(const bool verbose) {
+  return removeIncompleteCells(-1, verbose, true);
+}
+
+int HemoCellParticleField::removeIncompleteCells(plint ctype, bool verbose, bool allTypes) {
   int deleted = 0;
+  bool masked = false;
   const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  //Warning, TODO, high complexity, should be rewritten 
-  //For now abuse tagging and the remove function
-  for ( const auto &lpc_it : particles_per_cell ) {
-    int cellid = lpc_it.first;
-    bool broken = false;
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size() ; i++) {
-      if (particles_per_cell.at(cellid)[i] == -1) {
-        broken = true;
-        break;
-      }
+
+  // A cell is complete when all its vertices are present, which the vertex
+  // counts tell without walking the cell
+  auto present = _vertices_per_cell.cbegin();
+  for (const auto & cell : particles_per_cell) {
+    while (present->first != cell.first) { ++present; } // Both ordered by cell id
+    if (present->second == cell.second.size()) { continue; }
+
+    if (!masked) {
+      _removal_mask.assign(particles.size(), false);
+      masked = true;
     }
-    if (!broken) {continue;}
 
     bool warningIssued = false;
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size() ; i++) {
-      if (particles_per_cell.at(cellid)[i] == -1) {continue;}
+    for (const int index : cell.second) {
+      if (index == -1) { continue; }
+      if (!allTypes && particles[index].sv.celltype != (pluint)ctype) { break; }
 
       //issue warning
-      if (verbose) {
-        if (!warningIssued) {
-          if (isContainedABS(particles[particles_per_cell.at(cellid)[i]].sv.position,localDomain)) {
-                  issueWarning(particles[particles_per_cell.at(cellid)[i]]);
-            warningIssued = true;
-          }
-        }
+      if (verbose && !warningIssued && isContainedABS(particles[index].sv.position,localDomain)) {
+        issueWarning(particles[index]);
+        warningIssued = true;
       }
-      
-      //actually add to tobedeleted list
-      particles[particles_per_cell.at(cellid)[i]].setTag(1);
+
+      _removal_mask[index] = true;
       deleted++;
     }
-  } 
-
-  //We have our list, now abuse the removeall function
+  }
 
-  removeParticles(1);
+  // Remove all incomplete cells at once
+  if (deleted) {
+    compactParticles();
+  }
 
   return deleted; 
 }
@@ -563,12 +552,64 @@ void HemoCellParticleField::setlocalDomain(Box3D & localDomain_) {
 }
 
 
+void HemoCellParticleField::advanceSubcycled(pluint ctype, map<int,vector<HemoCellParticle*>> & ppc_new, const map<int,bool> & lpc) {
+  const unsigned int substeps = (*cellFields)[ctype]->substeps;
+  vector<HemoCellParticle*> found;
+  findParticles(getBoundingBox(),found,ctype);
+
+  // The fluid is not sub-stepped: the interpolated velocity already responds
+  // to the membrane force spread this step. Within the step a vertex adds the
+  // velocity that the change of its force gives the fluid under its kernel
+  // in one step, F*sum(w^2)/rho with rho = 1 (lattice units). This only
+  // accounts for the vertex itself, neither the other vertices nor the
+  // transport by the fluid, so it is a heuristic that holds while the force
+  // changes little within a step (see the substeps entry of the user guide)
+  vector<hemo::Array<T,3>> spreadForce(found.size());
+  vector<T> mobility(found.size(), 0.);
+  for (unsigned int i = 0 ; i < found.size() ; i++) {
+    spreadForce[i] = found[i]->sv.force;
+    for (const T weight : found[i]->kernelWeights) {
+      mobility[i] += weight*weight;
+    }
+  }
+
+  for (unsigned int step = 0 ; step < substeps ; step++) {
+    if (step) {
+      for (auto & pair : cellGeometry) {
+        pair.second.valid = false;
+      }
+      applyCellMechanics(ctype, ppc_new, lpc, found);
+    }
+    for (unsigned int i = 0 ; i < found.size() ; i++) {
+      HemoCellParticle & particle = *found[i];
+      particle.advance(particle.sv.v + (particle.sv.force - spreadForce[i])*mobility[i], 1./substeps);
+    }
+  }
+}
+
 void HemoCellParticleField::advanceParticles() {
+  // Stiff cell types sub-cycle their membrane within this fluid step
+  vector<char> subcycled((*cellFields).size(), 0);
+  map<int,vector<HemoCellParticle*>> ppc_new;
+  map<int,bool> lpc;
+  for (pluint ctype = 0; ctype < (*cellFields).size(); ctype++) {
+    if ((*cellFields)[ctype]->substeps > 1) {
+      if (lpc.empty()) {
+        collectCompleteCells(ppc_new, lpc);
+      }
+      advanceSubcycled(ctype, ppc_new, lpc);
+      subcycled[ctype] = 1;
+    }
+  }
+
+  const WallDistanceField & walls = getWallDistance();
+  plb::Box3D const box = atomicLattice->getBoundingBox();
+  plb::Dot3D const& location = atomicLattice->getLocation();
   for(HemoCellParticle & particle:particles){
-    particle.advance();
+    if (!subcycled[particle.sv.celltype]) {
+      particle.advance();
+    }
     //By lack of better place, check if it is on a boundary, if so, delete it
-    plb::Box3D const box = atomicLattice->getBoundingBox();
-    plb::Dot3D const& location = atomicLattice->getLocation();
     plint x = (particle.sv.position[0]-location.x)+0.5;
     plint y = (particle.sv.position[1]-location.y)+0.5;
     plint z = (particle.sv.position[2]-location.z)+0.5;
@@ -576,12 +617,15 @@ void HemoCellParticleField::advanceParticles() {
     if ((x >= box.x0) && (x <= box.x1) &&
 	(y >= box.y0) && (y <= box.y1) &&
 	(z >= box.z0) && (z <= box.z1)) {
-      if (atomicLattice->get(x,y,z).getDynamics().isBoundary()) {
+      if (walls.isWall(x,y,z)) {
         particle.tag = 1;
       }
     }
   }
   removeParticles(1);
+  for (auto & pair : cellGeometry) {
+    pair.second.valid = false;
+  }
   
   lpc_up_to_date = false;
   pg_up_to_date = false;
@@ -630,48 +674,62 @@ void HemoCellParticleField::unifyForceVectors() {
   }
 }
 
-void HemoCellParticleField::applyConstitutiveModel(bool forced) {
-  map<int,vector<HemoCellParticle*>> * ppc_new = new map<int,vector<HemoCellParticle*>>();
+void HemoCellParticleField::collectCompleteCells(map<int,vector<HemoCellParticle*>> & ppc_new, map<int,bool> & lpc) {
   const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  map<int,bool> lpc;
   //Fill it here, probably needs optimization, ah well ...
   for (const auto & pair : particles_per_cell) {
     const int & cid = pair.first;
     const vector<int> & cell = pair.second; 
-    (*ppc_new)[cid].resize(cell.size());
+    ppc_new[cid].resize(cell.size());
     for (unsigned int i = 0 ; i < cell.size() ; i++) {
       if (cell[i] == -1) {
-        (*ppc_new).erase(cid); //not complete, remove entry
+        ppc_new.erase(cid); //not complete, remove entry
         goto no_add_lpc;
       } else {
-        (*ppc_new)[cid][i] = &particles[cell[i]];
+        ppc_new[cid][i] = &particles[cell[i]];
       }
     }
     lpc[cid]=true;
     no_add_lpc:;
   }
+}
+
+void HemoCellParticleField::applyCellMechanics(pluint ctype, map<int,vector<HemoCellParticle*>> & ppc_new,
+                                               const map<int,bool> & lpc, const vector<HemoCellParticle*> & found) {
+  if (found.size() > 0) {
+    //only reset forces when the forces actually point at it.
+    if (found[0]->force_area == &found[0]->sv.force) {
+      for (HemoCellParticle* particle : found) {
+        particle->sv.force = {0.,0.,0.};
+      }
+    }
+  }
+  (*cellFields)[ctype]->mechanics->cellGeometry = &cellGeometry;
+  (*cellFields)[ctype]->mechanics->ParticleMechanics(ppc_new,lpc,ctype);
+  (*cellFields)[ctype]->mechanics->cellGeometry = 0;
+}
+
+void HemoCellParticleField::applyConstitutiveModel(bool forced) {
+  map<int,vector<HemoCellParticle*>> ppc_new;
+  map<int,bool> lpc;
+  collectCompleteCells(ppc_new, lpc);
   
   for (pluint ctype = 0; ctype < (*cellFields).size(); ctype++) {
     if ((*cellFields).hemocell.iter % (*cellFields)[ctype]->timescale == 0 || forced) {
       vector<HemoCellParticle*> found;
       findParticles(getBoundingBox(),found,ctype);
-      if (found.size() > 0) {
-        //only reset forces when the forces actually point at it.
-        if (found[0]->force_area == &found[0]->sv.force) {
-          for (HemoCellParticle* particle : found) {
-            particle->sv.force = {0.,0.,0.};
-#ifdef INTERIOR_VISCOSITY
-            particle->normalDirection = {0., 0., 0.};
-#endif
-          }
-        }
-      }
-      (*cellFields)[ctype]->mechanics->ParticleMechanics(*ppc_new,lpc,ctype);
+      applyCellMechanics(ctype, ppc_new, lpc, found);
     }
   }
   
-  delete ppc_new;
-  
+  // Forget the geometry of cells that are no longer local
+  for (auto it = cellGeometry.begin() ; it != cellGeometry.end() ; ) {
+    if (lpc.find(it->first) == lpc.end()) {
+      it = cellGeometry.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
 #define inner_loop \
@@ -742,46 +800,148 @@ void HemoCellParticleField::applyRepulsionForce(bool forced) {
   }
 }
 
+void HemoCellParticleField::computeVertexNormals(plint cid, pluint ctype, vector<hemo::Array<T,3>> & normals) {
+  const vector<int> & cell = get_particles_per_cell().at(cid);
+  const HemoCellField & field = *(*cellFields)[ctype];
+  const T area_mean_eq = field.mechanics->cellConstants.area_mean_eq;
+  normals.assign(cell.size(), {0.,0.,0.});
+  for (const hemo::Array<plint,3> & triangle : field.triangle_list) {
+    if (cell[triangle[0]] == -1 || cell[triangle[1]] == -1 || cell[triangle[2]] == -1) { continue; }
+    T area;
+    hemo::Array<T,3> t_normal;
+    computeTriangleAreaAndUnitNormal(particles[cell[triangle[0]]].sv.position,
+                                     particles[cell[triangle[1]]].sv.position,
+                                     particles[cell[triangle[2]]].sv.position, area, t_normal);
+    const hemo::Array<T,3> weighted = t_normal*(area/area_mean_eq);
+    for (int v = 0 ; v < 3 ; v++) {
+      normals[triangle[v]] += weighted;
+    }
+  }
+}
+
 #ifdef INTERIOR_VISCOSITY
 void HemoCellParticleField::internalGridPointsMembrane(Box3D domain) {
   // This could be done less complex I guess?
+  const vector<hemo::Array<T,3>> * normals = 0;
+  map<int,vector<hemo::Array<T,3>>> computedNormals;
+  plint geometryCell = -1;
+  // With incremental refreshes the nodes are claimed by the cell that finds
+  // them, collected here as the nodes found inside and outside of each cell
+  struct MembraneNodes {
+    vector<Dot3D> inside, outside;
+    T tau;
+  };
+  map<int,MembraneNodes> claims;
   for (const HemoCellParticle & particle : particles) { // Go over each particle
      if (!(*cellFields)[particle.sv.celltype]->doInteriorViscosity) { continue; }
 
+    // Vertex normals come from the constitutive model, cells it did not
+    // handle since the last advance (or incomplete cells) get them from the
+    // triangles of which all vertices are present
+    if (particle.sv.cellId != geometryCell) {
+      geometryCell = particle.sv.cellId;
+      const auto entry = cellGeometry.find(geometryCell);
+      if (entry != cellGeometry.end() && entry->second.valid) {
+        normals = &entry->second.vertexNormals;
+      } else {
+        vector<hemo::Array<T,3>> & computed = computedNormals[geometryCell];
+        if (computed.empty()) {
+          computeVertexNormals(geometryCell, particle.sv.celltype, computed);
+        }
+        normals = &computed;
+      }
+    }
+    const hemo::Array<T, 3> & normalP = (*normals)[particle.sv.vertexId];
+
     for (unsigned int i = 0; i < particle.kernelCoordinates.size(); i++) {
       const hemo::Array<T, 3> latPos = particle.kernelCoordinates[i]-(particle.sv.position-atomicLattice->getLocation());
-      const hemo::Array<T, 3> & normalP = particle.normalDirection;
 
       if (computeLength(latPos) > (*cellFields)[particle.sv.celltype]->mechanics->cellConstants.edge_mean_eq) {continue;}
       
       T dot1 = hemo::dot(latPos, normalP);
-
-      if (dot1 < 0.) {  // Node is inside
-        InteriorViscosityHelper::get(*cellFields).add(*this, {particle.kernelCoordinates[i][0],
-                particle.kernelCoordinates[i][1],
-                particle.kernelCoordinates[i][2]},
-                (*cellFields)[particle.sv.celltype]->interiorViscosityTau);
-        particle.kernelLocations[i]->attributeDynamics((*cellFields)[particle.sv.celltype]->innerViscosityDynamics);
+      const Dot3D node(particle.kernelCoordinates[i][0],
+                       particle.kernelCoordinates[i][1],
+                       particle.kernelCoordinates[i][2]);
+
+      if (interiorCellStatesValid) {
+        MembraneNodes & cellNodes = claims[particle.sv.cellId];
+        cellNodes.tau = (*cellFields)[particle.sv.celltype]->interiorViscosityTau;
+        if (dot1 < 0.) {
+          cellNodes.inside.push_back(node);
+        } else {
+          cellNodes.outside.push_back(node);
+        }
+      } else if (dot1 < 0.) {  // Node is inside
+        InteriorViscosityHelper::get(*cellFields).add(*this, node, (*cellFields)[particle.sv.celltype]->interiorViscosityTau);
       } else {  // Node is outside
-        InteriorViscosityHelper::get(*cellFields).remove(*this, {particle.kernelCoordinates[i][0],
-                                                                particle.kernelCoordinates[i][1],
-                                                                particle.kernelCoordinates[i][2]});
-        particle.kernelLocations[i]->attributeDynamics(&atomicLattice->getBackgroundDynamics());
+        InteriorViscosityHelper::get(*cellFields).remove(*this, node);
       }
     }
   }
+
+  // Merge the membrane nodes into the interior of their cell, a node found
+  // inside by any vertex stays inside
+  vector<Dot3D> merged;
+  for (auto & pair : claims) {
+    InteriorCellState & state = interiorCellStates[pair.first];
+    vector<Dot3D> & inside = pair.second.inside;
+    vector<Dot3D> & outside = pair.second.outside;
+    std::sort(inside.begin(),inside.end());
+    inside.erase(std::unique(inside.begin(),inside.end()),inside.end());
+    std::sort(outside.begin(),outside.end());
+    outside.erase(std::unique(outside.begin(),outside.end()),outside.end());
+
+    merged.clear();
+    auto s = state.nodes.begin(), in = inside.begin(), out = outside.begin();
+    while (s != state.nodes.end() || in != inside.end()) {
+      if (in == inside.end() || (s != state.nodes.end() && *s < *in)) {
+        while (out != outside.end() && *out < *s) { ++out; }
+        if (out != outside.end() && !(*s < *out)) {
+          releaseInteriorNode(*s);
+        } else {
+          merged.push_back(*s);
+        }
+        ++s;
+      } else {
+        if (s != state.nodes.end() && !(*in < *s)) {
+          ++s;
+        } else {
+          claimInteriorNode(*in, pair.second.tau);
+        }
+        merged.push_back(*in);
+        ++in;
+      }
+    }
+    state.nodes.swap(merged);
+  }
 }
 
 // For performance reason, this is only executed once every n iterations to make
 // sure that there are no higher viscosity grid points left after substantial movement
+//
+// When cellFields->interiorViscosityRefreshDisplacement is set, only cells of
+// which a vertex moved further than that since their last refresh are
+// recomputed, and only the difference with their previous interior is applied.
 void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
-  // Reset all the lattice points to the orignal relaxation parameter
-  for (const Dot3D & internalPoint : internalPoints ) {
-    atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
-    atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&atomicLattice->getBackgroundDynamics());
+  InteriorViscosityHelper & helper = InteriorViscosityHelper::get(*cellFields);
+  const T threshold = cellFields->interiorViscosityRefreshDisplacement;
+  const bool incremental = threshold > 0 && interiorCellStatesValid;
+
+  if (!incremental) {
+    // Reset all the lattice points to the orignal relaxation parameter
+    helper.empty(*this);
+    interiorCellStates.clear();
+    interiorNodeClaims.assign(threshold > 0 ? atomicLattice->getNx()*atomicLattice->getNy()*atomicLattice->getNz() : 0, 0);
   }
-  InteriorViscosityHelper::get(*cellFields).empty(*this);
-  
+
+  // Inner nodes are searched in absolute coordinates over the whole atomic block
+  const Dot3D & location = atomicLattice->getLocation();
+  const Box3D absoluteDomain(location.x, location.x + atomicLattice->getNx()-1,
+                             location.y, location.y + atomicLattice->getNy()-1,
+                             location.z, location.z + atomicLattice->getNz()-1);
+  vector<hemo::Array<plint,3>> innerNodes;
+  vector<Dot3D> nodes, changed;
+
   for (const auto & pair : get_lpc()) { // Go over each cell?
     const int & cid = pair.first;
     const vector<int> & cell = get_particles_per_cell().at(cid);
@@ -792,18 +952,82 @@ void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
     if (!(*cellFields)[ctype]->doInteriorViscosity) {
       continue;
     }
-    
-    hemo::OctreeStructCell octCell(3, 1, 30,
-                                  (*cellFields)[ctype]->mechanics->cellConstants.triangle_list,
-                                  particles, cell);
 
-    std::set<Array<plint,3>> innerNodes;
-    octCell.findInnerNodes(atomicLattice,particles,cell,innerNodes);
+    InteriorCellState * state = 0;
+    if (threshold > 0) {
+      state = &interiorCellStates[cid];
+      if (state->positions.size() == cell.size()) {
+        T maxDisplacement = 0.;
+        for (unsigned int i = 0 ; i < cell.size() ; i++) {
+          const hemo::Array<T,3> d = particles[cell[i]].sv.position - state->positions[i];
+          maxDisplacement = std::max(maxDisplacement, hemo::dot(d,d));
+        }
+        if (maxDisplacement <= threshold*threshold) { continue; }
+      }
+    }
+
+    ScanlineVoxelizer & voxelizer = (*cellFields)[ctype]->getVoxelizer();
+    voxelizer.refit(particles, cell);
+    innerNodes.clear();
+    voxelizer.findInnerNodes(absoluteDomain, innerNodes);
+    nodes.clear();
     for (const Array<plint,3> & node : innerNodes) {
-      InteriorViscosityHelper::get(*cellFields).add(*this, {node[0],node[1],node[2]},(*cellFields)[ctype]->interiorViscosityTau );
-      atomicLattice->get(node[0],node[1],node[2]).attributeDynamics((*cellFields)[ctype]->innerViscosityDynamics);
+      nodes.push_back(Dot3D(node[0]-location.x, node[1]-location.y, node[2]-location.z));
+    }
+
+    if (!state) {
+      for (const Dot3D & node : nodes) {
+        helper.add(*this, node, (*cellFields)[ctype]->interiorViscosityTau);
+      }
+      continue;
+    }
+
+    // Apply only the difference with the previous refresh of this cell
+    std::sort(nodes.begin(),nodes.end());
+    changed.clear();
+    std::set_difference(state->nodes.begin(),state->nodes.end(),nodes.begin(),nodes.end(),std::back_inserter(changed));
+    for (const Dot3D & node : changed) {
+      releaseInteriorNode(node);
+    }
+    changed.clear();
+    std::set_difference(nodes.begin(),nodes.end(),state->nodes.begin(),state->nodes.end(),std::back_inserter(changed));
+    for (const Dot3D & node : changed) {
+      claimInteriorNode(node, (*cellFields)[ctype]->interiorViscosityTau);
+    }
+
+    state->nodes.swap(nodes);
+    state->positions.resize(cell.size());
+    for (unsigned int i = 0 ; i < cell.size() ; i++) {
+      state->positions[i] = particles[cell[i]].sv.position;
     }
   }
+
+  // Cells that left this block (or were deleted) leave their interior behind
+  for (auto it = interiorCellStates.begin() ; it != interiorCellStates.end() ; ) {
+    if (get_lpc().find(it->first) == get_lpc().end()) {
+      for (const Dot3D & node : it->second.nodes) {
+        releaseInteriorNode(node);
+      }
+      it = interiorCellStates.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  interiorCellStatesValid = threshold > 0;
+}
+
+void HemoCellParticleField::claimInteriorNode(const Dot3D & node, T tau) {
+  unsigned short & claims = interiorNodeClaims[(node.x*atomicLattice->getNy() + node.y)*atomicLattice->getNz() + node.z];
+  if (!claims++) {
+    InteriorViscosityHelper::get(*cellFields).add(*this, node, tau);
+  }
+}
+
+void HemoCellParticleField::releaseInteriorNode(const Dot3D & node) {
+  unsigned short & claims = interiorNodeClaims[(node.x*atomicLattice->getNy() + node.y)*atomicLattice->getNz() + node.z];
+  if (claims && !--claims) {
+    InteriorViscosityHelper::get(*cellFields).remove(*this, node);
+  }
 }
 #else
 void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
@@ -830,7 +1054,22 @@ void HemoCellParticleField::interpolateFluidVelocity(Box3D domain) {
     velocity = {0.0,0.0,0.0};
     for (pluint j = 0; j < particle.kernelLocations.size(); j++) {
       // Direct access
-      particle.kernelLocations[j]->computeVelocity(velocity_comp);
+      plb::Cell<T,DESCRIPTOR> & node = *particle.kernelLocations[j];
+      const T * spread = forceTiles.active() ? forceTiles.find(&node) : 0;
+      if (spread) {
+        // The velocity includes half of the force on the node, which includes the spread force
+        T * external = node.getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt);
+        const T saved[3] = {external[0], external[1], external[2]};
+        external[0] += spread[0];
+        external[1] += spread[1];
+        external[2] += spread[2];
+        node.computeVelocity(velocity_comp);
+        external[0] = saved[0];
+        external[1] = saved[1];
+        external[2] = saved[2];
+      } else {
+        node.computeVelocity(velocity_comp);
+      }
       velocity += (velocity_comp * particle.kernelWeights[j]);
     }
     particle.sv.v = velocity;
@@ -839,6 +1078,11 @@ void HemoCellParticleField::interpolateFluidVelocity(Box3D domain) {
 }
 
 void HemoCellParticleField::spreadParticleForce(Box3D domain) {
+  if (cellFields->spreadForceInTiles) {
+    forceTiles.begin(*atomicLattice);
+  } else if (forceTiles.active()) {
+    forceTiles.release();
+  }
   for( HemoCellParticle &particle:particles) {
 
     //Trick to allow for different kernels for different particle types.
@@ -851,6 +1095,14 @@ void HemoCellParticleField::spreadParticleForce(Box3D domain) {
       particle.sv.force *= param::f_limit/force_mag;
 #endif
 
+    if (forceTiles.active()) {
+      const hemo::Array<T,3> force = particle.sv.force_repulsion + particle.sv.force;
+      for (pluint j = 0; j < particle.kernelLocations.size(); j++) {
+        forceTiles.add(particle.kernelLocations[j], force * particle.kernelWeights[j]);
+      }
+      continue;
+    }
+
     // Directly change the force on a node, quick-and-dirty solution.
     for (pluint j = 0; j < particle.kernelLocations.size(); j++) {
       // Direct access
@@ -862,55 +1114,64 @@ void HemoCellParticleField::spreadParticleForce(Box3D domain) {
   }
 }
 
-void HemoCellParticleField::populateBoundaryParticles() {
+void HemoCellParticleField::resetSpreadForce(Box3D domain) {
+  // The force in the tiles is dropped by the next spreading
+  if (forceTiles.active()) { return; }
 
-  for (int x = 0; x < this->atomicLattice->getNx()-1; x++) {
-    for (int y = 0; y < this->atomicLattice->getNy()-1; y++) {
-      for (int z = 0; z < this->atomicLattice->getNz()-1; z++) {
-        if (this->atomicLattice->get(x,y,z).getDynamics().isBoundary()) {
-          for (int xx = x-1; xx <= x+1; xx++) {
-            if (xx < 0 || xx > this->atomicLattice->getNx()-1) {continue;}
-            for (int yy = y-1; yy <= y+1; yy++) {
-              if (yy < 0 || yy > this->atomicLattice->getNy()-1) {continue;}
-              for (int zz = z-1; zz <= z+1; zz++) {
-                if (zz < 0 || zz > this->atomicLattice->getNz()-1) {continue;}
-                if (!this->atomicLattice->get(xx,yy,zz).getDynamics().isBoundary()) {
-                  boundaryParticles.push_back({x,y,z});       
-                  goto end_inner_loop;
-                }
-              }
-            }
-          }
-        }
-end_inner_loop:;
-      }
+  // The kernels are still those of the last spreading, the particles did not move since
+  for (HemoCellParticle & particle : particles) {
+    for (plb::Cell<T,DESCRIPTOR> * node : particle.kernelLocations) {
+      node->external.data[0] = 0.;
+      node->external.data[1] = 0.;
+      node->external.data[2] = 0.;
     }
   }
 }
 
-void HemoCellParticleField::applyBoundaryRepulsionForce() {
-    if(!pg_up_to_date) {
-    update_pg();
+WallDistanceField & HemoCellParticleField::getWallDistance(plint range) {
+  if (!wallDistance) {
+    wallDistance = new WallDistanceField(*atomicLattice, range);
+  } else {
+    wallDistance->ensureRange(range);
   }
+  return *wallDistance;
+}
+
+void HemoCellParticleField::wallsChanged(const Box3D & domain) {
+  if (wallDistance) {
+    wallDistance->refresh(domain);
+  }
+}
+
+void HemoCellParticleField::populateBoundaryParticles() {
+  // The repulsion only needs to know which vertices have a wall node next to them
+  getWallDistance(2);
+}
+
+void HemoCellParticleField::applyBoundaryRepulsionForce() {
   const T & br_cutoff = cellFields->boundaryRepulsionCutoff;
   const T & br_const = cellFields->boundaryRepulsionConstant;
-  for (Dot3D & b_particle : boundaryParticles) {
-    for (int x = b_particle.x-1; x <= b_particle.x+1; x++) {
+  const WallDistanceField & walls = getWallDistance(2);
+  const Dot3D & location = this->atomicLattice->getLocation();
+  for (HemoCellParticle & lParticle : particles) {
+    const hemo::Array<T,3> & position = lParticle.sv.position;
+    const Dot3D node((plint)(position[0]-location.x+0.5), (plint)(position[1]-location.y+0.5), (plint)(position[2]-location.z+0.5));
+    // Every wall surface node around the node of the vertex repels it, most
+    // vertices have none within reach
+    if (!walls.nearWall(node, sqrt(3.))) { continue; }
+    for (int x = node.x-1; x <= node.x+1; x++) {
       if (x < 0 || x > this->atomicLattice->getNx()-1) {continue;}
-      for (int y = b_particle.y-1; y <= b_particle.y+1; y++) {
+      for (int y = node.y-1; y <= node.y+1; y++) {
         if (y < 0 || y > this->atomicLattice->getNy()-1) {continue;}
-        for (int z = b_particle.z-1; z <= b_particle.z+1; z++) {
+        for (int z = node.z-1; z <= node.z+1; z++) {
           if (z < 0 || z > this->atomicLattice->getNz()-1) {continue;}
-          const int & index = grid_index(x,y,z);
-          for (unsigned int i = 0 ; i < particle_grid_size[index] ; i++ ) {
-            HemoCellParticle & lParticle = particles[particle_grid[index][i]];
-            const hemo::Array<T,3> dv = lParticle.sv.position - (b_particle + this->atomicLattice->getLocation()); 
-            const T distance = sqrt(dv[0]*dv[0]+dv[1]*dv[1]+dv[2]*dv[2]); 
-            if (distance < br_cutoff) { 
-              const hemo::Array<T, 3> rfm = br_const * (1/(distance/br_cutoff))  * (dv/distance);
-              lParticle.sv.force_repulsion = lParticle.sv.force_repulsion + rfm; 
-            } 
-          }
+          if (!walls.isSurface(x,y,z)) {continue;}
+          const hemo::Array<T,3> dv = position - (Dot3D(x,y,z) + location);
+          const T distance = sqrt(dv[0]*dv[0]+dv[1]*dv[1]+dv[2]*dv[2]); 
+          if (distance > 0 && distance < br_cutoff) { 
+            const hemo::Array<T, 3> rfm = br_const * (1/(distance/br_cutoff))  * (dv/distance);
+            lParticle.sv.force_repulsion = lParticle.sv.force_repulsion + rfm; 
+          } 
         }
       }
     }
@@ -948,53 +1209,23 @@ end_inner_loop:;
 }
 
 
-T HemoCellParticleField::eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell) {
+T HemoCellParticleField::eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell, T omega) {
     plb::Array<T,SymmetricTensor<T,DESCRIPTOR>::n> element;
     cell.computePiNeq(element);
-    T omega     = cell.getDynamics().getOmega();
+    if (!omega) {
+      omega = cell.getDynamics().getOmega();
+    }
     T rhoBar    = cell.getDynamics().computeRhoBar(cell);
     T prefactor = - omega * DESCRIPTOR<T>::invCs2 *
                  DESCRIPTOR<T>::invRho(rhoBar) / (T)2;
-        for (int iTensor=0; iTensor<SymmetricTensor<T,DESCRIPTOR>::n; ++iTensor) {
-            element[iTensor] *= prefactor;
-        }
 
-    Array<Array<T,3>,3> S;  // Strain-rate tensor (symmetric).
-    S[0][0] = element[0]; //s[xx];
-    S[0][1] = element[1]; //s[xy];
-    S[0][2] = element[2]; //s[xz];
-                
-    S[1][0] = element[1]; //s[yx];
-    S[1][1] = element[3]; //s[yy];
-    S[1][2] = element[4]; //s[yz];
-
-    S[2][0] = element[2]; //s[zx];
-    S[2][1] = element[4]; //s[zy];
-    S[2][2] = element[5]; //s[zz];
-    
-    Eigen::Matrix<T,3,3> A;
-    for (plint i = 0; i < 3; i++) {
-        for (plint j = 0; j < 3; j++) {
-            A(i, j) = S[i][j];
-        }
-     }
+    // Strain-rate tensor (symmetric): xx, xy, xz, yy, yz, zz
+    hemo::Array<T,6> S;
+    for (int iTensor=0; iTensor<SymmetricTensor<T,DESCRIPTOR>::n; ++iTensor) {
+        S[iTensor] = element[iTensor] * prefactor;
+    }
 
-    bool computeEigenvectors = false;
-    Eigen::EigenSolver<Eigen::Matrix<T,3,3> > es(A, computeEigenvectors);
-    std::vector<T> lambda(3);
-    lambda[0] = std::real(es.eigenvalues()[0]);
-    lambda[1] = std::real(es.eigenvalues()[1]);
-    lambda[2] = std::real(es.eigenvalues()[2]);
-    std::sort(lambda.begin(), lambda.end());
-                
-//    Array<Array<T,3>,3> x;  // Eigenvectors of S.
-//    Array<T,3> d;           // Eigenvalues of S.
-//    Eigen::eigenDecomposition(S, x, d);
-//    std::vector<T> lambda(3);
-//    lambda[0] = d[0];
-//    lambda[1] = d[1];
-//    lambda[2] = d[2];
- //   std::sort(lambda.begin(), lambda.end());
+    const hemo::Array<T,3> lambda = symmetricEigenvalues(S);
     T tresca = (lambda[2]-lambda[0])/2;
     return tresca;
 }
@@ -1020,48 +1251,71 @@ void HemoCellParticleField::solidifyCells() {
 
   // Remove any to be removed particles (tagged with `tag == 1`).
   removeParticles(1);
-  if(!pg_up_to_date) {
-    update_pg();
+  if (!bindingField) {
+    return; // No binding sites were ever added
   }
 
-  // Detect particles to be solidified by looping over a block of 3x3 LBM cells
-  // around each binding site. When a cell statisfies both:
-  // - close enough in space to a binding site,
-  // - shows a minimum tresca stress,
-  // the particle is labelled to be solified.
-  for (const Dot3D & b_particle : bindingSites) {
-    for (int x = b_particle.x-1; x <= b_particle.x+1; x++) {
-      if (x < 0 || x > this->atomicLattice->getNx()-1) {
-        continue;
-      }
-
-      for (int y = b_particle.y-1; y <= b_particle.y+1; y++) {
-        if (y < 0 || y > this->atomicLattice->getNy()-1) {
-          continue;
-        }
+  if (!trescaField) {
+    trescaField = new ScalarField3D<T>(this->atomicLattice->getNx(),this->atomicLattice->getNy(),this->atomicLattice->getNz(),-1.);
+  }
+  vector<Dot3D> trescaComputed;
+
+  // Detect particles to be solidified in a single pass over the particles. A
+  // particle is labelled to be solidified when it both:
+  // - is close enough in space to a binding site in the 3x3x3 LBM cells
+  //   around its own cell,
+  // - shows a minimum tresca stress in its own cell.
+  // The nearBindingSite mask discards most particles with one lookup, and the
+  // tresca stress of a node is computed at most once per call.
+  const Dot3D & location = this->atomicLattice->getLocation();
+  const plint nx = this->atomicLattice->getNx();
+  const plint ny = this->atomicLattice->getNy();
+  const plint nz = this->atomicLattice->getNz();
+  for (HemoCellParticle & lParticle : particles) {
+    const hemo::Array<T,3> & position = lParticle.sv.position;
+    const int x = position[0]-location.x+0.5;
+    const int y = position[1]-location.y+0.5;
+    const int z = position[2]-location.z+0.5;
+    if (x < 0 || x >= nx || y < 0 || y >= ny || z < 0 || z >= nz) {
+      continue;
+    }
+    if (!nearBindingSite->get(x,y,z)) {
+      continue;
+    }
 
-        for (int z = b_particle.z-1; z <= b_particle.z+1; z++) {
-          if (z < 0 || z > this->atomicLattice->getNz()-1) {
+    const HemoCellField & type = *(*cellFields)[lParticle.sv.celltype];
+    bool close = false;
+    for (int xx = std::max(x-1,0); xx <= std::min(x+1,(int)nx-1) && !close; xx++) {
+      for (int yy = std::max(y-1,0); yy <= std::min(y+1,(int)ny-1) && !close; yy++) {
+        for (int zz = std::max(z-1,0); zz <= std::min(z+1,(int)nz-1) && !close; zz++) {
+          if (!bindingField->get(xx,yy,zz)) {
             continue;
           }
-
-          const int & index = grid_index(x,y,z);
-
-          for (unsigned int i = 0; i < particle_grid_size[index]; i++) {
-            HemoCellParticle & lParticle = particles[particle_grid[index][i]];
-            const hemo::Array<T,3> dv = lParticle.sv.position - (b_particle + this->atomicLattice->getLocation());
-            const T distance = sqrt(dv[0]*dv[0]+dv[1]*dv[1]+dv[2]*dv[2]);
-            T tresca = eigenValueFromCell(this->atomicLattice->get(x,y,z));
-
-            // FIXME: both user-defined constants could be extracted outside the loop.
-            if ((distance <= (*cellFields)[lParticle.sv.celltype]->mechanics->cfg["MaterialModel"]["distanceThreshold"].read<T>())
-                    && (abs(tresca/1e-7) > (*cellFields)[lParticle.sv.celltype]->mechanics->cfg["MaterialModel"]["shearThreshold"].read<T>()) ) {
-              lParticle.sv.solidify = true;
-            }
-          }
+          const hemo::Array<T,3> dv = position - (Dot3D(xx,yy,zz) + location);
+          close = sqrt(dv[0]*dv[0]+dv[1]*dv[1]+dv[2]*dv[2]) <= type.solidifyDistanceThreshold;
         }
       }
     }
+    if (!close) {
+      continue;
+    }
+
+    T & tresca = trescaField->get(x,y,z);
+    if (tresca < 0) {
+      // Interior nodes may only have their tau in the interior viscosity field
+      const T interiorTau = interiorViscosityField ? interiorViscosityField->get(x,y,z) : 0;
+      tresca = eigenValueFromCell(this->atomicLattice->get(x,y,z), interiorTau ? 1/interiorTau : 0);
+      trescaComputed.push_back(Dot3D(x,y,z));
+    }
+
+    if (abs(tresca/1e-7) > type.solidifyShearThreshold) {
+      lParticle.sv.solidify = true;
+    }
+  }
+
+  // Leave the scratch field clean for the next call
+  for (const Dot3D & node : trescaComputed) {
+    trescaField->get(node.x,node.y,node.z) = -1.;
   }
 #else
   hlog << "(HemoCellParticleField) SolidifyCells called but SOLIDIFY_MECHANICS not enabled" << endl;
@@ -26,11 +26,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
   class HemoCellParticleField;
+  class WallDistanceField;
 }
 
 #include "hemoCellFields.h"
 #include "hemoCellParticleDataTransfer.h"
 #include "hemoCellParticle.h"
+#include "ibmForceTiles.h"
 
 #include "atomicBlock/blockLattice3D.hh"
 
@@ -47,6 +49,8 @@ public:
     virtual void applyConstitutiveModel(bool forced = false);
     virtual void addParticle(HemoCellParticle* particle);
     void addParticle(const HemoCellParticle::serializeValues_t & sv);
+    /// addParticle() for a whole batch, reserving the storage once
+    void addParticles(const vector<HemoCellParticle::serializeValues_t> & svs);
     void addParticlePreinlet(const HemoCellParticle::serializeValues_t & sv);
 
     virtual void removeParticles(plb::Box3D domain);
@@ -64,6 +68,10 @@ public:
     void applyRepulsionForce(bool forced = false);
     virtual void interpolateFluidVelocity(plb::Box3D domain);
     virtual void spreadParticleForce(plb::Box3D domain);
+    /// Zero the external force of the kernel nodes of the particles
+    void resetSpreadForce(plb::Box3D domain);
+    /// The force spread on atomicLattice while HemoCellFields::spreadForceInTiles is set
+    IbmForceTiles forceTiles;
     void separateForceVectors();
     void unifyForceVectors();
     void updateResidenceTime(unsigned int rtime);
@@ -78,7 +86,8 @@ public:
     void applyBoundaryRepulsionForce();
     void populateBindingSites(plb::Box3D & domain);
 
-    T eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell);
+    /// omega overrides the relaxation of the dynamics of the cell when nonzero
+    T eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell, T omega = 0);
     
     void solidifyCells();
     void prepareSolidification();
@@ -138,7 +147,6 @@ public:
     plb::BlockLattice3D<T, CEPAC_DESCRIPTOR> * CEPAClattice = 0;
 
     vector<plint> neighbours;
-    vector<plb::Dot3D> boundaryParticles;
     pluint envelopeSize;
     pluint getsize() { return particles.size();}
     plint nearestCell(T const) const;
@@ -165,6 +173,7 @@ public:
 private:
   vector<vector<unsigned int>> _particles_per_type;
   map<int,vector<int>> _particles_per_cell;
+  map<int,unsigned int> _vertices_per_cell; // Present vertices per cell, valid with _particles_per_cell
   map<int,vector<int>> _preinlet_particles_per_cell;
   map<int,bool> _lpc;
   void update_lpc();
@@ -172,7 +181,23 @@ private:
   void update_preinlet_ppc();
   void update_ppt();
   void update_pg();
+  /// Area weighted vertex normals of cell cid from the triangles of which all
+  /// vertices are present, used when the constitutive model did not cache them
+  void computeVertexNormals(plint cid, pluint ctype, vector<hemo::Array<T,3>> & normals);
   void issueWarning(HemoCellParticle & p);
+  /// The cells of which all vertices are present, as particle pointers, and their ids
+  void collectCompleteCells(map<int,vector<HemoCellParticle*>> & ppc_new, map<int,bool> & lpc);
+  /// Membrane forces of one cell type, the forces of found are reset first
+  void applyCellMechanics(pluint ctype, map<int,vector<HemoCellParticle*>> & ppc_new,
+                          const map<int,bool> & lpc, const vector<HemoCellParticle*> & found);
+  /// Advance the particles of a sub-cycled cell type over one fluid step
+  void advanceSubcycled(pluint ctype, map<int,vector<HemoCellParticle*>> & ppc_new, const map<int,bool> & lpc);
+  int removeIncompleteCells(plint ctype, bool verbose, bool allTypes);
+  /// Remove the particles flagged in _removal_mask in a single stable pass,
+  /// the particles per cell (and vertex counts) are kept up to date
+  void compactParticles();
+  vector<char> _removal_mask;
+  vector<int> _compaction_index;
   
   hemo::Array<unsigned int,10> * particle_grid = 0;
   unsigned int * particle_grid_size = 0;
@@ -188,8 +213,36 @@ public:
   const map<int,vector<int>> & get_preinlet_particles_per_cell();
   const map<int,bool> & get_lpc();
   
-  set<plb::Dot3D> internalPoints; // Store found interior points
+  // Interior tau per node (0 for the background), edit through helper/interiorViscosity.h
   plb::ScalarField3D<T> * interiorViscosityField = 0;
+  vector<plb::Dot3D> interiorNodes; // Nodes given an interior tau, can hold stale or duplicate entries
+  unsigned int interiorNodeCount = 0; // Number of nodes with an interior tau
+
+  /// Interior nodes and vertex positions of a cell at its last refresh
+  struct InteriorCellState {
+    vector<hemo::Array<T,3>> positions;
+    vector<plb::Dot3D> nodes;
+  };
+  map<int,InteriorCellState> interiorCellStates;
+  bool interiorCellStatesValid = false;
+  /// Number of cells that claim each node of atomicLattice as interior while
+  /// interiorCellStates is used, a node keeps the interior tau until no cell claims it
+  vector<unsigned short> interiorNodeClaims;
+  void claimInteriorNode(const plb::Dot3D & node, T tau);
+  void releaseInteriorNode(const plb::Dot3D & node);
+
+  /// Distance to the wall of the nodes of atomicLattice, built on first use
+  /// and extended when a larger range is asked for
+  WallDistanceField & getWallDistance(plint range = 1);
+  /// Nodes in domain (relative to atomicLattice) may have become walls
+  void wallsChanged(const plb::Box3D & domain);
+private:
+  WallDistanceField * wallDistance = 0;
+public:
+
+  /// Geometry of the local cells as computed by their constitutive model,
+  /// entries are invalidated when the particles are advanced
+  map<int,CellGeometry> cellGeometry;
   
     
     //vector<vector<vector<vector<HemoCellParticle*>>>> particle_grid; //maybe better to make custom data structure, But that would be slower
@@ -201,9 +254,14 @@ public:
     plint addParticleCount = 0;
     plb::Box3D localDomain;
     
-    //These should be edited through the helper/solidifyField.h functions
-    std::set<plb::Dot3D> bindingSites;
+    //These should be edited through the helper/bindingField.h functions
     plb::ScalarField3D<bool> * bindingField = 0;
+    /// Number of binding sites in the 3x3x3 neighbourhood of each node, zero
+    /// where no particle can be close enough to solidify
+    plb::ScalarField3D<unsigned char> * nearBindingSite = 0;
+private:
+    /// Scratch tresca stress per lattice node for solidifyCells(), negative when not computed
+    plb::ScalarField3D<T> * trescaField = 0;
 };
 
 }
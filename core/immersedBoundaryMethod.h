@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IMMERSEDBOUNDARYMETHOD_H
 
 #include <vector>
+#include <cmath>
 
 namespace hemo {
 
@@ -40,96 +41,127 @@ inline T phi2 (T x) {
     return max(x,(T)0.0);
 }
 
-template<typename T>
-T phi3 (T x) ;
-
-template<typename T>
-T phi4 (T x) ;
-
-template<typename T>
-T phi4c (T x) ;
+/// Three point kernel of Roma et al. (1999), support |x| < 1.5
+inline T phi3 (T x) {
+    x = fabs(x);
+    if (x <= 0.5) {
+      return (1.0 + sqrt(1.0 - 3.0*x*x))/3.0;
+    }
+    if (x <= 1.5) {
+      const T y = 1.0 - x;
+      return (5.0 - 3.0*x - sqrt(max(1.0 - 3.0*y*y,(T)0.0)))/6.0;
+    }
+    return 0.0;
+}
 
-template<typename T, template<typename U> class Descriptor>
-void interpolationCoefficients (
-        BlockLattice3D<T,Descriptor> const& block, hemo::Array<T,3> const& position,
-        std::vector<Dot3D>& cellPos, std::vector<T>& weights);
+/// Four point kernel of Peskin (2002), support |x| < 2
+inline T phi4 (T x) {
+    x = fabs(x);
+    if (x <= 1.0) {
+      return (3.0 - 2.0*x + sqrt(1.0 + 4.0*x - 4.0*x*x))/8.0;
+    }
+    if (x <= 2.0) {
+      return (5.0 - 2.0*x - sqrt(max(-7.0 + 12.0*x - 4.0*x*x,(T)0.0)))/8.0;
+    }
+    return 0.0;
+}
 
-template<typename T, template<typename U> class Descriptor>
-void interpolationCoefficientsPhi1 (
-        BlockLattice3D<T,Descriptor> const& block, hemo::Array<T,3> const& position,
-        std::vector<Dot3D>& cellPos, std::vector<T>& weights);
+/// Four point cosine kernel, support |x| < 2
+inline T phi4c (T x) {
+    x = fabs(x);
+    if (x < 2.0) {
+      return 0.25*(1.0 + cos(0.5*M_PI*x));
+    }
+    return 0.0;
+}
 
-inline void interpolationCoefficientsPhi2 (
+/*
+ * Computes the kernel nodes and weights of a particle for a kernel phi that
+ * spans W lattice nodes per axis. The kernel is separable, so the 1D weights
+ * are evaluated once per axis (3*W evaluations) and the W^3 node weights are
+ * their products. Nodes on a boundary are skipped and the remaining weights are
+ * normalized to 1, which spreads their share of the force over the fluid nodes
+ * of the kernel. Nodes outside the block are skipped without normalization,
+ * their share belongs to the neighbouring block. The kernel must therefore fit
+ * within the envelope of the lattice (W <= envelope width).
+ */
+template<int W, T(*phi)(T)>
+inline void interpolationCoefficientsSeparable (
         BlockLattice3D<T,DESCRIPTOR> & block, HemoCellParticle & particle)
 {
     //Clean current
     particle.kernelWeights.clear();
-    particle.kernelWeights.reserve(8);
+    particle.kernelWeights.reserve(W*W*W);
     particle.kernelLocations.clear();
+    particle.kernelLocations.reserve(W*W*W);
     #ifdef INTERIOR_VISCOSITY
     particle.kernelCoordinates.clear();
-    particle.kernelCoordinates.reserve(8);
+    particle.kernelCoordinates.reserve(W*W*W);
     #endif
-    
-    // Fixed kernel size
-    const plint x0=-1, x1=2; //const for nice loop unrolling
 
     //Coordinates are relative
-    const Dot3D tmpDot = block.getLocation(); 
-    const hemo::Array<plint,3> relLoc = {tmpDot.x, tmpDot.y, tmpDot.z};
+    const Dot3D tmpDot = block.getLocation();
+    const hemo::Array<T,3> position = {particle.sv.position[0] - tmpDot.x,
+                                       particle.sv.position[1] - tmpDot.y,
+                                       particle.sv.position[2] - tmpDot.z};
 
-    //Get position, relative
-    const hemo::Array<T,3> position_tmp = particle.sv.position;
-    const hemo::Array<T,3> position = {position_tmp[0] -relLoc[0], position_tmp[1]-relLoc[1],position_tmp[2]-relLoc[2]};
-
-    //Get our reference node (0,0)
-    const hemo::Array<plint,3> center({plint(position[0] + 0.5), plint(position[1] + 0.5), plint(position[2] + 0.5)}); 
-    
     //Boundingbox of lattice
     const Box3D boundingBox = block.getBoundingBox();
-    
-    //Prealloc is better than JItalloc
-    hemo::Array<plint,3> posInBlock;
+    const plint lower[3] = {boundingBox.x0, boundingBox.y0, boundingBox.z0};
+    const plint upper[3] = {boundingBox.x1, boundingBox.y1, boundingBox.z1};
+
+    //First node of the kernel, the 1D weights along every axis and whether the
+    //node lies within the block
+    plint first[3];
+    T phi1D[3][W];
+    bool inside[3][W];
+    for (int d = 0; d < 3; ++d) {
+      first[d] = plint(floor(position[d] - 0.5*(W-2)));
+      for (int i = 0; i < W; ++i) {
+        const plint node = first[d] + i;
+        phi1D[d][i] = phi(position[d] - node);
+        inside[d][i] = node >= lower[d] && node <= upper[d];
+      }
+    }
 
-    T phi[3];
-    T weight;
     T total_weight = 0;
-    
-    
-    for (int dx = x0; dx < x1; ++dx) {
-        for (int dy = x0; dy < x1; ++dy) {
-            for (int dz = x0; dz < x1; ++dz) {
-                posInBlock = {center[0] + dx, center[1] + dy, center[2] + dz};
-                
-                //Sanity checks, skip if outside domain or boundary
-                if (!contained_sane(posInBlock,boundingBox)) {
-                  continue;
-                }
-
-                phi[0] = (position[0] - posInBlock[0]); //Get absolute distance
-                phi[1] = (position[1] - posInBlock[1]);
-                phi[2] = (position[2] - posInBlock[2]);
-                weight = phi2(phi[0]) * phi2(phi[1]) * phi2(phi[2]);
-                
-                if (weight  == 0.0){
-                  continue;
-                }
-
-                if (block.get(posInBlock[0],posInBlock[1],posInBlock[2]).getDynamics().isBoundary()) {
-                  continue;
-                }              
-                
-                total_weight+=weight;
-
-                particle.kernelWeights.push_back(weight);
-                particle.kernelLocations.push_back(&block.get(posInBlock[0],posInBlock[1],posInBlock[2]));
-		
-                #ifdef INTERIOR_VISCOSITY
-                // Or create a clone of the method?
-                particle.kernelCoordinates.push_back({posInBlock[0],posInBlock[1],posInBlock[2]});
-                #endif
-            }
+
+    for (int dx = 0; dx < W; ++dx) {
+      if (phi1D[0][dx] == 0.0) {
+        continue;
+      }
+      for (int dy = 0; dy < W; ++dy) {
+        const T weightXY = phi1D[0][dx] * phi1D[1][dy];
+        if (weightXY == 0.0) {
+          continue;
+        }
+        for (int dz = 0; dz < W; ++dz) {
+          const T weight = weightXY * phi1D[2][dz];
+          if (weight == 0.0) {
+            continue;
+          }
+
+          //Outside of the block, still part of the kernel
+          if (!(inside[0][dx] && inside[1][dy] && inside[2][dz])) {
+            total_weight+=weight;
+            continue;
+          }
+
+          plb::Cell<T,DESCRIPTOR> & cell = block.get(first[0]+dx,first[1]+dy,first[2]+dz);
+          if (cell.getDynamics().isBoundary()) {
+            continue;
+          }
+
+          total_weight+=weight;
+
+          particle.kernelWeights.push_back(weight);
+          particle.kernelLocations.push_back(&cell);
+
+          #ifdef INTERIOR_VISCOSITY
+          particle.kernelCoordinates.push_back({first[0]+dx,first[1]+dy,first[2]+dz});
+          #endif
         }
+      }
     }
     const T weight_coeff = 1.0 / total_weight;
     for(T & weight_ : particle.kernelWeights) { //Normalize weight to 1
@@ -137,29 +169,29 @@ inline void interpolationCoefficientsPhi2 (
     }
 }
 
-template<typename T, template<typename U> class Descriptor>
-void interpolationCoefficientsPhi3 (
-    
-        BlockLattice3D<T,Descriptor> const& block, hemo::Array<T,3> const& position,
-        std::vector<Dot3D>& cellPos, std::vector<T>& weights);
-
-void interpolationCoefficientsPhi4 (
-        BlockLattice3D<double,DESCRIPTOR> const& block, hemo::Array<double,3> const& position,
-        std::vector<Dot3D>& cellPos, std::vector<double>& weights);
+/// Two point (linear) kernel, 2x2x2 nodes
+inline void interpolationCoefficientsPhi2 (
+        BlockLattice3D<T,DESCRIPTOR> & block, HemoCellParticle & particle) {
+  interpolationCoefficientsSeparable<2,phi2>(block,particle);
+}
 
-template<typename T, template<typename U> class Descriptor>
-void interpolationCoefficientsPhi4c (
-        BlockLattice3D<T,Descriptor> const& block, hemo::Array<T,3> const& position,
-        std::vector<Dot3D>& cellPos, std::vector<T>& weights);
+/// Three point kernel, 3x3x3 nodes
+inline void interpolationCoefficientsPhi3 (
+        BlockLattice3D<T,DESCRIPTOR> & block, HemoCellParticle & particle) {
+  interpolationCoefficientsSeparable<3,phi3>(block,particle);
+}
 
-/*
- * In case one of the interpolating boundary nodes is a boundary,
- * the force is spread to the rest of the nodes
- * */
-template<typename T, template<typename U> class Descriptor>
-void curateInterpolationCoefficients (BlockLattice3D<T,Descriptor>& fluid,
-        std::vector<Dot3D>& cellPos, std::vector<T>& weights) ;
+/// Four point kernel, 4x4x4 nodes
+inline void interpolationCoefficientsPhi4 (
+        BlockLattice3D<T,DESCRIPTOR> & block, HemoCellParticle & particle) {
+  interpolationCoefficientsSeparable<4,phi4>(block,particle);
+}
 
+/// Four point cosine kernel, 4x4x4 nodes
+inline void interpolationCoefficientsPhi4c (
+        BlockLattice3D<T,DESCRIPTOR> & block, HemoCellParticle & particle) {
+  interpolationCoefficientsSeparable<4,phi4c>(block,particle);
+}
 
 }
 #endif  // IMMERSEDBOUNDARYMETHOD_3D_H
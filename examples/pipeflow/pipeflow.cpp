@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "fluidInfo.h"
 #include "particleInfo.h"
 #include "writeCellInfoCSV.h"
+#include "guoTRTdynamics.h"
 #include <fenv.h>
 
 #include "palabos3D.h"
@@ -63,12 +64,21 @@ int main(int argc, char *argv[]) {
   param::lbm_pipe_parameters((*cfg),flagMatrix.get());
   param::printParameters();
 
+  // Only instantiate atomic blocks that contain fluid when <minBlockSize> is given
+  std::auto_ptr<MultiBlockManagement3D> management(new MultiBlockManagement3D(voxelizedDomain.get()->getMultiBlockManagement()));
+  try {
+    management.reset(createSparseFluidManagement(flagMatrix,
+                                                 (*cfg)["domain"]["blockSize"].read<int>(),
+                                                 (*cfg)["domain"]["minBlockSize"].read<int>(),
+                                                 (*cfg)["domain"]["fluidEnvelope"].read<int>()));
+  } catch (std::invalid_argument & e) {}
+
   hemocell.lattice = new MultiBlockLattice3D<T, DESCRIPTOR>(
-            voxelizedDomain.get()->getMultiBlockManagement(),
+            *management,
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            createFluidDynamics(*cfg, 1.0/param::tau));
 
   defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
 
@@ -55,6 +55,7 @@ namespace hemo {
     for (const plint & bId : multiBindingField->getLocalInfo().getBlocks()) {
       HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
       pf.bindingField = &multiBindingField->getComponent(bId);
+      pf.nearBindingSite = new ScalarField3D<unsigned char>(pf.bindingField->getNx(),pf.bindingField->getNy(),pf.bindingField->getNz(),0);
     }
     
   }
@@ -100,8 +101,11 @@ namespace hemo {
   }  
   
   void bindingFieldHelper::add(HemoCellParticleField & pf, const Dot3D & bindingSite) {
-      pf.bindingSites.insert(bindingSite);
-      pf.bindingField->get(bindingSite.x,bindingSite.y,bindingSite.z) = true;
+    bool & site = pf.bindingField->get(bindingSite.x,bindingSite.y,bindingSite.z);
+    if (!site) {
+      site = true;
+      markNeighbourhood(pf, bindingSite, 1);
+    }
   }
   
   void bindingFieldHelper::add(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites) {
@@ -111,8 +115,11 @@ namespace hemo {
   }
   
   void bindingFieldHelper::remove(HemoCellParticleField & pf, const Dot3D & bindingSite) {
-    pf.bindingSites.erase(bindingSite);
-    pf.bindingField->get(bindingSite.x,bindingSite.y,bindingSite.z) = false;
+    bool & site = pf.bindingField->get(bindingSite.x,bindingSite.y,bindingSite.z);
+    if (site) {
+      site = false;
+      markNeighbourhood(pf, bindingSite, -1);
+    }
   }
   
   void bindingFieldHelper::remove(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites) {
@@ -121,16 +128,28 @@ namespace hemo {
     }
   } 
   
+  void bindingFieldHelper::markNeighbourhood(HemoCellParticleField & pf, const Dot3D & bindingSite, int delta) {
+    ScalarField3D<unsigned char> & mask = *pf.nearBindingSite;
+    for (plint x = std::max(bindingSite.x-1,(plint)0); x <= std::min(bindingSite.x+1,mask.getNx()-1); x++) {
+      for (plint y = std::max(bindingSite.y-1,(plint)0); y <= std::min(bindingSite.y+1,mask.getNy()-1); y++) {
+        for (plint z = std::max(bindingSite.z-1,(plint)0); z <= std::min(bindingSite.z+1,mask.getNz()-1); z++) {
+          mask.get(x,y,z) += delta;
+        }
+      }
+    }
+  }
+  
   void bindingFieldHelper::refillBindingSites() {
     for (const plint & bId : cellFields.domain_immersedParticles->getLocalInfo().getBlocks()) {
       HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
       ScalarField3D<bool> & bf = *pf.bindingField;
+      pf.nearBindingSite->reset();
       Box3D domain = bf.getBoundingBox();
       for (int x = domain.x0; x <= domain.x1 ; x++) {
         for (int y = domain.y0; y <= domain.y1; y++) {
           for (int z = domain.z0; z <= domain.z1; z++) {
             if(bf.get(x,y,z)) {
-              pf.bindingSites.insert({x,y,z});
+              markNeighbourhood(pf, {x,y,z}, 1);
             }
           }
         }
@@ -51,6 +51,8 @@ namespace hemo {
     bindingFieldHelper(HemoCellFields * cellFields);
     ~bindingFieldHelper();
     
+    /// Add delta to the nearBindingSite count of the 3x3x3 nodes around bindingSite
+    void markNeighbourhood(HemoCellParticleField & pf, const Dot3D & bindingSite, int delta);
     void refillBindingSites();
     
     //Singleton Behaviour
@@ -24,306 +24,228 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "cellInfo.h"
 #include "hemocell.h"
 #include "hemoCellParticleField.h"
+#include "geometryUtils.h"
 
 namespace hemo {
 
-  void CellInformationFunctionals::clear_list() {
-  info_per_cell.clear();
-}
-void CellInformationFunctionals::calculate_vol_pos_area(HemoCell* hemocell) {
-  calculateCellArea(hemocell);
-  calculateCellVolume(hemocell);
-  calculateCellPosition(hemocell);
+namespace {
+// Vertex furthest away from point, returns the squared distance
+T furthestVertex(const vector<hemo::Array<T,3>> & vertices, const hemo::Array<T,3> & point, unsigned int & furthest) {
+  T maxDistance = -1.;
+  for (unsigned int i = 0 ; i < vertices.size() ; i++) {
+    const hemo::Array<T,3> d = vertices[i] - point;
+    const T distance = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    if (distance > maxDistance) {
+      maxDistance = distance;
+      furthest = i;
+    }
+  }
+  return maxDistance;
 }
 
-void CellInformationFunctionals::CellVolume::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
+/*
+ * Shape of a cell from its vertices: the principal axes of the vertex
+ * covariance and the stretch (largest vertex distance).
+ *
+ * The exact stretch compares all vertex pairs, O(V^2). Otherwise the search
+ * starts from the extreme vertices along each principal axis and walks twice
+ * to the furthest vertex, O(V). The result is approximate: it is a lower
+ * bound of the exact value, and usually close to it for smooth cell shapes.
+ */
+void computeCellShape(const vector<hemo::Array<T,3>> & vertices, bool exact, CellInformation & cinfo) {
+  hemo::Array<T,3> center = {0.,0.,0.};
+  for (const hemo::Array<T,3> & v : vertices) { center += v; }
+  center /= T(vertices.size());
 
-  for (const auto & pair : pf->get_lpc()) {
-    T volume = 0.;
-    const int & cid = pair.first;
-    const vector<int> & cell = pf->get_particles_per_cell().at(cid);
-    const pluint ctype = pf->particles[cell[0]].sv.celltype;
-    for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
-      const hemo::Array<T,3> & v0 = pf->particles[cell[triangle[0]]].sv.position;
-      const hemo::Array<T,3> & v1 = pf->particles[cell[triangle[1]]].sv.position;
-      const hemo::Array<T,3> & v2 = pf->particles[cell[triangle[2]]].sv.position;
-      
-      //Volume
-      const T v210 = v2[0]*v1[1]*v0[2];
-      const T v120 = v1[0]*v2[1]*v0[2];
-      const T v201 = v2[0]*v0[1]*v1[2];
-      const T v021 = v0[0]*v2[1]*v1[2];
-      const T v102 = v1[0]*v0[1]*v2[2];
-      const T v012 = v0[0]*v1[1]*v2[2];
-      volume += (1.0/6.0)*(-v210+v120+v201-v021-v102+v012);
-    }
-    info_per_cell[cid].volume = volume;
+  hemo::Array<T,6> covariance = {0.,0.,0.,0.,0.,0.};
+  for (const hemo::Array<T,3> & v : vertices) {
+    const hemo::Array<T,3> d = v - center;
+    covariance[0] += d[0]*d[0]; covariance[1] += d[0]*d[1]; covariance[2] += d[0]*d[2];
+    covariance[3] += d[1]*d[1]; covariance[4] += d[1]*d[2]; covariance[5] += d[2]*d[2];
   }
-}
-void CellInformationFunctionals::CellArea::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  
-  for (const auto & pair : pf->get_lpc()) {
-    T total_area = 0.;
-    const int & cid = pair.first;
-    const vector<int> & cell = pf->get_particles_per_cell().at(cid);
-    const pluint ctype = pf->particles[cell[0]].sv.celltype;
-    for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
-      const hemo::Array<T,3> & v0 = pf->particles[cell[triangle[0]]].sv.position;
-      const hemo::Array<T,3> & v1 = pf->particles[cell[triangle[1]]].sv.position;
-      const hemo::Array<T,3> & v2 = pf->particles[cell[triangle[2]]].sv.position;
+  covariance /= T(vertices.size());
 
-      total_area += computeTriangleArea(v0,v1,v2);  
-    }
-    info_per_cell[cid].area = total_area;
+  // A thin ellipsoidal shell with semi-axis a has variance a^2/3 along it
+  const hemo::Array<T,3> lambda = symmetricEigenvalues(covariance);
+  for (int i = 0 ; i < 3 ; i++) {
+    cinfo.principalAxes[i] = 2.*sqrt(3.*std::max(lambda[2-i],T(0.)));
   }
-}
-void CellInformationFunctionals::CellPosition::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  
-  for (const auto & pair : pf->get_lpc()) {
-    hemo::Array<T,3> position = {0.,0.,0.};
-    const int & cid = pair.first;
-    const vector<int> & cell = pf->get_particles_per_cell().at(cid);
-    unsigned int size = 0;
-    for (const int pid : cell ) {
-      if (pid == -1) { continue; }
-      size++;
-      position += pf->particles[pid].sv.position;
-    }
-    if ( info_per_cell.find(cid) == info_per_cell.end() || !info_per_cell[cid].centerLocal) {
-      info_per_cell[cid].position = position/T(size);
-      info_per_cell[cid].centerLocal = pf->isContainedABS(info_per_cell[cid].position,pf->localDomain);
-    } else {
-     
+  cinfo.deformationIndex = cinfo.principalAxes[0] > 0 ?
+    (cinfo.principalAxes[0]-cinfo.principalAxes[2])/(cinfo.principalAxes[0]+cinfo.principalAxes[2]) : 0.;
+  cinfo.majorAxis = symmetricEigenvector(covariance, lambda[2]);
+
+  T maxDistance = 0.;
+  if (exact) {
+    for (unsigned int i = 0 ; i < vertices.size() ; i++) {
+      for (unsigned int j = i + 1 ; j < vertices.size() ; j++) {
+        const hemo::Array<T,3> d = vertices[i] - vertices[j];
+        maxDistance = std::max(maxDistance, d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+      }
     }
-  }
-}
-void CellInformationFunctionals::CellStretch::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  
-  for (const auto & pair : pf->get_lpc()) {
-    T max_stretch = 0.;
-    const int & cid = pair.first;
-    const vector<int> & cell = pf->get_particles_per_cell().at(cid);
-    for (unsigned int i = 0 ; i < cell.size() - 1 ; i++ ) {
-      for (unsigned int j = i + 1 ; j < cell.size() ; j ++) {
-        if (cell[i] == -1 || cell[j] == -1) {continue;}
-        T distance = sqrt( pow(pf->particles[cell[i]].sv.position[0]-pf->particles[cell[j]].sv.position[0],2) +
-                                pow(pf->particles[cell[i]].sv.position[1]-pf->particles[cell[j]].sv.position[1],2) +
-                                pow(pf->particles[cell[i]].sv.position[2]-pf->particles[cell[j]].sv.position[2],2));
-        max_stretch = max_stretch < distance ? distance : max_stretch;
+  } else {
+    for (T l : lambda) {
+      const hemo::Array<T,3> axis = symmetricEigenvector(covariance, l);
+      unsigned int extremes[2] = {0,0};
+      T minProjection = dot(vertices[0],axis), maxProjection = minProjection;
+      for (unsigned int i = 1 ; i < vertices.size() ; i++) {
+        const T projection = dot(vertices[i],axis);
+        if (projection < minProjection) { minProjection = projection; extremes[0] = i; }
+        if (projection > maxProjection) { maxProjection = projection; extremes[1] = i; }
+      }
+      for (unsigned int start : extremes) {
+        unsigned int furthest = start, back = start;
+        maxDistance = std::max(maxDistance, furthestVertex(vertices, vertices[start], furthest));
+        maxDistance = std::max(maxDistance, furthestVertex(vertices, vertices[furthest], back));
       }
     }
-    info_per_cell[cid].stretch = max_stretch;
   }
+  cinfo.stretch = sqrt(maxDistance);
 }
-void CellInformationFunctionals::CellBoundingBox::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  
-  for (const auto & pair : pf->get_lpc()) {
-    hemo::Array<T,6> bbox;
-    const int & cid = pair.first;
-    const vector<int> & cell = pf->get_particles_per_cell().at(cid);
-    HemoCellParticle * particle = &pf->particles[cell[0]];
-    
-    bbox[0] = particle->sv.position[0];
-    bbox[1] = particle->sv.position[0];
-    bbox[2] = particle->sv.position[1];
-    bbox[3] = particle->sv.position[1];
-    bbox[4] = particle->sv.position[2];
-    bbox[5] = particle->sv.position[2];
-    
-    for (const int pid : cell ) {
-      particle = &pf->particles[pid];
-      bbox[0] = bbox[0] > particle->sv.position[0] ? particle->sv.position[0] : bbox[0];
-      bbox[1] = bbox[1] < particle->sv.position[0] ? particle->sv.position[0] : bbox[1];
-      bbox[2] = bbox[2] > particle->sv.position[1] ? particle->sv.position[1] : bbox[2];
-      bbox[3] = bbox[3] < particle->sv.position[1] ? particle->sv.position[1] : bbox[3];
-      bbox[4] = bbox[4] > particle->sv.position[2] ? particle->sv.position[2] : bbox[4];
-      bbox[5] = bbox[5] < particle->sv.position[2] ? particle->sv.position[2] : bbox[5];
-    
-      }
-    info_per_cell[cid].bbox = bbox;
-  }
 }
-void CellInformationFunctionals::CellAtomicBlock::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  
-  for (const auto & pair : pf->get_lpc()) {
-    const int & cid = pair.first;
 
-    info_per_cell[cid].blockId = pf->atomicBlockId;
-  }
+void CellInformationFunctionals::clear_list() {
+  info_per_cell.clear();
 }
-void CellInformationFunctionals::CellType::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  
-  for (const auto & pair : pf->get_lpc()) {
-    const int & cid = pair.first;
-
-    info_per_cell[cid].cellType = pf->particles[pf->get_particles_per_cell().at(cid)[0]].sv.celltype;
-  }
+void CellInformationFunctionals::calculate_vol_pos_area(HemoCell* hemocell) {
+  calculateCellInformation(hemocell, CELLINFO_VOLUME | CELLINFO_AREA);
 }
 
 void CellInformationFunctionals::allCellInformation::processGenericBlocks(plb::Box3D domain, std::vector<plb::AtomicBlock3D*> blocks) {
   HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
   const map<int,vector<int>> & ppc = pf->get_particles_per_cell();
-  
+  vector<hemo::Array<T,3>> vertices;
   
   for (const auto & pair : pf->get_lpc()) {
     const int & cid = pair.first;
-    hemo::Array<T,6> bbox;
     hemo::Array<T,3> position = {0.,0.,0.};
     hemo::Array<T,3> velocity = {0.,0.,0.};
-    T max_stretch = 0., distance = 0.;
-    T total_area = 0., volume = 0.;
     
     if (ppc.find(cid) == ppc.end()) { continue; }
     const vector<int> & cell = ppc.at(cid);
     if (cell[0] == -1) { continue;}
     
-    HemoCellParticle * particle = &pf->particles[cell[0]];
     const pluint ctype = pf->particles[cell[0]].sv.celltype;
-
-    //Bounding box init
-    bbox[0] = particle->sv.position[0];
-    bbox[1] = particle->sv.position[0];
-    bbox[2] = particle->sv.position[1];
-    bbox[3] = particle->sv.position[1];
-    bbox[4] = particle->sv.position[2];
-    bbox[5] = particle->sv.position[2];
+    vertices.clear();
     
-    for (unsigned int i = 0 ; i < cell.size() ; i++ ) {
-      if (cell[i] == -1) { 
+    for (const int & pid : cell) {
+      if (pid == -1) { 
         cout << "(CellInfoFunctional) Warning, incomplete cell detected, removing from output" << endl;
         goto ignore_cell;
       }
-      particle = &pf->particles[cell[i]];
-      
-      //Bounding Box
-      bbox[0] = bbox[0] > particle->sv.position[0] ? particle->sv.position[0] : bbox[0];
-      bbox[1] = bbox[1] < particle->sv.position[0] ? particle->sv.position[0] : bbox[1];
-      bbox[2] = bbox[2] > particle->sv.position[1] ? particle->sv.position[1] : bbox[2];
-      bbox[3] = bbox[3] < particle->sv.position[1] ? particle->sv.position[1] : bbox[3];
-      bbox[4] = bbox[4] > particle->sv.position[2] ? particle->sv.position[2] : bbox[4];
-      bbox[5] = bbox[5] < particle->sv.position[2] ? particle->sv.position[2] : bbox[5];
-      
-      //position
-      position += particle->sv.position;
-      
-      //velocity
-      velocity += particle->sv.v;
-      
-      //Cell stretch (max)
-      for (unsigned int j = i + 1 ; j < cell.size() ; j ++) {
-        if (cell[j] == -1) {goto ignore_cell;}
-        HemoCellParticle * particle2 = &pf->particles[cell[j]];
-        distance = sqrt( pow(particle->sv.position[0]-particle2->sv.position[0],2) +
-                                pow(particle->sv.position[1]-particle2->sv.position[1],2) +
-                                pow(particle->sv.position[2]-particle2->sv.position[2],2));
-        max_stretch = max_stretch < distance ? distance : max_stretch;
+      const HemoCellParticle & particle = pf->particles[pid];
+      vertices.push_back(particle.sv.position);
+      position += particle.sv.position;
+      if (metrics & CELLINFO_VELOCITY) {
+        velocity += particle.sv.v;
       }
-
     }
 
-    for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
-      const hemo::Array<T,3> & v0 = pf->particles[cell[triangle[0]]].sv.position;
-      const hemo::Array<T,3> & v1 = pf->particles[cell[triangle[1]]].sv.position;
-      const hemo::Array<T,3> & v2 = pf->particles[cell[triangle[2]]].sv.position;
+    {
+      CellInformation & cinfo = info_per_cell[cid];
+      cinfo.position = position/T(cell.size());
+      //It could be local on another block on the same processor
+      if (!cinfo.centerLocal) {
+        cinfo.centerLocal = pf->isContainedABS(cinfo.position,pf->localDomain);
+      }
+      cinfo.blockId = pf->atomicBlockId;
+      cinfo.cellType = ctype;
+      cinfo.base_cell_id = hemocell->cellfields->base_cell_id(cid);
 
-      //area
-      total_area += computeTriangleArea(v0,v1,v2);  
-      
-      //Volume
-      const T v210 = v2[0]*v1[1]*v0[2];
-      const T v120 = v1[0]*v2[1]*v0[2];
-      const T v201 = v2[0]*v0[1]*v1[2];
-      const T v021 = v0[0]*v2[1]*v1[2];
-      const T v102 = v1[0]*v0[1]*v2[2];
-      const T v012 = v0[0]*v1[1]*v2[2];
-      volume += (1.0/6.0)*(-v210+v120+v201-v021-v102+v012);
-    }
-    
-    info_per_cell[cid].volume = volume;
-    info_per_cell[cid].area = total_area;
-    info_per_cell[cid].position = position/T(cell.size());
-    info_per_cell[cid].velocity = velocity/T(cell.size());
-    //It could be local on another block on the same processor
-    if (!info_per_cell[cid].centerLocal) {
-      info_per_cell[cid].centerLocal = pf->isContainedABS(info_per_cell[cid].position,pf->localDomain);
-    }
+      if (metrics & CELLINFO_VELOCITY) {
+        cinfo.velocity = velocity/T(cell.size());
+      }
+
+      if (metrics & (CELLINFO_VOLUME | CELLINFO_AREA)) {
+        const auto measured = pf->cellGeometry.find(cid);
+        if (measured != pf->cellGeometry.end() && measured->second.valid) {
+          // Already computed by the constitutive model for these positions
+          if (metrics & CELLINFO_VOLUME) { cinfo.volume = measured->second.volume; }
+          if (metrics & CELLINFO_AREA) { cinfo.area = measured->second.area; }
+        } else {
+          T total_area = 0., volume = 0.;
+          for (const hemo::Array<plint,3> & triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
+            const hemo::Array<T,3> & v0 = vertices[triangle[0]];
+            const hemo::Array<T,3> & v1 = vertices[triangle[1]];
+            const hemo::Array<T,3> & v2 = vertices[triangle[2]];
+
+            //area
+            if (metrics & CELLINFO_AREA) {
+              total_area += computeTriangleArea(v0,v1,v2);
+            }
 
-    info_per_cell[cid].stretch = max_stretch;
-    info_per_cell[cid].blockId = pf->atomicBlockId;
-    info_per_cell[cid].cellType = pf->particles[pf->get_particles_per_cell().at(cid)[0]].sv.celltype;
-    info_per_cell[cid].bbox = bbox;    
-    info_per_cell[cid].base_cell_id = hemocell->cellfields->base_cell_id(cid);
+            //Volume
+            if (metrics & CELLINFO_VOLUME) {
+              const T v210 = v2[0]*v1[1]*v0[2];
+              const T v120 = v1[0]*v2[1]*v0[2];
+              const T v201 = v2[0]*v0[1]*v1[2];
+              const T v021 = v0[0]*v2[1]*v1[2];
+              const T v102 = v1[0]*v0[1]*v2[2];
+              const T v012 = v0[0]*v1[1]*v2[2];
+              volume += (-v210+v120+v201-v021-v102+v012);
+            }
+          }
+          if (metrics & CELLINFO_VOLUME) { cinfo.volume = volume*(1.0/6.0); }
+          if (metrics & CELLINFO_AREA) { cinfo.area = total_area; }
+        }
+      }
+
+      if (metrics & CELLINFO_BOUNDING_BOX) {
+        hemo::Array<T,6> & bbox = cinfo.bbox;
+        bbox = {vertices[0][0],vertices[0][0],vertices[0][1],vertices[0][1],vertices[0][2],vertices[0][2]};
+        for (const hemo::Array<T,3> & v : vertices) {
+          bbox[0] = std::min(bbox[0],v[0]);
+          bbox[1] = std::max(bbox[1],v[0]);
+          bbox[2] = std::min(bbox[2],v[1]);
+          bbox[3] = std::max(bbox[3],v[1]);
+          bbox[4] = std::min(bbox[4],v[2]);
+          bbox[5] = std::max(bbox[5],v[2]);
+        }
+      }
+
+      //Cell stretch and principal axes
+      if (metrics & CELLINFO_SHAPE) {
+        computeCellShape(vertices, global.exactCellStretch, cinfo);
+      }
+    }
 ignore_cell:;
   }
 
 }
 
-void CellInformationFunctionals::calculateCellVolume(HemoCell * hemocell_) {
-  hemocell = hemocell_;
-  hemocell->cellfields->syncEnvelopes();
-  hemocell->cellfields->deleteIncompleteCells(false);
-  vector<MultiBlock3D*> wrapper;
-  wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellVolume(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+void CellInformationFunctionals::calculateCellVolume(HemoCell * hemocell) {
+  calculateCellInformation(hemocell, CELLINFO_VOLUME);
 }
-void CellInformationFunctionals::calculateCellArea(HemoCell * hemocell_) {
-  hemocell = hemocell_;
-  hemocell->cellfields->syncEnvelopes();
-  hemocell->cellfields->deleteIncompleteCells(false);
-  vector<MultiBlock3D*> wrapper;
-  wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellArea(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+void CellInformationFunctionals::calculateCellArea(HemoCell * hemocell) {
+  calculateCellInformation(hemocell, CELLINFO_AREA);
 }
-void CellInformationFunctionals::calculateCellPosition(HemoCell * hemocell_) {
-  hemocell = hemocell_;
-  hemocell->cellfields->syncEnvelopes();
-  hemocell->cellfields->deleteIncompleteCells(false);
-  vector<MultiBlock3D*> wrapper;
-  wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellPosition(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+void CellInformationFunctionals::calculateCellPosition(HemoCell * hemocell) {
+  calculateCellInformation(hemocell, 0);
 }
-void CellInformationFunctionals::calculateCellStretch(HemoCell * hemocell_) {
-  hemocell = hemocell_;
-  hemocell->cellfields->syncEnvelopes();
-  hemocell->cellfields->deleteIncompleteCells(false);
-  vector<MultiBlock3D*> wrapper;
-  wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellStretch(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+void CellInformationFunctionals::calculateCellStretch(HemoCell * hemocell) {
+  calculateCellInformation(hemocell, CELLINFO_SHAPE);
 }
-void CellInformationFunctionals::calculateCellBoundingBox(HemoCell * hemocell_) {
-  hemocell = hemocell_;
-  hemocell->cellfields->syncEnvelopes();
-  hemocell->cellfields->deleteIncompleteCells(false);
-  vector<MultiBlock3D*> wrapper;
-  wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellBoundingBox(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+void CellInformationFunctionals::calculateCellBoundingBox(HemoCell * hemocell) {
+  calculateCellInformation(hemocell, CELLINFO_BOUNDING_BOX);
 }
-void CellInformationFunctionals::calculateCellAtomicBlock(HemoCell* hemocell_) {
-  hemocell = hemocell_;
-  hemocell->cellfields->syncEnvelopes();
-  hemocell->cellfields->deleteIncompleteCells(false);
-  vector<MultiBlock3D*> wrapper;
-  wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellAtomicBlock(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+void CellInformationFunctionals::calculateCellAtomicBlock(HemoCell* hemocell) {
+  calculateCellInformation(hemocell, 0);
 }
-void CellInformationFunctionals::calculateCellType(HemoCell* hemocell_) {
-  hemocell = hemocell_;
+void CellInformationFunctionals::calculateCellType(HemoCell* hemocell) {
+  calculateCellInformation(hemocell, 0);
+}
+void CellInformationFunctionals::calculateCellVelocity(HemoCell* hemocell) {
+  calculateCellInformation(hemocell, CELLINFO_VELOCITY);
+}
+void CellInformationFunctionals::calculateCellInformation(HemoCell* hemocell, unsigned int metrics) {
   hemocell->cellfields->syncEnvelopes();
   hemocell->cellfields->deleteIncompleteCells(false);
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(hemocell->cellfields->immersedParticles);
-  applyProcessingFunctional(new CellType(),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+  applyProcessingFunctional(new allCellInformation(hemocell,info_per_cell,metrics),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
 }
 pluint CellInformationFunctionals::getTotalNumberOfCells(HemoCell* hemocell) {
   info_per_cell.clear(); //TODO thread safe n such
-  calculateCellPosition(hemocell); //Any functional will do
+  calculateCellInformation(hemocell, 0);
   pluint localCells = 0;
   for (const auto & pair : info_per_cell) {
     const CellInformation & cinfo = pair.second;
@@ -331,20 +253,14 @@ pluint CellInformationFunctionals::getTotalNumberOfCells(HemoCell* hemocell) {
       localCells++;
     }
   }
-  map<int,pluint> cells_per_proc;
-  cells_per_proc[global::mpi().getRank()] = localCells;
-  HemoCellGatheringFunctional<pluint>::gather(cells_per_proc);
-  pluint total = 0;
-  for (const auto & pair : cells_per_proc) {
-    total += pair.second;
-  }
+  unsigned long long local = localCells, total = 0;
+  MPI_Allreduce(&local,&total,1,MPI_UNSIGNED_LONG_LONG,MPI_SUM,MPI_COMM_WORLD);
   info_per_cell.clear();
   return total;
 }
 pluint CellInformationFunctionals::getNumberOfCellsFromType(HemoCell* hemocell, string type) {
   info_per_cell.clear(); //TODO thread safe n such
-  calculateCellPosition(hemocell); 
-  calculateCellType(hemocell);
+  calculateCellInformation(hemocell, 0);
   pluint localCells = 0;
   for (const auto & pair : info_per_cell) {
     const CellInformation & cinfo = pair.second;
@@ -353,41 +269,24 @@ pluint CellInformationFunctionals::getNumberOfCellsFromType(HemoCell* hemocell,
     }
   }
   
-  map<int,pluint> cells_per_proc;
-  cells_per_proc[global::mpi().getRank()] = localCells;
-  HemoCellGatheringFunctional<pluint>::gather(cells_per_proc);
-  pluint total = 0;
-  for (const auto & pair : cells_per_proc) {
-    total += pair.second;
-  }
+  unsigned long long local = localCells, total = 0;
+  MPI_Allreduce(&local,&total,1,MPI_UNSIGNED_LONG_LONG,MPI_SUM,MPI_COMM_WORLD);
   info_per_cell.clear();
   return total;
 }
 
-void CellInformationFunctionals::calculateCellInformation(HemoCell * hemocell, map<int, CellInformation> & ret) {
+void CellInformationFunctionals::calculateCellInformation(HemoCell * hemocell, map<int, CellInformation> & ret, unsigned int metrics) {
   // Make it saver by not using static objects in functional;
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(hemocell->cellfields->immersedParticles);
   
   hemocell->cellfields->syncEnvelopes();
 
-  applyProcessingFunctional(new allCellInformation(hemocell,ret),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+  applyProcessingFunctional(new allCellInformation(hemocell,ret,metrics),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
 }
 
-
-
-CellInformationFunctionals::CellVolume * CellInformationFunctionals::CellVolume::clone() const { return new CellInformationFunctionals::CellVolume(*this);}
-CellInformationFunctionals::CellArea * CellInformationFunctionals::CellArea::clone() const { return new CellInformationFunctionals::CellArea(*this);}
-CellInformationFunctionals::CellPosition * CellInformationFunctionals::CellPosition::clone() const { return new CellInformationFunctionals::CellPosition(*this);}
-CellInformationFunctionals::CellStretch * CellInformationFunctionals::CellStretch::clone() const { return new CellInformationFunctionals::CellStretch(*this);}
-CellInformationFunctionals::CellBoundingBox * CellInformationFunctionals::CellBoundingBox::clone() const { return new CellInformationFunctionals::CellBoundingBox(*this);}
-CellInformationFunctionals::CellAtomicBlock * CellInformationFunctionals::CellAtomicBlock::clone() const { return new CellInformationFunctionals::CellAtomicBlock(*this);}
-CellInformationFunctionals::CellType * CellInformationFunctionals::CellType::clone() const { return new CellInformationFunctionals::CellType(*this);}
 CellInformationFunctionals::allCellInformation * CellInformationFunctionals::allCellInformation::clone() const { return new CellInformationFunctionals::allCellInformation(*this);}
 
-
-
 map<int,CellInformation> CellInformationFunctionals::info_per_cell = map<int,CellInformation>();
-HemoCell * CellInformationFunctionals::hemocell = 0;
 
-}
\ No newline at end of file
+}
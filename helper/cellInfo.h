@@ -31,9 +31,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* THIS CLASS IS NOT THREAD SAFE!*/
 /* Calculate and store Cell-Specific Information
  * 
- * call the static members for the information you need 
- * (eg. CellInformationFunctionals::getCellVolume(hemocell))
- * then the information will be available in  the map:
+ * Every request is a single pass over the local cells that computes only the
+ * metrics selected by a CellInformationMetric mask, e.g.
+ *  CellInformationFunctionals::calculateCellInformation(hemocell, CELLINFO_VOLUME | CELLINFO_AREA)
+ * the information is then available in the map:
  *  CellInformationFunctionals::info_per_cell
  * Clean the old cell results afterwards with 
  *  CellInformationFunctionals::clear_list()
@@ -46,7 +47,14 @@ struct CellInformation {
   hemo::Array<T,3> velocity = {};
   T volume = 0;
   T area = 0;
-  T stretch = 0;
+  T stretch = 0; // Largest vertex distance, see global.exactCellStretch
+  /// Diameters of the ellipsoidal shell with the same vertex covariance as the
+  /// cell, largest first
+  hemo::Array<T,3> principalAxes = {};
+  /// Unit direction of the largest principal axis (sign is arbitrary)
+  hemo::Array<T,3> majorAxis = {};
+  /// (largest - smallest)/(largest + smallest) principal axis, 0 for a sphere
+  T deformationIndex = 0;
   hemo::Array<T,6> bbox = {};
   pluint blockId = UINTMAX_MAX;
   pluint cellType = UINTMAX_MAX;
@@ -54,46 +62,25 @@ struct CellInformation {
   int base_cell_id = 0;
 };
 
+/// Metrics computed by CellInformationFunctionals, combine them with |. The
+/// position, cell type, atomic block and base cell id are always filled in.
+enum CellInformationMetric : unsigned int {
+  CELLINFO_VOLUME = 1 << 0,
+  CELLINFO_AREA = 1 << 1,
+  CELLINFO_VELOCITY = 1 << 2,
+  CELLINFO_SHAPE = 1 << 3, ///< Stretch, principal axes and deformation index
+  CELLINFO_BOUNDING_BOX = 1 << 4,
+  CELLINFO_ALL = (1 << 5) - 1
+};
+
 class CellInformationFunctionals {
-  // Legacy interface, remove at some point
-  static HemoCell * hemocell;
-  
-  class CellVolume: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellVolume * clone() const;
-  };
-  class CellArea: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellArea * clone() const;
-  };
-  class CellPosition: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellPosition * clone() const;
-  };
-  class CellStretch: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellStretch * clone() const;
-  };
-  class CellBoundingBox: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellBoundingBox * clone() const;
-  };
-  class CellAtomicBlock: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellAtomicBlock * clone() const;
-  };
-  class CellType: public HemoCellFunctional {
-  void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
-    CellType * clone() const;
-  };
-  //end legacy interface
-  
   class allCellInformation: public HemoCellFunctional {
     HemoCell * hemocell;
     map<int,CellInformation> & info_per_cell;
+    unsigned int metrics;
   public:
-    allCellInformation(HemoCell * hemocell_, map<int,CellInformation> & info_per_cell_) :
-    hemocell(hemocell_), info_per_cell(info_per_cell_) {}
+    allCellInformation(HemoCell * hemocell_, map<int,CellInformation> & info_per_cell_, unsigned int metrics_) :
+    hemocell(hemocell_), info_per_cell(info_per_cell_), metrics(metrics_) {}
   private:
     void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
     allCellInformation * clone() const;
@@ -104,7 +91,7 @@ public:
   // Legacy interface, should become private at some point.
   static map<int,CellInformation> info_per_cell;
   static void clear_list();
-  static void calculate_vol_pos_area(HemoCell *); /*This excludes Stretch, since it is compute intensive!*/
+  static void calculate_vol_pos_area(HemoCell *);
   static void calculateCellVolume(HemoCell *);
   static void calculateCellArea(HemoCell *);
   static void calculateCellPosition(HemoCell *);
@@ -113,12 +100,14 @@ public:
   static void calculateCellAtomicBlock(HemoCell *);
   static void calculateCellType(HemoCell *);
   static void calculateCellVelocity(HemoCell *);
+  /// Add the metrics (a CellInformationMetric mask) of all local cells to info_per_cell
+  static void calculateCellInformation(HemoCell *, unsigned int metrics);
   
   //Interface that should be used, less error prone at the cost of some extra computation and memory usage 
   static pluint getTotalNumberOfCells(HemoCell *);
   static pluint getNumberOfCellsFromType(HemoCell *, string type);
-  /// Calculate all possible macroscopic information and return it within the reference.
-  static void calculateCellInformation(HemoCell *, map<int, CellInformation> &);
+  /// Calculate the selected metrics (all by default) and return them within the reference.
+  static void calculateCellInformation(HemoCell *, map<int, CellInformation> &, unsigned int metrics = CELLINFO_ALL);
   
 };
 }
@@ -60,7 +60,7 @@ void GatherFluidVelocity::processGenericBlocks(Box3D domain, std::vector<AtomicB
     
     gatherValues[pf->atomicBlockId].min = min;
     gatherValues[pf->atomicBlockId].max = max;
-    gatherValues[pf->atomicBlockId].avg = avg/ncells;
+    gatherValues[pf->atomicBlockId].avg = ncells ? avg/ncells : 0.;
     gatherValues[pf->atomicBlockId].ncells = ncells;
 }
 void GatherFluidForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
@@ -89,13 +89,14 @@ void GatherFluidForce::processGenericBlocks(Box3D domain, std::vector<AtomicBloc
             max = max < vel ? vel : max;
           }
           avg += vel;
+          ncells++;
         }
       }
     }
     
     gatherValues[pf->atomicBlockId].min = min;
     gatherValues[pf->atomicBlockId].max = max;
-    gatherValues[pf->atomicBlockId].avg = avg/ncells;
+    gatherValues[pf->atomicBlockId].avg = ncells ? avg/ncells : 0.;
     gatherValues[pf->atomicBlockId].ncells = ncells;
 }
 
@@ -106,23 +107,18 @@ FluidStatistics FluidInfo::calculateVelocityStatistics(HemoCell* hemocell) {
   wrapper.push_back(hemocell->cellfields->lattice);
   wrapper.push_back(hemocell->cellfields->immersedParticles);
   applyProcessingFunctional(new GatherFluidVelocity(gatherValues),hemocell->cellfields->lattice->getBoundingBox(),wrapper);
-  HemoCellGatheringFunctional<FluidStatistics>::gather(gatherValues);
-  
-  FluidStatistics result = gatherValues.begin()->second;
-  result.avg = 0.;
-  result.ncells = 0;
-  
-  for (const auto & pair : gatherValues) {
-    const FluidStatistics & cur = pair.second;
-    result.avg += (cur.avg * cur.ncells);
-    result.ncells += cur.ncells;
-    result.min = result.min > cur.min ? cur.min : result.min;
-    result.max = result.max < cur.max ? cur.max : result.max;
-  }
-  
-  result.avg /= result.ncells;
 
-  return result;
+  return HemoCellGatheringFunctional<FluidStatistics>::reduce(gatherValues);
+}
+void FluidInfo::calculateVelocityStatistics(HemoCell* hemocell, PendingStatistics & pending) {
+  map<int,FluidStatistics> gatherValues;
+
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(hemocell->cellfields->lattice);
+  wrapper.push_back(hemocell->cellfields->immersedParticles);
+  applyProcessingFunctional(new GatherFluidVelocity(gatherValues),hemocell->cellfields->lattice->getBoundingBox(),wrapper);
+
+  HemoCellGatheringFunctional<FluidStatistics>::ireduce(gatherValues,pending);
 }
 FluidStatistics FluidInfo::calculateForceStatistics(HemoCell* hemocell) {
   pcout << "(FLuidInfo) (CalculateForceStatistics) Warning! You must reapply any external force after calling this function!" << endl;
@@ -134,21 +130,7 @@ FluidStatistics FluidInfo::calculateForceStatistics(HemoCell* hemocell) {
   wrapper.push_back(hemocell->cellfields->lattice);
   wrapper.push_back(hemocell->cellfields->immersedParticles);
   applyProcessingFunctional(new GatherFluidForce(gatherValues),hemocell->cellfields->lattice->getBoundingBox(),wrapper);
-  HemoCellGatheringFunctional<FluidStatistics>::gather(gatherValues);
-  
-  FluidStatistics result = gatherValues.begin()->second;
-  result.avg = 0.;
-  result.ncells = 0;
-  
-  for (const auto & pair : gatherValues) {
-    const FluidStatistics & cur = pair.second;
-    result.avg += (cur.avg * cur.ncells);
-    result.ncells += cur.ncells;
-    result.min = result.min > cur.min ? cur.min : result.min;
-    result.max = result.max < cur.max ? cur.max : result.max;
-  }
-  
-  result.avg /= result.ncells;
+  FluidStatistics result = HemoCellGatheringFunctional<FluidStatistics>::reduce(gatherValues);
 
   plb::setExternalVector(*hemocell->lattice, (*hemocell->lattice).getBoundingBox(),
           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
@@ -35,6 +35,18 @@ struct FluidStatistics {
   double max;
   double avg;
   pluint ncells;
+
+  /// Merge two partial statistics (reduction operator), empty ones are ignored
+  static FluidStatistics combine(FluidStatistics const & a, FluidStatistics const & b) {
+    if (!a.ncells) { return b; }
+    if (!b.ncells) { return a; }
+    FluidStatistics r;
+    r.min = a.min < b.min ? a.min : b.min;
+    r.max = a.max > b.max ? a.max : b.max;
+    r.ncells = a.ncells + b.ncells;
+    r.avg = (a.avg*a.ncells + b.avg*b.ncells)/r.ncells;
+    return r;
+  }
 };
 
 class GatherFluidVelocity : public HemoCellGatheringFunctional<FluidStatistics> {
@@ -51,8 +63,13 @@ class GatherFluidForce : public HemoCellGatheringFunctional<FluidStatistics> {
 };
 class FluidInfo {
 public:
+  typedef HemoCellGatheringFunctional<FluidStatistics>::PendingReduction PendingStatistics;
+
   static FluidStatistics calculateVelocityStatistics(HemoCell * hemocell_);
   static FluidStatistics calculateForceStatistics(HemoCell * hemocell_);
+
+  /// Non-blocking variant, the statistics are available from pending.wait()
+  static void calculateVelocityStatistics(HemoCell * hemocell_, PendingStatistics & pending);
 };
 
 }
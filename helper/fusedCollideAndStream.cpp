@@ -0,0 +1,303 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fusedCollideAndStream.h"
+#include "guoBodyForceDynamics.h"
+#include "hemoCellParticleField.h"
+#include "logfile.h"
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <typeinfo>
+#include <vector>
+
+namespace hemo {
+
+namespace {
+typedef plb::Cell<T,DESCRIPTOR> FluidCell;
+typedef DESCRIPTOR<T> Lattice;
+static const plint half = Lattice::q/2;
+
+/// How the nodes with one dynamics object are collided
+struct CollisionKind {
+  plb::Dynamics<T,DESCRIPTOR> * dynamics;
+  bool guo;        // Inline Guo forced BGK, otherwise the virtual collide()
+  T omega;
+  T bodyForce[3];
+};
+
+/// The dynamics objects met in a block, classified on first sight
+class CollisionKinds {
+public:
+  void clear() {
+    kinds.clear();
+    last = -1;
+  }
+
+  const CollisionKind & of(FluidCell & cell) {
+    plb::Dynamics<T,DESCRIPTOR> * dynamics = &cell.getDynamics();
+    if (last >= 0 && kinds[last].dynamics == dynamics) {
+      return kinds[last];
+    }
+    for (last = 0 ; last < (int)kinds.size() ; last++) {
+      if (kinds[last].dynamics == dynamics) {
+        return kinds[last];
+      }
+    }
+    CollisionKind kind = {dynamics, false, 0, {0, 0, 0}};
+    if (typeid(*dynamics) == typeid(GuoBodyForceBGKdynamics<T,DESCRIPTOR>)) {
+      const plb::Array<T,3> & bodyForce = static_cast<GuoBodyForceBGKdynamics<T,DESCRIPTOR> *>(dynamics)->getBodyForce();
+      kind.guo = true;
+      kind.omega = dynamics->getOmega();
+      for (int d = 0 ; d < 3 ; d++) {
+        kind.bodyForce[d] = bodyForce[d];
+      }
+    } else if (typeid(*dynamics) == typeid(plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>)) {
+      kind.guo = true;
+      kind.omega = dynamics->getOmega();
+    }
+    kinds.push_back(kind);
+    last = kinds.size()-1;
+    return kinds[last];
+  }
+private:
+  std::vector<CollisionKind> kinds;
+  int last = -1;
+};
+
+/// Guo forced BGK collision, same arithmetic as GuoExternalForceBGKdynamics::collide().
+/// The force is the external force (unless readExternal is false), the spread force if any and the body force
+inline void collideGuo(FluidCell & cell, const CollisionKind & kind, const T omega, const T * spread, bool readExternal) {
+  T force[3] = {0, 0, 0};
+  if (readExternal) {
+    const T * external = cell.getExternal(Lattice::ExternalField::forceBeginsAt);
+    for (int d = 0 ; d < 3 ; d++) {
+      force[d] = external[d];
+    }
+  }
+  if (spread) {
+    for (int d = 0 ; d < 3 ; d++) {
+      force[d] += spread[d];
+    }
+  }
+  for (int d = 0 ; d < 3 ; d++) {
+    force[d] += kind.bodyForce[d];
+  }
+
+  T rhoBar = 0;
+  T j[3] = {0, 0, 0};
+  for (plint iPop = 0 ; iPop < Lattice::q ; iPop++) {
+    rhoBar += cell[iPop];
+    j[0] += Lattice::c[iPop][0]*cell[iPop];
+    j[1] += Lattice::c[iPop][1]*cell[iPop];
+    j[2] += Lattice::c[iPop][2]*cell[iPop];
+  }
+  const T invRho = Lattice::invRho(rhoBar);
+  const T rho = Lattice::fullRho(rhoBar);
+  T u[3];
+  for (int d = 0 ; d < 3 ; d++) {
+    u[d] = j[d]*invRho + force[d]/(T)2;
+    j[d] = rho*u[d];
+  }
+  const T jSqr = j[0]*j[0] + j[1]*j[1] + j[2]*j[2];
+  const T forceAmplitude = (T)1 - omega/(T)2;
+
+  for (plint iPop = 0 ; iPop < Lattice::q ; iPop++) {
+    const T c_j = Lattice::c[iPop][0]*j[0] + Lattice::c[iPop][1]*j[1] + Lattice::c[iPop][2]*j[2];
+    const T equilibrium = Lattice::t[iPop] * (rhoBar + Lattice::invCs2*c_j +
+                          Lattice::invCs2/(T)2 * invRho * (Lattice::invCs2*c_j*c_j - jSqr));
+    const T c_u = (Lattice::c[iPop][0]*u[0] + Lattice::c[iPop][1]*u[1] + Lattice::c[iPop][2]*u[2])
+                  * Lattice::invCs2 * Lattice::invCs2;
+    T forceTerm = 0;
+    for (int d = 0 ; d < 3 ; d++) {
+      forceTerm += (((T)Lattice::c[iPop][d] - u[d])*Lattice::invCs2 + c_u*Lattice::c[iPop][d]) * force[d];
+    }
+    cell[iPop] *= (T)1 - omega;
+    cell[iPop] += omega*equilibrium;
+    cell[iPop] += Lattice::t[iPop]*forceAmplitude*forceTerm;
+  }
+}
+
+/// Collide and stream one atomic block, the steps of BlockLattice3D::collideAndStream(Box3D).
+/// interiorTau has the shape of the atomic block, so it is indexed like the cells, or is null.
+/// spreadForce holds the spread force of the nodes of the block, or is null
+void collideAndStreamBlock(plb::BlockLattice3D<T,DESCRIPTOR> & lattice, CollisionKinds & kinds, plb::ScalarField3D<T> * tauField,
+                           const IbmForceTiles * spreadForce, bool readExternal) {
+  const plb::Box3D box = lattice.getBoundingBox();
+  const plint nx = box.getNx(), ny = box.getNy(), nz = box.getNz();
+  if (tauField && (tauField->getNx() != nx || tauField->getNy() != ny || tauField->getNz() != nz)) {
+    hlog << "(HemoCell) (FusedCollideAndStream) The interior viscosity field is " << tauField->getNx() << "x" << tauField->getNy() << "x" << tauField->getNz()
+         << " nodes but the atomic block of the fluid is " << nx << "x" << ny << "x" << nz << ", exiting ..." << std::endl;
+    exit(1);
+  }
+  const T * interiorTau = tauField ? &tauField->get(0,0,0) : 0;
+  plb::BlockStatistics & statistics = lattice.getInternalStatistics();
+  FluidCell * cells = &lattice.get(0,0,0); // Stored contiguously with z varying fastest
+  if (spreadForce && spreadForce->storage() != cells) {
+    hlog << "(HemoCell) (FusedCollideAndStream) The spread force was not accumulated for this atomic block of the fluid, exiting ..." << std::endl;
+    exit(1);
+  }
+  plint neighbour[half+1];
+  for (plint iPop = 1 ; iPop <= half ; iPop++) {
+    neighbour[iPop] = (Lattice::c[iPop][0]*ny + Lattice::c[iPop][1])*nz + Lattice::c[iPop][2];
+  }
+  kinds.clear();
+
+  auto collide = [&](FluidCell & cell, plint index) {
+    const CollisionKind & kind = kinds.of(cell);
+    const T * spread = spreadForce ? spreadForce->find(index) : 0;
+    if (kind.guo) {
+      const T tau = interiorTau ? interiorTau[index] : 0;
+      collideGuo(cell, kind, tau ? 1/tau : kind.omega, spread, readExternal);
+    } else if (spread) {
+      // Other dynamics read the force from the lattice, it only holds the spread force during their collision
+      T * external = cell.getExternal(Lattice::ExternalField::forceBeginsAt);
+      const T saved[3] = {external[0], external[1], external[2]};
+      for (int d = 0 ; d < 3 ; d++) {
+        external[d] += spread[d];
+      }
+      cell.collide(statistics);
+      for (int d = 0 ; d < 3 ; d++) {
+        external[d] = saved[d];
+      }
+    } else {
+      cell.collide(statistics);
+    }
+  };
+
+  // The outer layer of the block, the neighbours of its nodes are not all in the block
+  const plb::Box3D shell[6] = {
+    plb::Box3D(0,0, 0,ny-1, 0,nz-1), plb::Box3D(nx-1,nx-1, 0,ny-1, 0,nz-1),
+    plb::Box3D(1,nx-2, 0,0, 0,nz-1), plb::Box3D(1,nx-2, ny-1,ny-1, 0,nz-1),
+    plb::Box3D(1,nx-2, 1,ny-2, 0,0), plb::Box3D(1,nx-2, 1,ny-2, nz-1,nz-1) };
+
+  for (const plb::Box3D & domain : shell) {
+    for (plint iX = domain.x0 ; iX <= domain.x1 ; iX++) {
+      for (plint iY = domain.y0 ; iY <= domain.y1 ; iY++) {
+        for (plint iZ = domain.z0 ; iZ <= domain.z1 ; iZ++) {
+          const plint index = (iX*ny + iY)*nz + iZ;
+          FluidCell & cell = cells[index];
+          collide(cell, index);
+          cell.revert();
+        }
+      }
+    }
+  }
+
+  // Bulk: collide, then swap with the (already collided) neighbours
+  for (plint iX = 1 ; iX < nx-1 ; iX++) {
+    for (plint iY = 1 ; iY < ny-1 ; iY++) {
+      plint index = (iX*ny + iY)*nz + 1;
+      for (plint iZ = 1 ; iZ < nz-1 ; iZ++, index++) {
+        FluidCell & cell = cells[index];
+        collide(cell, index);
+        for (plint iPop = 1 ; iPop <= half ; iPop++) {
+          FluidCell & next = cells[index + neighbour[iPop]];
+          const T fTmp = cell[iPop];
+          cell[iPop] = cell[iPop+half];
+          cell[iPop+half] = next[iPop];
+          next[iPop] = fTmp;
+        }
+      }
+    }
+  }
+
+  // Finish the streaming of the outer layer
+  for (const plb::Box3D & domain : shell) {
+    for (plint iX = domain.x0 ; iX <= domain.x1 ; iX++) {
+      for (plint iY = domain.y0 ; iY <= domain.y1 ; iY++) {
+        for (plint iZ = domain.z0 ; iZ <= domain.z1 ; iZ++) {
+          const plint index = (iX*ny + iY)*nz + iZ;
+          for (plint iPop = 1 ; iPop <= half ; iPop++) {
+            const plint nextX = iX + Lattice::c[iPop][0];
+            const plint nextY = iY + Lattice::c[iPop][1];
+            const plint nextZ = iZ + Lattice::c[iPop][2];
+            if (nextX >= 0 && nextX < nx && nextY >= 0 && nextY < ny && nextZ >= 0 && nextZ < nz) {
+              std::swap(cells[index][iPop+half], cells[index + neighbour[iPop]][iPop]);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/// Processes the lattice, then the interior viscosity field and the particle field when they are used
+class FusedCollideAndStreamFunctional : public plb::BoxProcessingFunctional3D {
+public:
+  FusedCollideAndStreamFunctional(bool withTau_, bool withSpreadForce_, bool readExternal_)
+    : withTau(withTau_), withSpreadForce(withSpreadForce_), readExternal(readExternal_) {}
+  // The whole atomic block is processed, as lattice.collideAndStream() does
+  virtual void processGenericBlocks(plb::Box3D domain, std::vector<plb::AtomicBlock3D*> blocks) {
+    plb::BlockLattice3D<T,DESCRIPTOR> & lattice = dynamic_cast<plb::BlockLattice3D<T,DESCRIPTOR>&>(*blocks[0]);
+    unsigned int next = 1;
+    plb::ScalarField3D<T> * interiorTau = withTau ? &dynamic_cast<plb::ScalarField3D<T>&>(*blocks[next++]) : 0;
+    const IbmForceTiles * spreadForce = withSpreadForce ? &dynamic_cast<HemoCellParticleField&>(*blocks[next++]).forceTiles : 0;
+    collideAndStreamBlock(lattice, kinds, interiorTau, spreadForce, readExternal);
+  }
+  virtual FusedCollideAndStreamFunctional * clone() const {
+    return new FusedCollideAndStreamFunctional(*this);
+  }
+  virtual void getTypeOfModification(std::vector<plb::modif::ModifT> & modified) const {
+    modified[0] = plb::modif::staticVariables;
+    for (pluint i = 1 ; i < modified.size() ; i++) {
+      modified[i] = plb::modif::nothing;
+    }
+  }
+  virtual plb::BlockDomain::DomainT appliesTo() const {
+    return plb::BlockDomain::bulkAndEnvelope;
+  }
+private:
+  bool withTau, withSpreadForce, readExternal;
+  CollisionKinds kinds;
+};
+}
+
+bool fusedCollideAndStreamApplies(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice) {
+  return !lattice.isInternalStatisticsOn();
+}
+
+bool fusedCollideAndStreamInlines(plb::Dynamics<T,DESCRIPTOR> & dynamics) {
+  return typeid(dynamics) == typeid(GuoBodyForceBGKdynamics<T,DESCRIPTOR>) ||
+         typeid(dynamics) == typeid(plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>);
+}
+
+void fusedCollideAndStream(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice, plb::MultiScalarField3D<T> * interiorTau,
+                           plb::MultiBlock3D * spreadForce, bool readExternal) {
+  static_assert(DESCRIPTOR<T>::q == 19 && DESCRIPTOR<T>::d == 3, "The fused kernel is written for the D3Q19 lattice");
+  std::vector<plb::MultiBlock3D*> blocks;
+  blocks.push_back(&lattice);
+  if (interiorTau) {
+    blocks.push_back(interiorTau);
+  }
+  if (spreadForce) {
+    blocks.push_back(spreadForce);
+  }
+  plb::applyProcessingFunctional(new FusedCollideAndStreamFunctional(interiorTau != 0, spreadForce != 0, readExternal || !spreadForce),
+                                 lattice.getBoundingBox(), blocks);
+  lattice.executeInternalProcessors();
+  lattice.incrementTime();
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_FUSEDCOLLIDEANDSTREAM_H
+#define HEMO_FUSEDCOLLIDEANDSTREAM_H
+
+#include "constant_defaults.h"
+#include "multiBlock/multiBlockLattice3D.h"
+#include "multiBlock/multiDataField3D.h"
+
+namespace hemo {
+  /**
+   * Collide and stream the fluid with a HemoCell-owned kernel for the
+   * ForcedD3Q19 lattice.
+   *
+   * Nodes whose dynamics is exactly GuoExternalForceBGKdynamics or
+   * GuoBodyForceBGKdynamics (nearly all bulk nodes, including the interior
+   * viscosity clones) are collided inline, without a virtual call per node.
+   * The parameters of every dynamics object are looked up once per block and
+   * iteration, and a node only compares its dynamics pointer with the one of
+   * the previous node. All other nodes (walls, boundary conditions) take the
+   * generic Dynamics::collide() path. Streaming is done in place in the same
+   * pass, with the swap scheme of Palabos, so the result is that of
+   * lattice.collideAndStream().
+   *
+   * When interiorTau is given (the interior viscosity field, with the same
+   * atomic blocks, envelope included, as lattice), inline nodes with a nonzero tau in it relax
+   * with that tau instead of the one of their dynamics. Interior viscosity
+   * then only writes the field, see InteriorViscosityHelper.
+   *
+   * When spreadForce is given (the immersed particle field, with the same
+   * atomic blocks as lattice), every node also gets the force that the
+   * particles spread in the IbmForceTiles of their HemoCellParticleField, see
+   * HemoCellFields::spreadForceInTiles. Nodes without force in the tiles do
+   * not look further, so the spread force costs no lattice traffic outside
+   * the kernels of the particles. With readExternal false the inline nodes
+   * do not read the external force of the lattice either, which is only
+   * valid when it is zero (HemoCell::enableSparseForceReset()).
+   *
+   * Enabled with <parameters><fusedCollideAndStream> in the config, used by
+   * HemoCell::iterate() when fusedCollideAndStreamApplies().
+   */
+  void fusedCollideAndStream(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice,
+                             plb::MultiScalarField3D<T> * interiorTau = 0,
+                             plb::MultiBlock3D * spreadForce = 0, bool readExternal = true);
+
+  /// The fused kernel skips the internal statistics, so it is only used without them
+  bool fusedCollideAndStreamApplies(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice);
+
+  /// Whether nodes with this dynamics are collided inline, and thus read their tau from interiorTau
+  bool fusedCollideAndStreamInlines(plb::Dynamics<T,DESCRIPTOR> & dynamics);
+}
+
+#endif
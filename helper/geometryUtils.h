@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "array.h"
 #include "constant_defaults.h"
+#include <algorithm>
+#include <cmath>
 
 /*
 - returns atan2((Va x Vb) . Vn, Va . Vb)
@@ -51,4 +53,62 @@ inline T getAngleBetweenFaces(const hemo::Array<T,3> n1, const hemo::Array<T,3>
 	return std::atan2(dot(cross, edge), dot(n1, n2));
 };
 
+/*
+Eigenvalues of the symmetric 3x3 matrix {{xx,xy,xz},{xy,yy,yz},{xz,yz,zz}},
+given as {xx,xy,xz,yy,yz,zz} (the palabos SymmetricTensor order), in ascending
+order. Closed form (Smith, 1961): with q = tr(A)/3, p = sqrt(tr((A-qI)^2)/6)
+and B = (A-qI)/p, the eigenvalues are q + 2p cos(phi + 2k pi/3), where
+phi = acos(det(B)/2)/3.
+*/
+inline hemo::Array<T,3> symmetricEigenvalues(const hemo::Array<T,6> & a) {
+  const T p1 = a[1]*a[1] + a[2]*a[2] + a[4]*a[4];
+  if (p1 == 0) { // Diagonal
+    hemo::Array<T,3> d = {a[0],a[3],a[5]};
+    std::sort(d.begin(),d.end());
+    return d;
+  }
+  const T q = (a[0]+a[3]+a[5])/3.;
+  const T b00 = a[0]-q, b11 = a[3]-q, b22 = a[5]-q;
+  const T p = std::sqrt((b00*b00 + b11*b11 + b22*b22 + 2.*p1)/6.);
+  const T detB = b00*(b11*b22 - a[4]*a[4]) - a[1]*(a[1]*b22 - a[4]*a[2]) + a[2]*(a[1]*a[4] - b11*a[2]);
+  const T r = detB/(2.*p*p*p);
+  const T phi = r <= -1. ? M_PI/3. : (r >= 1. ? 0. : std::acos(r)/3.);
+  const T largest = q + 2.*p*std::cos(phi);
+  const T smallest = q + 2.*p*std::cos(phi + 2.*M_PI/3.);
+  return {smallest, 3.*q - largest - smallest, largest};
+}
+
+/*
+Unit eigenvector of the same symmetric matrix for the eigenvalue lambda: the
+largest cross product of two rows of A-lambda*I. When lambda is a double
+eigenvalue (rank one) any vector orthogonal to the remaining row is returned,
+and {1,0,0} when A is a multiple of the identity.
+*/
+inline hemo::Array<T,3> symmetricEigenvector(const hemo::Array<T,6> & a, T lambda) {
+  const hemo::Array<T,3> r0 = {a[0]-lambda, a[1], a[2]};
+  const hemo::Array<T,3> r1 = {a[1], a[3]-lambda, a[4]};
+  const hemo::Array<T,3> r2 = {a[2], a[4], a[5]-lambda};
+  const hemo::Array<T,3> candidates[3] = {crossProduct(r0,r1), crossProduct(r0,r2), crossProduct(r1,r2)};
+  const hemo::Array<T,3> * best = &candidates[0];
+  for (const hemo::Array<T,3> & c : candidates) {
+    if (dot(c,c) > dot(*best,*best)) { best = &c; }
+  }
+  const T scale = std::max({dot(r0,r0), dot(r1,r1), dot(r2,r2)});
+  if (dot(*best,*best) > 1e-20*scale*scale) {
+    return *best/std::sqrt(dot(*best,*best));
+  }
+  // Rank one: orthogonal to the largest row
+  const hemo::Array<T,3> * row = &r0;
+  if (dot(r1,r1) > dot(*row,*row)) { row = &r1; }
+  if (dot(r2,r2) > dot(*row,*row)) { row = &r2; }
+  if (dot(*row,*row) == 0) { return {1.,0.,0.}; }
+  const int least = std::fabs((*row)[0]) <= std::fabs((*row)[1]) ?
+                      (std::fabs((*row)[0]) <= std::fabs((*row)[2]) ? 0 : 2) :
+                      (std::fabs((*row)[1]) <= std::fabs((*row)[2]) ? 1 : 2);
+  hemo::Array<T,3> axis = {0.,0.,0.};
+  axis[least] = 1.;
+  const hemo::Array<T,3> v = crossProduct(*row,axis);
+  return v/std::sqrt(dot(v,v));
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_GUOBODYFORCEDYNAMICS_H
+#define HEMO_GUOBODYFORCEDYNAMICS_H
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace hemo {
+  /**
+   * Guo forced BGK dynamics with a constant body force next to the force
+   * accumulated in the external field of a node.
+   *
+   * The collision uses the accumulated (immersed boundary) force plus the
+   * body force, so the lattice does not need a setExternalVector sweep to set
+   * the body force again after every iteration. The external field then only
+   * holds the spread force, so the case can let HemoCell clear it on the
+   * kernel nodes of the particles instead of on the whole lattice, see
+   * HemoCell::enableSparseForceReset().
+   */
+  template<typename T, template<typename U> class Descriptor>
+  class GuoBodyForceBGKdynamics : public plb::GuoExternalForceBGKdynamics<T,Descriptor> {
+  public:
+    GuoBodyForceBGKdynamics(T omega_, plb::Array<T,Descriptor<T>::d> const & bodyForce_ = plb::Array<T,Descriptor<T>::d>(0.,0.,0.))
+      : plb::GuoExternalForceBGKdynamics<T,Descriptor>(omega_), bodyForce(bodyForce_) {}
+
+    GuoBodyForceBGKdynamics(plb::HierarchicUnserializer & unserializer)
+      : plb::GuoExternalForceBGKdynamics<T,Descriptor>(T()) {
+      this->unserialize(unserializer);
+    }
+
+    virtual GuoBodyForceBGKdynamics<T,Descriptor> * clone() const {
+      return new GuoBodyForceBGKdynamics<T,Descriptor>(*this);
+    }
+
+    virtual int getId() const { return id; }
+
+    virtual void serialize(plb::HierarchicSerializer & serializer) const {
+      plb::GuoExternalForceBGKdynamics<T,Descriptor>::serialize(serializer);
+      for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+        serializer.addValue(bodyForce[iD]);
+      }
+    }
+
+    virtual void unserialize(plb::HierarchicUnserializer & unserializer) {
+      plb::GuoExternalForceBGKdynamics<T,Descriptor>::unserialize(unserializer);
+      for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+        unserializer.readValue(bodyForce[iD]);
+      }
+    }
+
+    virtual void collide(plb::Cell<T,Descriptor> & cell, plb::BlockStatistics & statistics) {
+      const T * accumulated = cell.getExternal(Descriptor<T>::ExternalField::forceBeginsAt);
+      plb::Array<T,Descriptor<T>::d> force;
+      for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+        force[iD] = accumulated[iD] + bodyForce[iD];
+      }
+
+      T rhoBar;
+      plb::Array<T,Descriptor<T>::d> j, u;
+      plb::momentTemplates<T,Descriptor>::get_rhoBar_j(cell, rhoBar, j);
+      const T rho = Descriptor<T>::fullRho(rhoBar);
+      for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+        u[iD] = j[iD]/rho + force[iD]/(T)2;
+        j[iD] = rho*u[iD];
+      }
+      const T omega = this->getOmega();
+      const T uSqr = plb::dynamicsTemplates<T,Descriptor>::bgk_ma2_collision(cell, rhoBar, j, omega);
+
+      // Guo forcing term
+      const T amplitude = (T)1 - omega/(T)2;
+      for (plint iPop = 0; iPop < Descriptor<T>::q; ++iPop) {
+        T c_u = T();
+        for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+          c_u += Descriptor<T>::c[iPop][iD]*u[iD];
+        }
+        c_u *= Descriptor<T>::invCs2*Descriptor<T>::invCs2;
+        T forceTerm = T();
+        for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+          forceTerm += (((T)Descriptor<T>::c[iPop][iD]-u[iD])*Descriptor<T>::invCs2 + c_u*Descriptor<T>::c[iPop][iD])*force[iD];
+        }
+        cell[iPop] += amplitude*Descriptor<T>::t[iPop]*forceTerm;
+      }
+
+      if (cell.takesStatistics()) {
+        plb::gatherStatistics(statistics, rhoBar, uSqr);
+      }
+    }
+
+    virtual void computeVelocity(plb::Cell<T,Descriptor> const & cell, plb::Array<T,Descriptor<T>::d> & u) const {
+      T rhoBar;
+      plb::momentTemplates<T,Descriptor>::get_rhoBar_j(cell, rhoBar, u);
+      const T invRho = Descriptor<T>::invRho(rhoBar);
+      const T * accumulated = cell.getExternal(Descriptor<T>::ExternalField::forceBeginsAt);
+      for (plint iD = 0; iD < Descriptor<T>::d; ++iD) {
+        u[iD] = u[iD]*invRho + (accumulated[iD] + bodyForce[iD])/(T)2;
+      }
+    }
+
+    plb::Array<T,Descriptor<T>::d> const & getBodyForce() const { return bodyForce; }
+  private:
+    plb::Array<T,Descriptor<T>::d> bodyForce;
+    static int id;
+  };
+
+  template<typename T, template<typename U> class Descriptor>
+  int GuoBodyForceBGKdynamics<T,Descriptor>::id =
+    plb::meta::registerGeneralDynamics<T,Descriptor,GuoBodyForceBGKdynamics<T,Descriptor> >("GuoBodyForce_BGK");
+}
+#endif
@@ -0,0 +1,169 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_GUOTRTDYNAMICS_H
+#define HEMO_GUOTRTDYNAMICS_H
+
+#include "config.h"
+#include "logfile.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace hemo {
+  /**
+   * Guo forced two-relaxation-time (TRT) dynamics.
+   *
+   * The symmetric part of the populations relaxes with omega (which sets the
+   * viscosity, as for BGK), the antisymmetric part with an omega- chosen such
+   * that the magic parameter
+   *   Lambda = (1/omega - 1/2)(1/omega- - 1/2)
+   * stays constant. The antisymmetric rate thus follows the viscosity of a
+   * node, which keeps the scheme stable for relaxation times close to 1/2
+   * (low viscosity, high shear) where BGK is not. Since omega- is derived
+   * from omega, the clones with another tau that interior viscosity attributes
+   * to the nodes inside cells (dynamics->setOmega()) keep the same Lambda.
+   *
+   * Lambda = 3/16 places bounce-back walls exactly halfway between nodes for
+   * Poiseuille flow, Lambda = 1/4 gives the largest stable region.
+   */
+  template<typename T, template<typename U> class Descriptor>
+  class GuoExternalForceTRTdynamics : public plb::GuoExternalForceBGKdynamics<T,Descriptor> {
+  public:
+    GuoExternalForceTRTdynamics(T omega_, T magic_ = (T)3/(T)16)
+      : plb::GuoExternalForceBGKdynamics<T,Descriptor>(omega_), magic(magic_) {}
+
+    GuoExternalForceTRTdynamics(plb::HierarchicUnserializer & unserializer)
+      : plb::GuoExternalForceBGKdynamics<T,Descriptor>(T()) {
+      this->unserialize(unserializer);
+    }
+
+    virtual GuoExternalForceTRTdynamics<T,Descriptor> * clone() const {
+      return new GuoExternalForceTRTdynamics<T,Descriptor>(*this);
+    }
+
+    virtual int getId() const { return id; }
+
+    virtual void serialize(plb::HierarchicSerializer & serializer) const {
+      plb::GuoExternalForceBGKdynamics<T,Descriptor>::serialize(serializer);
+      serializer.addValue(magic);
+    }
+
+    virtual void unserialize(plb::HierarchicUnserializer & unserializer) {
+      plb::GuoExternalForceBGKdynamics<T,Descriptor>::unserialize(unserializer);
+      unserializer.readValue(magic);
+    }
+
+    T getMagic() const { return magic; }
+
+    /// Relaxation rate of the antisymmetric part for a symmetric rate omega
+    static T omegaMinus(T omega, T magic) {
+      return (T)1/(magic/((T)1/omega - (T)0.5) + (T)0.5);
+    }
+
+    virtual void collide(plb::Cell<T,Descriptor> & cell, plb::BlockStatistics & statistics) {
+      typedef Descriptor<T> D;
+      const T * force = cell.getExternal(D::ExternalField::forceBeginsAt);
+
+      T rhoBar;
+      plb::Array<T,D::d> j, u;
+      plb::momentTemplates<T,Descriptor>::get_rhoBar_j(cell, rhoBar, j);
+      const T invRho = D::invRho(rhoBar);
+      const T rho = D::fullRho(rhoBar);
+      for (plint iD = 0; iD < D::d; ++iD) {
+        u[iD] = j[iD]*invRho + force[iD]/(T)2;
+        j[iD] = rho*u[iD];
+      }
+      const T jSqr = plb::VectorTemplate<T,Descriptor>::normSqr(j);
+      const T omegaPlus = this->getOmega();
+      const T omegaMin = omegaMinus(omegaPlus, magic);
+      const T forcePlus = (T)1 - omegaPlus/(T)2;
+      const T forceMin = (T)1 - omegaMin/(T)2;
+
+      T equilibrium[D::q], forceTerm[D::q];
+      for (plint iPop = 0; iPop < D::q; ++iPop) {
+        equilibrium[iPop] = plb::dynamicsTemplatesImpl<T,D>::bgk_ma2_equilibrium(iPop, rhoBar, invRho, j, jSqr);
+        T c_u = T();
+        for (plint iD = 0; iD < D::d; ++iD) {
+          c_u += D::c[iPop][iD]*u[iD];
+        }
+        c_u *= D::invCs2*D::invCs2;
+        forceTerm[iPop] = T();
+        for (plint iD = 0; iD < D::d; ++iD) {
+          forceTerm[iPop] += (((T)D::c[iPop][iD]-u[iD])*D::invCs2 + c_u*D::c[iPop][iD])*force[iD];
+        }
+        forceTerm[iPop] *= D::t[iPop];
+      }
+
+      // The rest population only has a symmetric part
+      cell[0] += -omegaPlus*(cell[0]-equilibrium[0]) + forcePlus*forceTerm[0];
+      for (plint iPop = 1; iPop <= D::q/2; ++iPop) {
+        const plint opp = plb::indexTemplates::opposite<D>(iPop);
+        const T fPlus = (cell[iPop]+cell[opp])/(T)2, fMin = (cell[iPop]-cell[opp])/(T)2;
+        const T eqPlus = (equilibrium[iPop]+equilibrium[opp])/(T)2, eqMin = (equilibrium[iPop]-equilibrium[opp])/(T)2;
+        const T sourcePlus = forcePlus*(forceTerm[iPop]+forceTerm[opp])/(T)2;
+        const T sourceMin = forceMin*(forceTerm[iPop]-forceTerm[opp])/(T)2;
+        const T relaxPlus = -omegaPlus*(fPlus-eqPlus) + sourcePlus;
+        const T relaxMin = -omegaMin*(fMin-eqMin) + sourceMin;
+        cell[iPop] += relaxPlus + relaxMin;
+        cell[opp] += relaxPlus - relaxMin;
+      }
+
+      if (cell.takesStatistics()) {
+        plb::gatherStatistics(statistics, rhoBar, jSqr*invRho*invRho);
+      }
+    }
+  private:
+    T magic;
+    static int id;
+  };
+
+  template<typename T, template<typename U> class Descriptor>
+  int GuoExternalForceTRTdynamics<T,Descriptor>::id =
+    plb::meta::registerGeneralDynamics<T,Descriptor,GuoExternalForceTRTdynamics<T,Descriptor> >("GuoExternalForce_TRT");
+
+  /**
+   * Background dynamics of the fluid as chosen in the config:
+   * <domain><collision> is bgk (default) or trt, <domain><trtMagic> sets the
+   * magic parameter of trt (default 3/16).
+   */
+  inline plb::Dynamics<T,DESCRIPTOR> * createFluidDynamics(hemo::Config & cfg, T omega) {
+    std::string collision = "bgk";
+    try {
+      collision = cfg["domain"]["collision"].read<std::string>();
+    } catch (std::invalid_argument & e) {}
+    if (collision == "bgk") {
+      return new plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>(omega);
+    }
+    if (collision == "trt") {
+      T magic = (T)3/(T)16;
+      try {
+        magic = cfg["domain"]["trtMagic"].read<T>();
+      } catch (std::invalid_argument & e) {}
+      hlog << "(HemoCell) (Fluid) Using Guo forced TRT dynamics, magic parameter " << magic << std::endl;
+      return new GuoExternalForceTRTdynamics<T,DESCRIPTOR>(omega, magic);
+    }
+    hlog << "(HemoCell) (Fluid) Unknown collision " << collision << ", choose bgk or trt" << std::endl;
+    exit(1);
+  }
+}
+#endif
@@ -0,0 +1,52 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ibmForceTiles.h"
+
+namespace hemo {
+
+void IbmForceTiles::begin(plb::BlockLattice3D<T,DESCRIPTOR> & lattice) {
+  for (const Tile & tile : tiles) {
+    tileOf[tile.start/tileSize] = -1;
+  }
+  tiles.clear();
+
+  // Cells of an atomic lattice are stored contiguously with z varying fastest
+  first = &lattice.get(0,0,0);
+  size = lattice.getNx()*lattice.getNy()*lattice.getNz();
+  const std::size_t nTiles = (size + tileSize - 1)/tileSize;
+  if (tileOf.size() != nTiles) {
+    tileOf.assign(nTiles,-1);
+  }
+}
+
+void IbmForceTiles::release() {
+  for (const Tile & tile : tiles) {
+    tileOf[tile.start/tileSize] = -1;
+  }
+  tiles.clear();
+  first = 0;
+  size = 0;
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_IBMFORCETILES_H
+#define HEMO_IBMFORCETILES_H
+
+#include "constant_defaults.h"
+#include "array.h"
+#include "atomicBlock/blockLattice3D.h"
+#include <vector>
+#include <algorithm>
+
+namespace hemo {
+  /**
+   * Sparse storage for the force spread by the particles of one block.
+   *
+   * The atomic lattice is split into tiles of consecutive nodes (in memory
+   * order), only the tiles that receive force are stored, packed together.
+   * The fused collision (see fusedCollideAndStream()) looks the force of a
+   * node up here instead of in the external force of the lattice, so the
+   * spreading, the collision and the reset only touch storage that scales with
+   * the membrane surface. The force stays until the next begin(), so the
+   * velocity interpolation after the collision still sees it. The storage is
+   * kept between iterations, so no allocations happen after the first few.
+   */
+  class IbmForceTiles {
+  public:
+    /// Drop the force of the previous spreading and start accumulating for lattice
+    void begin(plb::BlockLattice3D<T,DESCRIPTOR> & lattice);
+
+    /// Drop the force and stop using the tiles, the force is spread on the lattice again
+    void release();
+
+    /// Whether the force of the last spreading is held here instead of in the lattice
+    bool active() const { return first != 0; }
+
+    /// The first node of the lattice passed to begin(), the nodes are indexed from it
+    const plb::Cell<T,DESCRIPTOR> * storage() const { return first; }
+
+    /// Accumulate force on a node of the lattice passed to begin()
+    void add(const plb::Cell<T,DESCRIPTOR> * node, const hemo::Array<T,3> & force) {
+      const plint i = node - first;
+      PLB_ASSERT(i >= 0 && i < size);
+      int & tile = tileOf[i/tileSize];
+      if (tile < 0) {
+        tile = tiles.size();
+        tiles.resize(tiles.size()+1);
+        tiles.back().start = i - i%tileSize;
+        std::fill_n(&tiles.back().force[0][0], tileSize*3, (T)0);
+      }
+      T * f = tiles[tile].force[i%tileSize];
+      f[0] += force[0];
+      f[1] += force[1];
+      f[2] += force[2];
+    }
+
+    /// The force on the node with index i in the lattice storage, or null when its tile received none
+    const T * find(plint i) const {
+      const int tile = tileOf[i/tileSize];
+      return tile < 0 ? 0 : tiles[tile].force[i%tileSize];
+    }
+    const T * find(const plb::Cell<T,DESCRIPTOR> * node) const {
+      return find(node - first);
+    }
+  private:
+    static const plint tileSize = 64;
+    struct Tile {
+      plint start;
+      T force[tileSize][3];
+    };
+
+    const plb::Cell<T,DESCRIPTOR> * first = 0;
+    plint size = 0;
+    std::vector<int> tileOf; // Index in tiles or -1 when untouched
+    std::vector<Tile> tiles;
+  };
+}
+
+#endif
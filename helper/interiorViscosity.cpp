@@ -23,28 +23,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "interiorViscosity.h"
 #include "hemocell.h"
+#include "fusedCollideAndStream.h"
 #include "palabos3D.h"
 #include "palabos3D.hh"
 
+#include <algorithm>
+
 namespace hemo {
-  InteriorViscosityHelper::InteriorViscosityHelper(HemoCellFields & cellFields_) : cellFields(cellFields_) {
-    //Create viscosity field with same properties as fluid field underlying the particleField.
-    if(cellFields.hemocell.preInlet){
-      preinlet_multiInteriorViscosityField = new plb::MultiScalarField3D<T>(
+  plb::MultiScalarField3D<T> * InteriorViscosityHelper::createTauField(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice, plint fluidEnvelopeWidth) {
+    plb::MultiScalarField3D<T> * field = new plb::MultiScalarField3D<T>(
             MultiBlockManagement3D (
-                *cellFields.hemocell.preinlet_lattice->getSparseBlockStructure().clone(),
-                cellFields.hemocell.preinlet_lattice->getMultiBlockManagement().getThreadAttribution().clone(),
-                cellFields.hemocell.preinlet_lattice->getMultiBlockManagement().getEnvelopeWidth(),
-                cellFields.hemocell.preinlet_lattice->getMultiBlockManagement().getRefinementLevel()),
-                defaultMultiBlockPolicy3D().getBlockCommunicator(),                
+                *lattice.getSparseBlockStructure().clone(),
+                lattice.getMultiBlockManagement().getThreadAttribution().clone(),
+                fluidEnvelopeWidth,
+                lattice.getMultiBlockManagement().getRefinementLevel()),
+                defaultMultiBlockPolicy3D().getBlockCommunicator(),
                 defaultMultiBlockPolicy3D().getCombinedStatistics(),
                 defaultMultiBlockPolicy3D().getMultiScalarAccess<T>(),
                 0);
-      preinlet_multiInteriorViscosityField->periodicity().toggle(0,cellFields.hemocell.preinlet_lattice->periodicity().get(0));
-      preinlet_multiInteriorViscosityField->periodicity().toggle(1,cellFields.hemocell.preinlet_lattice->periodicity().get(1));
-      preinlet_multiInteriorViscosityField->periodicity().toggle(2,cellFields.hemocell.preinlet_lattice->periodicity().get(2));
+    field->periodicity().toggle(0,lattice.periodicity().get(0));
+    field->periodicity().toggle(1,lattice.periodicity().get(1));
+    field->periodicity().toggle(2,lattice.periodicity().get(2));
+
+    field->initialize();
+    return field;
+  }
 
-      preinlet_multiInteriorViscosityField->initialize();
+  InteriorViscosityHelper::InteriorViscosityHelper(HemoCellFields & cellFields_) : cellFields(cellFields_) {
+    //Create viscosity field with same properties as fluid field underlying the particleField.
+    if(cellFields.hemocell.preInlet){
+      preinlet_multiInteriorViscosityField = createTauField(*cellFields.hemocell.preinlet_lattice, cellFields.fluidEnvelopeSize);
       
       //Make sure each particleField has access to its local scalarField
       for (const plint & bId : preinlet_multiInteriorViscosityField->getLocalInfo().getBlocks()) {
@@ -52,21 +60,7 @@ namespace hemo {
         pf.interiorViscosityField = &preinlet_multiInteriorViscosityField->getComponent(bId);
       }
     }
-    domain_multiInteriorViscosityField = new plb::MultiScalarField3D<T>(
-            MultiBlockManagement3D (
-                *cellFields.hemocell.domain_lattice->getSparseBlockStructure().clone(),
-                cellFields.hemocell.domain_lattice->getMultiBlockManagement().getThreadAttribution().clone(),
-                cellFields.hemocell.domain_lattice->getMultiBlockManagement().getEnvelopeWidth(),
-                cellFields.hemocell.domain_lattice->getMultiBlockManagement().getRefinementLevel()),
-                defaultMultiBlockPolicy3D().getBlockCommunicator(),                
-                defaultMultiBlockPolicy3D().getCombinedStatistics(),
-                defaultMultiBlockPolicy3D().getMultiScalarAccess<T>(),
-                0);
-    domain_multiInteriorViscosityField->periodicity().toggle(0,cellFields.hemocell.domain_lattice->periodicity().get(0));
-    domain_multiInteriorViscosityField->periodicity().toggle(1,cellFields.hemocell.domain_lattice->periodicity().get(1));
-    domain_multiInteriorViscosityField->periodicity().toggle(2,cellFields.hemocell.domain_lattice->periodicity().get(2));
-
-    domain_multiInteriorViscosityField->initialize();
+    domain_multiInteriorViscosityField = createTauField(*cellFields.hemocell.domain_lattice, cellFields.fluidEnvelopeSize);
     
     //Make sure each particleField has access to its local scalarField
     for (const plint & bId : domain_multiInteriorViscosityField->getLocalInfo().getBlocks()) {
@@ -80,11 +74,22 @@ namespace hemo {
     else{
       multiInteriorViscosityField = domain_multiInteriorViscosityField;
     }
+
+    // The fused collision relaxes the fluid nodes with the tau in the field,
+    // so adding or removing an interior node is a write to the field
+    tauOnlyInField = global.fusedCollideAndStream && fusedCollideAndStreamApplies(*cellFields.lattice) &&
+                     fusedCollideAndStreamInlines(cellFields.lattice->getBackgroundDynamics());
+    if (tauOnlyInField) {
+      hlog << "(HemoCell) (InteriorViscosity) The fused collision reads the interior tau from the interior viscosity field" << endl;
+    }
     
   }
   
   InteriorViscosityHelper::~InteriorViscosityHelper() {
     delete multiInteriorViscosityField;
+    for (auto & pair : restoredDynamics) {
+      delete pair.second;
+    }
   }
     
   void InteriorViscosityHelper::checkpoint() {
@@ -136,9 +141,33 @@ namespace hemo {
     get(cellFields).refillBindingSites();
   }  
   
+  plb::Dynamics<T,DESCRIPTOR> * InteriorViscosityHelper::dynamicsFor(T tau) {
+    // Share the dynamics of the cell type when possible, so every interior
+    // node of a type points to the same object
+    for (HemoCellField * type : cellFields.cellFields) {
+      if (type->innerViscosityDynamics && type->interiorViscosityTau == tau) {
+        return type->innerViscosityDynamics;
+      }
+    }
+    plb::Dynamics<T,DESCRIPTOR> * & dynamics = restoredDynamics[tau];
+    if (!dynamics) {
+      dynamics = cellFields.lattice->getBackgroundDynamics().clone();
+      dynamics->setOmega(1.0/tau);
+    }
+    return dynamics;
+  }
+
   void InteriorViscosityHelper::add(HemoCellParticleField & pf, const Dot3D & internalPoint, T tau) {
-      pf.internalPoints.insert(internalPoint);
-      pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = tau;
+    T & current = pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z);
+    if (current == tau) { return; }
+    if (!current) {
+      pf.interiorNodes.push_back(internalPoint);
+      pf.interiorNodeCount++;
+    }
+    current = tau;
+    if (!tauOnlyInField) {
+      pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(dynamicsFor(tau));
+    }
   }
   
   void InteriorViscosityHelper::add(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints, T tau) {
@@ -148,8 +177,18 @@ namespace hemo {
   }
   
   void InteriorViscosityHelper::remove(HemoCellParticleField & pf, const Dot3D & internalPoint) {
-    pf.internalPoints.erase(internalPoint);
-    pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
+    T & current = pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z);
+    if (!current) { return; }
+    current = 0;
+    pf.interiorNodeCount--;
+    if (!tauOnlyInField) {
+      pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&pf.atomicLattice->getBackgroundDynamics());
+    }
+
+    // Removed nodes stay in the list until it is mostly stale
+    if (pf.interiorNodes.size() > 2*pf.interiorNodeCount + 1024) {
+      compact(pf);
+    }
   }
   
   void InteriorViscosityHelper::remove(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints) {
@@ -159,52 +198,57 @@ namespace hemo {
   } 
   
   void InteriorViscosityHelper::empty(HemoCellParticleField & pf) {
-    for (const Dot3D & internalPoint: pf.internalPoints) {
-      pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
+    for (const Dot3D & internalPoint: pf.interiorNodes) {
+      T & current = pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z);
+      if (current) {
+        current = 0;
+        if (!tauOnlyInField) {
+          pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&pf.atomicLattice->getBackgroundDynamics());
+        }
+      }
     }
-    pf.internalPoints.clear();
+    pf.interiorNodes.clear();
+    pf.interiorNodeCount = 0;
+  }
+
+  void InteriorViscosityHelper::compact(HemoCellParticleField & pf) {
+    vector<Dot3D> & nodes = pf.interiorNodes;
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [&pf](const Dot3D & node) {
+      return !pf.interiorViscosityField->get(node.x,node.y,node.z);
+    }), nodes.end());
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
   }
   
   void InteriorViscosityHelper::refillBindingSites() {
+    vector<HemoCellParticleField *> fields;
     if(cellFields.hemocell.preInlet){
       for (const plint & bId : cellFields.preinlet_immersedParticles->getLocalInfo().getBlocks()) {
-        HemoCellParticleField & pf = cellFields.preinlet_immersedParticles->getComponent(bId);
-        ScalarField3D<T> & bf = *pf.interiorViscosityField;
-        Box3D domain = bf.getBoundingBox();
-        for (int x = domain.x0; x <= domain.x1 ; x++) {
-          for (int y = domain.y0; y <= domain.y1; y++) {
-            for (int z = domain.z0; z <= domain.z1; z++) {
-              if(bf.get(x,y,z)) {
-                pf.internalPoints.insert({x,y,z});
-                
-                //WARNING this _can_ memory leak, so you should be ok if this is only called one time (from checkpointing)
-                plb::Dynamics<T,DESCRIPTOR>* dynamic = cellFields.hemocell.preinlet_lattice->getBackgroundDynamics().clone();
-                dynamic->setOmega(1.0/bf.get(x,y,z));
-                pf.atomicLattice->get(x,y,z).attributeDynamics(dynamic);
-              }
-            }
-          }
-        }
+        fields.push_back(&cellFields.preinlet_immersedParticles->getComponent(bId));
       }
     }
     for (const plint & bId : cellFields.domain_immersedParticles->getLocalInfo().getBlocks()) {
-      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
-      ScalarField3D<T> & bf = *pf.interiorViscosityField;
+      fields.push_back(&cellFields.domain_immersedParticles->getComponent(bId));
+    }
+
+    for (HemoCellParticleField * pf : fields) {
+      ScalarField3D<T> & bf = *pf->interiorViscosityField;
+      pf->interiorNodes.clear();
+      pf->interiorNodeCount = 0;
       Box3D domain = bf.getBoundingBox();
       for (int x = domain.x0; x <= domain.x1 ; x++) {
         for (int y = domain.y0; y <= domain.y1; y++) {
           for (int z = domain.z0; z <= domain.z1; z++) {
             if(bf.get(x,y,z)) {
-              pf.internalPoints.insert({x,y,z});
-              
-              //WARNING this _can_ memory leak, so you should be ok if this is only called one time (from checkpointing)
-              plb::Dynamics<T,DESCRIPTOR>* dynamic = cellFields.hemocell.domain_lattice->getBackgroundDynamics().clone();
-              dynamic->setOmega(1.0/bf.get(x,y,z));
-              pf.atomicLattice->get(x,y,z).attributeDynamics(dynamic);
+              pf->interiorNodes.push_back({x,y,z});
+              pf->interiorNodeCount++;
+              if (!tauOnlyInField) {
+                pf->atomicLattice->get(x,y,z).attributeDynamics(dynamicsFor(bf.get(x,y,z)));
+              }
             }
           }
         }
       }
     }
   }
-}
\ No newline at end of file
+}
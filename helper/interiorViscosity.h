@@ -45,16 +45,35 @@ namespace hemo {
     void remove(HemoCellParticleField & pf, const Dot3D & bindingSite);
     void remove(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites);
     void empty(HemoCellParticleField & pf);
+
+    /// A field of interior taus with the atomic blocks of lattice. The fluid
+    /// blocks keep the envelope they were allocated with (fluidEnvelopeWidth)
+    /// after HemoCell::initializeCellfield() resets the envelope of their
+    /// management to 1, and the field is indexed like their cells.
+    static plb::MultiScalarField3D<T> * createTauField(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice, plint fluidEnvelopeWidth);
+
+    /// The tau of the interior nodes, for the lattice of HemoCell
+    plb::MultiScalarField3D<T> * getTauField() { return multiInteriorViscosityField; }
+    /// The fused collision reads the tau of interior nodes from the field, the
+    /// dynamics of the nodes are not switched
+    bool tauInField() const { return tauOnlyInField; }
     
   private:
     HemoCellFields & cellFields;
 
     plb::MultiScalarField3D<T> *multiInteriorViscosityField = nullptr,
      *preinlet_multiInteriorViscosityField = nullptr, *domain_multiInteriorViscosityField = nullptr;
+    /// Dynamics for checkpointed taus that match no cell type
+    map<T,plb::Dynamics<T,DESCRIPTOR> *> restoredDynamics;
+    bool tauOnlyInField = false;
     
     InteriorViscosityHelper(HemoCellFields & cellFields);
     ~InteriorViscosityHelper();
     
+    /// Dynamics with relaxation time tau, shared by all nodes with that tau
+    plb::Dynamics<T,DESCRIPTOR> * dynamicsFor(T tau);
+    /// Drop the stale and duplicate entries of pf.interiorNodes
+    void compact(HemoCellParticleField & pf);
     void refillBindingSites();
     
     //Singleton Behaviour
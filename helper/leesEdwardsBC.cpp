@@ -0,0 +1,323 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "leesEdwardsBC.h"
+#include "hemocell.h"
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <cmath>
+#include <mpi.h>
+
+namespace hemo
+{
+
+namespace {
+plint lower(plb::Box3D const & box, int axis) { return axis == 0 ? box.x0 : (axis == 1 ? box.y0 : box.z0); }
+plint upper(plb::Box3D const & box, int axis) { return axis == 0 ? box.x1 : (axis == 1 ? box.y1 : box.z1); }
+plint component(plb::Dot3D const & dot, int axis) { return axis == 0 ? dot.x : (axis == 1 ? dot.y : dot.z); }
+
+/* Non-negative modulo (-a % b gives a negative number in C++)
+ */
+plint modNonNegative(plint a, plint b) { return (a % b + b) % b; }
+
+const int leesEdwardsTag = 2049;
+}
+
+LeesEdwardsBC::LeesEdwardsBC(HemoCell & hemocell_, T shearRate, T dt, int normal_, int flow_)
+    : normal(normal_), flow(flow_), hemocell(hemocell_), other(3 - normal_ - flow_)
+{
+    if (normal < 0 || normal > 2 || flow < 0 || flow > 2 || normal == flow) {
+        hlog << "(HemoCell) (LeesEdwards) The normal and flow axis must be two different axes (0, 1 or 2), exiting" << std::endl;
+        exit(1);
+    }
+    const plint n[3] = {hemocell.lattice->getNx(), hemocell.lattice->getNy(), hemocell.lattice->getNz()};
+    this->LEdisplacement = shearRate * dt;
+    T vHalf = (n[normal] - 1) * shearRate * 0.5;
+    this->topVelocity = -vHalf;
+    this->bottomVelocity = vHalf;
+
+    typedef DESCRIPTOR<T> Lattice;
+    for (int plane = 0; plane < 2; plane++) {
+        const int entering = plane ? -1 : 1;
+        for (plint iPop = 0; iPop < Lattice::q; iPop++) {
+            if (Lattice::c[iPop][normal] == entering) {
+                incoming[plane].push_back(iPop);
+            }
+        }
+        // The populations are taken with their flow component mirrored
+        for (plint iPop : incoming[plane]) {
+            for (plint jIn = 0; jIn < (plint)incoming[plane].size(); jIn++) {
+                const plint jPop = incoming[plane][jIn];
+                if (Lattice::c[jPop][other] == Lattice::c[iPop][other] && Lattice::c[jPop][flow] == -Lattice::c[iPop][flow]) {
+                    source[plane].push_back(jIn);
+                }
+            }
+        }
+    }
+    findPlaneBlocks();
+    hemocell.leesEdwards = this;
+}
+
+LeesEdwardsBC::~LeesEdwardsBC()
+{
+    if (hemocell.leesEdwards == this) {
+        hemocell.leesEdwards = 0;
+    }
+}
+
+void LeesEdwardsBC::initialize()
+{
+    // Uses the default periodicity because otherwise a form of bounceback boundary will be initialized per default
+    hemocell.lattice->periodicity().toggleAll(true);
+}
+
+void LeesEdwardsBC::updateLECurDisplacement(unsigned int iter)
+{
+    const plint n[3] = {hemocell.lattice->getNx(), hemocell.lattice->getNy(), hemocell.lattice->getNz()};
+    LEcurrentDisplacement = std::fmod(this->LEdisplacement * iter, (double)n[flow]);
+}
+
+hemo::Array<T,3> LeesEdwardsBC::particleShift(plb::Dot3D const & absoluteOffset) const
+{
+    hemo::Array<T,3> shift({0., 0., 0.});
+    const plint n[3] = {hemocell.lattice->getNx(), hemocell.lattice->getNy(), hemocell.lattice->getNz()};
+    if (component(absoluteOffset, normal) == -n[normal]) {
+        shift[flow] += LEcurrentDisplacement;
+    }
+    if (component(absoluteOffset, normal) == n[normal]) {
+        shift[flow] -= LEcurrentDisplacement;
+    }
+    return shift;
+}
+
+/* Call function(k, position, o) for every node of block (in the plane) that
+   the window reads, in the same order on the sending and receiving process
+ */
+template<typename Function>
+void LeesEdwardsBC::visitOverlap(const PlaneBlock & block, const Window & window, Function function) const
+{
+    const plint n[3] = {hemocell.lattice->getNx(), hemocell.lattice->getNy(), hemocell.lattice->getNz()};
+    const plint nFlow = n[flow];
+    const plint o0 = std::max(window.o0, lower(block.bulk, other));
+    const plint o1 = std::min(window.o1, upper(block.bulk, other));
+    if (o0 > o1) {
+        return;
+    }
+    for (plint k = 0; k < window.length; k++) {
+        const plint position = modNonNegative(window.first + k, nFlow);
+        if (position < lower(block.bulk, flow) || position > upper(block.bulk, flow)) {
+            continue;
+        }
+        for (plint o = o0; o <= o1; o++) {
+            function(k, position, o);
+        }
+    }
+}
+
+void LeesEdwardsBC::findPlaneBlocks()
+{
+    plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice = *hemocell.lattice;
+    plb::MultiBlockManagement3D const & management = lattice.getMultiBlockManagement();
+    const plint n[3] = {lattice.getNx(), lattice.getNy(), lattice.getNz()};
+    for (int plane = 0; plane < 2; plane++) {
+        planeBlocks[plane].clear();
+        schedule[plane].valid = false;
+    }
+    for (auto const & pair : management.getSparseBlockStructure().getBulks()) {
+        for (int plane = 0; plane < 2; plane++) {
+            const plint coordinate = plane ? n[normal] - 1 : 0;
+            if (lower(pair.second, normal) <= coordinate && coordinate <= upper(pair.second, normal)) {
+                planeBlocks[plane].push_back({pair.first, management.getThreadAttribution().getMpiProcess(pair.first), pair.second});
+            }
+        }
+    }
+    planeLattice = &lattice;
+}
+
+void LeesEdwardsBC::buildSchedule(int plane, plint offset)
+{
+    const int rank = global::mpi().getRank();
+    const plint nIn = incoming[plane].size();
+    const std::vector<PlaneBlock> & blocks = planeBlocks[plane];
+    Schedule & plan = schedule[plane];
+    plan.valid = true;
+    plan.offset = offset;
+    plan.local.clear();
+    plan.sends.clear();
+    plan.receives.clear();
+
+    // Every process knows the extent of every window, but only stores its own
+    plan.windows.assign(blocks.size(), Window());
+    for (unsigned int b = 0; b < blocks.size(); b++) {
+        const PlaneBlock & block = blocks[b];
+        Window & window = plan.windows[b];
+        window.first = lower(block.bulk, flow) + offset;
+        window.length = upper(block.bulk, flow) - lower(block.bulk, flow) + 2;
+        window.o0 = lower(block.bulk, other);
+        window.o1 = upper(block.bulk, other);
+        if (block.process == rank) {
+            window.populations.resize(window.length * (window.o1 - window.o0 + 1) * nIn);
+        }
+    }
+
+    // The transfers are listed in the same order on the sending and receiving process
+    for (unsigned int b = 0; b < blocks.size(); b++) {
+        const PlaneBlock & reader = blocks[b];
+        for (unsigned int s = 0; s < blocks.size(); s++) {
+            const PlaneBlock & owner = blocks[s];
+            if (reader.process != rank && owner.process != rank) { continue; }
+            plint count = 0;
+            visitOverlap(owner, plan.windows[b], [&](plint, plint, plint) { count += nIn; });
+            if (!count) { continue; }
+            if (reader.process == rank && owner.process == rank) {
+                plan.local.push_back({b, s, rank, std::vector<T>()});
+            } else if (owner.process == rank) {
+                plan.sends.push_back({b, s, reader.process, std::vector<T>(count)});
+            } else {
+                plan.receives.push_back({b, s, owner.process, std::vector<T>(count)});
+            }
+        }
+    }
+}
+
+void LeesEdwardsBC::apply()
+{
+    global.statistics.getCurrent()["leesEdwards"].start();
+    updateLECurDisplacement(hemocell.iter);
+
+    plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice = *hemocell.lattice;
+    const int rank = global::mpi().getRank();
+    const plint n[3] = {lattice.getNx(), lattice.getNy(), lattice.getNz()};
+    if (&lattice != planeLattice) {
+        findPlaneBlocks();
+    }
+
+    std::vector<MPI_Request> requests;
+    for (int plane = 0; plane < 2; plane++) {
+        const std::vector<PlaneBlock> & blocks = planeBlocks[plane];
+        const plint coordinate = plane ? n[normal] - 1 : 0;
+        const plint nIn = incoming[plane].size();
+        // The top plane reads at +displacement, the bottom plane at -displacement
+        const double shift = plane ? LEcurrentDisplacement : -LEcurrentDisplacement;
+        const plint offset = std::floor(shift);
+        const T weight = shift - offset;
+
+        Schedule & plan = schedule[plane];
+        if (!plan.valid || plan.offset != offset) {
+            buildSchedule(plane, offset);
+        }
+        std::vector<Window> & windows = plan.windows;
+
+        auto node = [&](const PlaneBlock & block, plint flowPosition, plint o) -> plb::Cell<T,DESCRIPTOR> & {
+            plint position[3];
+            position[normal] = coordinate;
+            position[flow] = flowPosition;
+            position[other] = o;
+            plb::BlockLattice3D<T,DESCRIPTOR> & lattice3D = lattice.getComponent(block.id);
+            const plb::Dot3D location = lattice3D.getLocation();
+            return lattice3D.get(position[0] - location.x, position[1] - location.y, position[2] - location.z);
+        };
+
+        // Fill the windows from the blocks that own their nodes
+        requests.clear();
+        requests.reserve(plan.receives.size() + plan.sends.size());
+        for (Transfer & transfer : plan.receives) {
+            requests.push_back(MPI_Request());
+            MPI_Irecv(&transfer.buffer[0], transfer.buffer.size() * sizeof(T), MPI_CHAR, transfer.process, leesEdwardsTag + plane, MPI_COMM_WORLD, &requests.back());
+        }
+        for (Transfer & transfer : plan.sends) {
+            const PlaneBlock & owner = blocks[transfer.owner];
+            T * value = &transfer.buffer[0];
+            visitOverlap(owner, windows[transfer.window], [&](plint, plint position, plint o) {
+                plb::Cell<T,DESCRIPTOR> & cell = node(owner, position, o);
+                for (plint iIn = 0; iIn < nIn; iIn++) {
+                    *value++ = cell[incoming[plane][iIn]];
+                }
+            });
+            requests.push_back(MPI_Request());
+            MPI_Isend(&transfer.buffer[0], transfer.buffer.size() * sizeof(T), MPI_CHAR, transfer.process, leesEdwardsTag + plane, MPI_COMM_WORLD, &requests.back());
+        }
+        for (Transfer & transfer : plan.local) {
+            const PlaneBlock & owner = blocks[transfer.owner];
+            Window & window = windows[transfer.window];
+            const plint nO = window.o1 - window.o0 + 1;
+            visitOverlap(owner, window, [&](plint k, plint position, plint o) {
+                plb::Cell<T,DESCRIPTOR> & cell = node(owner, position, o);
+                for (plint iIn = 0; iIn < nIn; iIn++) {
+                    window.populations[(k * nO + o - window.o0) * nIn + iIn] = cell[incoming[plane][iIn]];
+                }
+            });
+        }
+        if (!requests.empty()) {
+            MPI_Waitall(requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+        }
+        for (Transfer & transfer : plan.receives) {
+            Window & target = windows[transfer.window];
+            const plint nO = target.o1 - target.o0 + 1;
+            const T * value = &transfer.buffer[0];
+            visitOverlap(blocks[transfer.owner], target, [&](plint k, plint, plint o) {
+                for (plint iIn = 0; iIn < nIn; iIn++) {
+                    target.populations[(k * nO + o - target.o0) * nIn + iIn] = *value++;
+                }
+            });
+        }
+
+        // Write the plane: velocity of the moving plane plus the displaced incoming populations
+        plb::Array<T,3> velocity(0., 0., 0.);
+        velocity[flow] = plane ? this->topVelocity : this->bottomVelocity;
+        for (unsigned int b = 0; b < blocks.size(); b++) {
+            const PlaneBlock & block = blocks[b];
+            if (block.process != rank) { continue; }
+            const Window & window = windows[b];
+            const plint nO = window.o1 - window.o0 + 1;
+            plb::BlockLattice3D<T,DESCRIPTOR> & lattice3D = lattice.getComponent(block.id);
+            for (plint iFlow = lower(block.bulk, flow); iFlow <= upper(block.bulk, flow); iFlow++) {
+                const plint k = iFlow - lower(block.bulk, flow);
+                for (plint o = window.o0; o <= window.o1; o++) {
+                    plb::Cell<T,DESCRIPTOR> & cell = node(block, iFlow, o);
+                    plb::Cell<T,DESCRIPTOR> moving = cell;
+                    T rhoBar;
+                    plb::Array<T,3> j;
+                    moving.getDynamics().computeRhoBarJ(moving, rhoBar, j);
+                    moving.getDynamics().collideExternal(moving, rhoBar, velocity, T(), lattice3D.getInternalStatistics());
+                    const T * s1 = &window.populations[(k * nO + o - window.o0) * nIn];
+                    const T * s2 = &window.populations[((k + 1) * nO + o - window.o0) * nIn];
+                    for (plint iIn = 0; iIn < nIn; iIn++) {
+                        const plint from = source[plane][iIn];
+                        moving[incoming[plane][iIn]] = (1 - weight) * s1[from] + weight * s2[from];
+                    }
+                    for (plint iPop = 0; iPop < DESCRIPTOR<T>::q; iPop++) {
+                        cell[iPop] = moving[iPop];
+                    }
+                }
+            }
+        }
+    }
+
+    lattice.duplicateOverlaps(plb::modif::staticVariables);
+    global.statistics.getCurrent().stop();
+}
+
+}; // namespace hemo
@@ -25,9 +25,47 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifdef HEMO_PARMETIS
 #include <parmetis.h>
+#endif
+
+namespace hemo {
 
 LoadBalancer::LoadBalancer(HemoCell & hemocell_) : hemocell(hemocell_), original_block_structure(hemocell_.lattice->getSparseBlockStructure().clone()),original_thread_attribution(hemocell_.lattice->getMultiBlockManagement().getThreadAttribution().clone()) { 
+#ifdef HEMO_PARMETIS
+  useParmetis = true;
+#endif
+  try {
+    string partitioner = (*hemocell.cfg)["domain"]["partitioner"].read<string>();
+    if (partitioner == "parmetis") {
+#ifndef HEMO_PARMETIS
+      hlog << "(LoadBalancer) ParMETIS requested but HemoCell is compiled without it, using the Hilbert curve partitioner" << endl;
+#endif
+    } else {
+      useParmetis = false;
+      curve = spaceFillingCurveFromString(partitioner);
+    }
+  } catch (std::invalid_argument & e) {}
+  try {
+    particleWeight = (*hemocell.cfg)["domain"]["sfcParticleWeight"].read<T>();
+  } catch (std::invalid_argument & e) {}
+  try {
+    unsigned int checkEvery = (*hemocell.cfg)["parameters"]["autoBalanceEvery"].read<unsigned int>();
+    T minimumImbalance = 0.1;
+    unsigned int horizon = 0;
+    try {
+      minimumImbalance = (*hemocell.cfg)["parameters"]["autoBalanceMinimumImbalance"].read<T>();
+    } catch (std::invalid_argument & e) {}
+    try {
+      horizon = (*hemocell.cfg)["parameters"]["autoBalanceHorizon"].read<unsigned int>();
+    } catch (std::invalid_argument & e) {}
+    if (checkEvery > 0) {
+      enableAutoBalance(checkEvery,minimumImbalance,horizon);
+    }
+  } catch (std::invalid_argument & e) {}
+}
 
+LoadBalancer::~LoadBalancer() {
+  delete original_block_structure;
+  delete original_thread_attribution;
 }
 
 void LoadBalancer::reloadCheckpoint() {
@@ -49,18 +87,13 @@ void LoadBalancer::reloadCheckpoint() {
 
 void LoadBalancer::GatherTimeOfAtomicBlocks::processGenericBlocks(Box3D domain, vector<AtomicBlock3D*> blocks) {
   HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
-  BlockLattice3D<T,DESCRIPTOR> * ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[1]);
-
-  gatherValues[pf->atomicBlockId].particle_time = pf->timer.getTime();
-  gatherValues[pf->atomicBlockId].fluid_time = ff->timer.getTime();
+  //Palabos does not keep timers per atomic block, use the number of fluid nodes as measure of the fluid work
+  gatherValues[pf->atomicBlockId].n_fluid = pf->nFluidCells;
   gatherValues[pf->atomicBlockId].mpi_proc = global::mpi().getRank();
   
   vector<HemoCellParticle *> found;
   pf->findParticles(pf->localDomain,found);
   gatherValues[pf->atomicBlockId].n_lsp = found.size();
-
-  pf->timer.reset();
-  ff->timer.reset();
 }
 
 T LoadBalancer::calculateFractionalLoadImbalance() {
@@ -68,10 +101,8 @@ T LoadBalancer::calculateFractionalLoadImbalance() {
   //set FLI_iscalled
   FLI_iscalled = true;
   int size = global::mpi().getSize();
-  //We need the total number of atomic blocks for the Gather Functional
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(hemocell.cellfields->immersedParticles);
-  int numAtomicBlock = hemocell.lattice->getMultiBlockManagement().getSparseBlockStructure().getNumBlocks();
 
   //Do a more intricate functional (The above one could be part of this one, but
   //it is just for example
@@ -80,39 +111,39 @@ T LoadBalancer::calculateFractionalLoadImbalance() {
   applyProcessingFunctional(new GatherTimeOfAtomicBlocks(gatherValues),hemocell.cellfields->immersedParticles->getBoundingBox(), wrapper);
   HemoCellGatheringFunctional<TOAB_t>::gather(gatherValues);
   
-  vector<T> times(size);
+  vector<T> fluids(size);
   vector<T> lsps(size);
   
   /*for (auto const & entry : gatherValues) {
-    pcout << "Atomic block " << entry.first << " is on proc " << entry.second.mpi_proc << " spent " << entry.second.particle_time << " for the particle field, spent " << entry.second.fluid_time << " for the fluid field" << endl;
+    pcout << "Atomic block " << entry.first << " is on proc " << entry.second.mpi_proc << " has " << entry.second.n_lsp << " particles and " << entry.second.n_fluid << " fluid nodes" << endl;
   }*/
 
   this->gatherValues = gatherValues;
   
   for (auto const & entry : gatherValues) {
-    times[entry.second.mpi_proc] += entry.second.particle_time + entry.second.fluid_time;
+    fluids[entry.second.mpi_proc] += entry.second.n_fluid;
     lsps[entry.second.mpi_proc] += entry.second.n_lsp;
   }
   
-  // lsps.
+  // fluid nodes
   T sum = 0;
   T average = 0;
   T max = 0;
   T fli = 0;
   
-  // this one is for time
+  // lsps
   T sum2 = 0;
   T average2 = 0;
   T max2 = 0;
   T fli2 = 0;
   
-  for (unsigned int i = 0 ; i < times.size(); i++){
-      sum = sum + times[i];
+  for (unsigned int i = 0 ; i < fluids.size(); i++){
+      sum = sum + fluids[i];
       sum2 = sum2 + lsps[i];
   }
   
   average = sum / size ;
-  max = *std::max_element(times.begin(),times.end());
+  max = *std::max_element(fluids.begin(),fluids.end());
 
   fli = (max/average)-1;
   
@@ -121,13 +152,13 @@ T LoadBalancer::calculateFractionalLoadImbalance() {
 
   fli2 = (max2/average2)-1;
   
-  pcout << "fli (time):  " << fli << " fli (lsp): "<< fli2 << std::endl;
+  pcout << "fli (fluid):  " << fli << " fli (lsp): "<< fli2 << std::endl;
   
   return fli2;
 }
 
 void LoadBalancer::doLoadBalance() {
-  if(!FLI_iscalled) {
+  if(!FLI_iscalled && !autoBalanceEnabled()) {
     pcerr << "Warning, You did not calculate the fractional load imbalance before trying to balance, this means gatherValues will be unavailable in this function";
   }
   hemocell.saveCheckPoint(); // Save Checkpoint
@@ -174,6 +205,71 @@ void LoadBalancer::doLoadBalance() {
   }
   
   
+  map<int,plint> newProc;
+  if (useParmetis) {
+    partitionParmetis(newProc);
+  } else {
+    partitionSfc(newProc);
+  }
+  
+  /*for (auto & pair : newProc) {
+    pcout << "Atomic block " << pair.first << " is assigned to processor " << pair.second << endl;
+  }*/
+
+  
+  pcout << "(LoadBalancer) Recreating Fluid field with new Distribution of Atomic Blocks" << endl;
+
+  map<plint,plint> nTA; //Conversion is necessary for next function
+  for (auto & pair : newProc) { 
+      nTA[pair.first] = pair.second; 
+  }
+  ExplicitThreadAttribution* newThreadAttribution = new ExplicitThreadAttribution(nTA);
+  delete original_thread_attribution;
+  original_thread_attribution = newThreadAttribution->clone();
+  
+  plint envelopeWidth = hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth();
+  plint refinementLevel = hemocell.lattice->getMultiBlockManagement().getRefinementLevel();
+
+  Dynamics<T,DESCRIPTOR> * dynamics = hemocell.lattice->getBackgroundDynamics().clone();
+  bool perX = hemocell.lattice->periodicity().get(0);
+  bool perY = hemocell.lattice->periodicity().get(1);
+  bool perZ = hemocell.lattice->periodicity().get(2);
+  bool internalStat = hemocell.lattice->isInternalStatisticsOn();
+
+  delete hemocell.lattice;
+
+  MultiBlockLattice3D<T,DESCRIPTOR> * newlattice = new
+            MultiBlockLattice3D<T,DESCRIPTOR>(MultiBlockManagement3D (
+            *original_block_structure->clone(),
+            newThreadAttribution->clone(),
+            envelopeWidth,
+            refinementLevel ),
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),                
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiCellAccess<T,DESCRIPTOR>(),
+            dynamics );
+  
+  newlattice->periodicity().toggle(0, perX);
+  newlattice->periodicity().toggle(1, perY);
+  newlattice->periodicity().toggle(2, perZ);
+  newlattice->toggleInternalStatistics(internalStat);
+ 
+  hemocell.lattice = newlattice;
+  hemocell.cellfields->lattice = newlattice;
+  
+  delete hemocell.cellfields->immersedParticles;
+  hemocell.cellfields->createParticleField(original_block_structure->clone(),newThreadAttribution->clone());
+
+  delete newThreadAttribution;
+  
+  reloadCheckpoint();
+  pcout << "(LoadBalancer) Continuing simulation with balanced application" << endl;
+  
+  return;
+}
+
+void LoadBalancer::partitionParmetis(map<int,plint> & newProc) {
+#ifdef HEMO_PARMETIS
   //Map atomic blocks to number used in parmetis
   map<plint,plint> id_parmetis_id_real;
   map<plint,plint> id_real_id_parmetis;
@@ -250,67 +346,127 @@ void LoadBalancer::doLoadBalance() {
   ParMETIS_V3_PartGeomKway(&vtxdist[0], &xadj[0], &adjncy[0], &vwgt[0], NULL, &wgtflag, &numflag,  &ndims, &xyz[0], 
                            &ncon, &nparts, &tpwghts[0], &ubvec[0], &options[0],&edgecut, &part[0], &mc);
   
-  map<int,plint> newProc; //Gather the results to all mpi processes, we can use the gathering functional for that as well!
+  //Gather the results to all mpi processes, we can use the gathering functional for that as well!
   for (unsigned int i = 0 ; i < part.size() ; i++){
     newProc[id_parmetis_id_real[ofs+i]] = part[i];
   }
-  int numAtomicBlock = hemocell.lattice->getMultiBlockManagement().getSparseBlockStructure().getNumBlocks();
   HemoCellGatheringFunctional<plint>::gather(newProc);
-  
-  /*for (auto & pair : newProc) {
-    pcout << "Atomic block " << pair.first << " is assigned to processor " << pair.second << endl;
-  }*/
+#else
+  pcerr << "(LoadBalancer) ParMETIS partitioning requested, but HemoCell is compiled without ParMETIS support, exiting ..." << endl;
+  exit(1);
+#endif
+}
 
-  
-  pcout << "(LoadBalancer) Recreating Fluid field with new Distribution of Atomic Blocks" << endl;
+void LoadBalancer::partitionSfc(map<int,plint> & newProc) {
+  //Weigh the local blocks by their fluid nodes and particles, then let every
+  //process compute the same partition from the gathered weights
+  map<int,T> localWeights;
+  vector<plint> const & blocks = hemocell.cellfields->immersedParticles->getLocalInfo().getBlocks();
+  for (plint bid : blocks) {
+    localWeights[bid] = blockWeight(hemocell.cellfields->immersedParticles->getComponent(bid));
+  }
+  HemoCellGatheringFunctional<T>::gather(localWeights);
 
-  map<plint,plint> nTA; //Conversion is necessary for next function
-  for (auto & pair : newProc) { 
-      nTA[pair.first] = pair.second; 
+  map<plint,T> weights(localWeights.begin(),localWeights.end());
+
+  //Only distribute over the processes that hold the (domain) lattice now
+  set<plint> procs;
+  for (auto & pair : original_block_structure->getBulks()) {
+    procs.insert(original_thread_attribution->getMpiProcess(pair.first));
+  }
+  if (!hemocell.preInlet) {
+    for (plint i = 0 ; i < global::mpi().getSize() ; i++) {
+      procs.insert(i);
+    }
+  }
+  vector<plint> processes(procs.begin(),procs.end());
+
+  map<plint,plint> blockToMpi = partitionAlongCurve(*original_block_structure,weights,processes,curve);
+  for (auto & pair : blockToMpi) {
+    newProc[pair.first] = pair.second;
   }
-  ExplicitThreadAttribution* newThreadAttribution = new ExplicitThreadAttribution(nTA);
-  delete original_thread_attribution;
-  original_thread_attribution = newThreadAttribution->clone();
   
-  plint envelopeWidth = hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth();
-  plint refinementLevel = hemocell.lattice->getMultiBlockManagement().getRefinementLevel();
+  pcout << "(LoadBalancer) Partitioned " << blockToMpi.size() << " atomic blocks along a "
+        << (curve == SpaceFillingCurve::Morton ? "Morton" : "Hilbert") << " curve over " << processes.size() << " processes" << endl;
+}
 
-  Dynamics<T,DESCRIPTOR> * dynamics = hemocell.lattice->getBackgroundDynamics().clone();
-  bool perX = hemocell.lattice->periodicity().get(0);
-  bool perY = hemocell.lattice->periodicity().get(1);
-  bool perZ = hemocell.lattice->periodicity().get(2);
-  bool internalStat = hemocell.lattice->isInternalStatisticsOn();
+T LoadBalancer::blockWeight(HemoCellParticleField & pf) {
+  vector<HemoCellParticle *> found;
+  pf.findParticles(pf.localDomain,found);
+  return 1 + pf.nFluidCells + particleWeight*found.size();
+}
 
-  delete hemocell.lattice;
+T LoadBalancer::localWork() {
+  T work = 0;
+  vector<plint> const & blocks = hemocell.cellfields->immersedParticles->getLocalInfo().getBlocks();
+  for (plint bid : blocks) {
+    work += blockWeight(hemocell.cellfields->immersedParticles->getComponent(bid));
+  }
+  return work;
+}
 
-  MultiBlockLattice3D<T,DESCRIPTOR> * newlattice = new
-            MultiBlockLattice3D<T,DESCRIPTOR>(MultiBlockManagement3D (
-            *original_block_structure->clone(),
-            newThreadAttribution->clone(),
-            envelopeWidth,
-            refinementLevel ),
-            defaultMultiBlockPolicy3D().getBlockCommunicator(),                
-            defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T,DESCRIPTOR>(),
-            dynamics );
-  
-  newlattice->periodicity().toggle(0, perX);
-  newlattice->periodicity().toggle(1, perY);
-  newlattice->periodicity().toggle(2, perZ);
-  newlattice->toggleInternalStatistics(internalStat);
- 
-  hemocell.lattice = newlattice;
-  hemocell.cellfields->lattice = newlattice;
-  
-  delete hemocell.cellfields->immersedParticles;
-  hemocell.cellfields->createParticleField(original_block_structure->clone(),newThreadAttribution->clone());
+void LoadBalancer::enableAutoBalance(unsigned int checkEvery, T minimumImbalance, unsigned int horizon) {
+  if (hemocell.preInlet) {
+    hlog << "(LoadBalancer) Automatic load balancing is not supported in combination with a preInlet, ignoring" << endl;
+    return;
+  }
+  autoBalanceEvery = checkEvery;
+  autoBalanceMinimumImbalance = minimumImbalance;
+  autoBalanceHorizon = horizon ? horizon : 10*checkEvery;
+  windowTime = 0;
+  windowSteps = 0;
+  hlog << "(LoadBalancer) Automatic load balancing enabled, checking every " << autoBalanceEvery << " iterations with a horizon of "
+       << autoBalanceHorizon << " iterations and a minimum imbalance of " << autoBalanceMinimumImbalance << endl;
+}
 
-  delete newThreadAttribution;
-  
-  reloadCheckpoint();
-  pcout << "(LoadBalancer) Continuing simulation with balanced application" << endl;
-  
-  return;
+void LoadBalancer::monitorStep(std::chrono::high_resolution_clock::duration stepTime) {
+  windowTime += std::chrono::duration<double>(stepTime).count();
+  windowSteps++;
+  if (hemocell.iter % autoBalanceEvery != 0) {
+    return;
+  }
+
+  //Two small reductions instead of gathering every atomic block
+  double local[2] = {(double)localWork(), windowTime};
+  double maximum[2];
+  double totalWork = 0;
+  MPI_Allreduce(local,maximum,2,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  MPI_Allreduce(&local[0],&totalWork,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+
+  T averageWork = totalWork/global::mpi().getSize();
+  T imbalance = averageWork > 0 ? maximum[0]/averageWork - 1 : 0;
+  double stepSeconds = maximum[1]/windowSteps;
+  windowTime = 0;
+  windowSteps = 0;
+
+  if (measureResidual) {
+    residualImbalance = imbalance;
+    measureResidual = false;
+    hlog << "(LoadBalancer) (Monitor) Iteration " << hemocell.iter << ": imbalance after rebalancing is " << imbalance << endl;
+    return;
+  }
+
+  //Every process waits for the most loaded one, so balancing shortens a step
+  //by the fraction 1 - avg/max, minus what the partitioner could not remove last time
+  T reducible = std::max(imbalance - residualImbalance,(T)0);
+  double gain = stepSeconds*reducible/(1 + imbalance)*autoBalanceHorizon;
+  double cost = lastBalanceCost >= 0 ? lastBalanceCost : initialBalanceCost*stepSeconds;
+  bool rebalance = imbalance > autoBalanceMinimumImbalance && gain > cost;
+
+  hlog << "(LoadBalancer) (Monitor) Iteration " << hemocell.iter << ": imbalance " << imbalance
+       << ", step " << stepSeconds << "s, expected gain " << gain << "s over " << autoBalanceHorizon
+       << " iterations, cost " << cost << "s" << (lastBalanceCost >= 0 ? " (measured)" : " (estimated)")
+       << (rebalance ? ", rebalancing" : ", keeping distribution") << endl;
+  if (!rebalance) {
+    return;
+  }
+
+  std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+  doLoadBalance();
+  double localCost = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+  MPI_Allreduce(&localCost,&lastBalanceCost,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  hlog << "(LoadBalancer) (Monitor) Rebalancing took " << lastBalanceCost << "s" << endl;
+  measureResidual = true;
 }
 
 //Necessary C++ crap
@@ -443,4 +599,4 @@ void LoadBalancer::restructureBlocks(bool checkpoint_available) {
   
   return;
 }
-#endif
+}
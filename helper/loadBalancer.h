@@ -27,25 +27,39 @@ namespace hemo {
   class LoadBalancer;
 }
 #include "hemocell.h"
+#include "sfcPartitioner.h"
 namespace hemo {
 class LoadBalancer {  
   public:
-#ifdef HEMO_PARMETIS
   LoadBalancer(HemoCell & hemocell_);
+  ~LoadBalancer();
   T calculateFractionalLoadImbalance();
   /**
    * Restructure blocks to reduce communication on one processor
    * Set checkpoint_available to false if not called in the same iteration right after doLoadBalance()
    */
   void restructureBlocks(bool checkpoint_available=true);
-#else
-  LoadBalancer(HemoCell & hemocell_):hemocell(hemocell_){};
-  double calculateFractionalLoadImbalance() {return 0.0;}
-  void restructureBlocks(bool checkpoint_available=true) {}
-#endif
 
+  /**
+   * Redistribute the atomic blocks over the mpi processes. Uses ParMETIS when
+   * available (HEMO_PARMETIS) and the built-in space filling curve partitioner
+   * otherwise, or when ["domain"]["partitioner"] is set to "hilbert" or "morton".
+   */
   void doLoadBalance();
 
+  /**
+   * Let HemoCell::iterate() call doLoadBalance() when it pays off. Every
+   * checkEvery iterations the modelled work per process (fluid nodes and
+   * weighted particles) and the step time are reduced over all processes. A
+   * rebalance is triggered when the imbalance exceeds minimumImbalance and the
+   * time it is expected to save within the next horizon iterations (default
+   * 10*checkEvery) exceeds the measured cost of the previous rebalance.
+   */
+  void enableAutoBalance(unsigned int checkEvery, T minimumImbalance = 0.1, unsigned int horizon = 0);
+  bool autoBalanceEnabled() const { return autoBalanceEvery > 0; }
+  /// Record the wall time of one iteration, rebalances if the monitor decides so
+  void monitorStep(std::chrono::high_resolution_clock::duration stepTime);
+
   /**
    * used to reload a checkpoint, but first reload the config file
    */
@@ -53,8 +67,7 @@ class LoadBalancer {
   
   //Functionals for gathering data
   struct TOAB_t{
-    double fluid_time;
-    double particle_time;
+    int n_fluid;
     int n_lsp;
     int mpi_proc;
   };
@@ -81,7 +94,30 @@ class LoadBalancer {
     GatherTimeOfAtomicBlocks * clone() const;
   };
   private:
+  /// Fill newProc (block id -> mpi rank) for all atomic blocks of the original structure
+  void partitionParmetis(map<int,plint> & newProc);
+  void partitionSfc(map<int,plint> & newProc);
+
+  /// Modelled work of an atomic block: its fluid nodes and weighted local particles
+  T blockWeight(HemoCellParticleField & pf);
+  T localWork();
+
   bool FLI_iscalled = false;
+  bool useParmetis = false;
+  SpaceFillingCurve curve = SpaceFillingCurve::Hilbert;
+  /// Cost of a (local) particle relative to a fluid node in the space filling curve partitioner
+  T particleWeight = 10.0;
+
+  //Automatic rebalance monitor
+  unsigned int autoBalanceEvery = 0;
+  unsigned int autoBalanceHorizon = 0;
+  T autoBalanceMinimumImbalance = 0.1;
+  double windowTime = 0;        // Seconds spent in iterate() since the last check
+  unsigned int windowSteps = 0;
+  double lastBalanceCost = -1;  // Seconds of the last rebalance, slowest process, <0 if none yet
+  T initialBalanceCost = 100;   // Assumed cost in iterations until a rebalance has been measured
+  T residualImbalance = 0;      // Imbalance measured right after the last rebalance
+  bool measureResidual = false;
   map<int,TOAB_t> gatherValues;
   HemoCell & hemocell;
   bool original_block_stored = true;
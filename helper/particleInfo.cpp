@@ -89,62 +89,38 @@ ParticleStatistics ParticleInfo::calculateVelocityStatistics(HemoCell* hemocell)
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(hemocell->cellfields->immersedParticles);
   applyProcessingFunctional(new GatherParticleVelocity(gatherValues),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
-  //int numAtomicBlock = hemocell->lattice->getMultiBlockManagement().getSparseBlockStructure().getNumBlocks();
-  HemoCellGatheringFunctional<ParticleStatistics>::gather(gatherValues);
-  
-  ParticleStatistics result = gatherValues.begin()->second;
-  result.avg = 0.;
-  result.ncells = 0;
-  
-  for (const auto & pair : gatherValues) {
-    const ParticleStatistics & cur = pair.second;
-    result.avg += (cur.avg * cur.ncells);
-    result.ncells += cur.ncells;
-    result.min = result.min > cur.min ? cur.min : result.min;
-    result.max = result.max < cur.max ? cur.max : result.max;
-  }
-  
-  result.avg /= result.ncells;
 
-  return result;
+  return HemoCellGatheringFunctional<ParticleStatistics>::reduce(gatherValues);
 }
 
 ParticleStatistics ParticleInfo::calculateForceStatistics(HemoCell* hemocell) {
   map<int,ParticleStatistics> gatherValues;
-  
-  //hemocell->cellfields->interpolateFluidVelocity();
 
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(hemocell->cellfields->immersedParticles);
   applyProcessingFunctional(new GatherParticleForce(gatherValues),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
-  //int numAtomicBlock = hemocell->lattice->getMultiBlockManagement().getSparseBlockStructure().getNumBlocks();
-  HemoCellGatheringFunctional<ParticleStatistics>::gather(gatherValues);
-  
-  if (gatherValues.size() > 0) {
-    ParticleStatistics result = gatherValues.begin()->second;
-    result.avg = 0.;
-    result.ncells = 0;
-
-
-    for (const auto & pair : gatherValues) {
-      const ParticleStatistics & cur = pair.second;
-      result.avg += (cur.avg * cur.ncells);
-      result.ncells += cur.ncells;
-      result.min = result.min > cur.min ? cur.min : result.min;
-      result.max = result.max < cur.max ? cur.max : result.max;
-    }
 
-    result.avg /= result.ncells;
-
-    return result;
-  } else {
-    ParticleStatistics result;
-    result.avg = 0;
-    result.max = 0;
-    result.min = 0;
-    result.ncells = 0;
-    return result;
-  }
+  return HemoCellGatheringFunctional<ParticleStatistics>::reduce(gatherValues);
+}
+
+void ParticleInfo::calculateVelocityStatistics(HemoCell* hemocell, PendingStatistics & pending) {
+  map<int,ParticleStatistics> gatherValues;
+
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(hemocell->cellfields->immersedParticles);
+  applyProcessingFunctional(new GatherParticleVelocity(gatherValues),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+
+  HemoCellGatheringFunctional<ParticleStatistics>::ireduce(gatherValues,pending);
+}
+
+void ParticleInfo::calculateForceStatistics(HemoCell* hemocell, PendingStatistics & pending) {
+  map<int,ParticleStatistics> gatherValues;
+
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(hemocell->cellfields->immersedParticles);
+  applyProcessingFunctional(new GatherParticleForce(gatherValues),hemocell->cellfields->immersedParticles->getBoundingBox(),wrapper);
+
+  HemoCellGatheringFunctional<ParticleStatistics>::ireduce(gatherValues,pending);
 }
 
 GatherParticleVelocity * GatherParticleVelocity::clone() const { return new GatherParticleVelocity(*this); }
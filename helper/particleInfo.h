@@ -34,6 +34,18 @@ struct ParticleStatistics {
   T max;
   T avg;
   pluint ncells;
+
+  /// Merge two partial statistics (reduction operator), empty ones are ignored
+  static ParticleStatistics combine(ParticleStatistics const & a, ParticleStatistics const & b) {
+    if (!a.ncells) { return b; }
+    if (!b.ncells) { return a; }
+    ParticleStatistics r;
+    r.min = a.min < b.min ? a.min : b.min;
+    r.max = a.max > b.max ? a.max : b.max;
+    r.ncells = a.ncells + b.ncells;
+    r.avg = (a.avg*a.ncells + b.avg*b.ncells)/r.ncells;
+    return r;
+  }
 };
 
 class GatherParticleVelocity : public HemoCellGatheringFunctional<ParticleStatistics> {
@@ -51,8 +63,14 @@ class GatherParticleForce : public HemoCellGatheringFunctional<ParticleStatistic
 
 class ParticleInfo {
 public:
+  typedef HemoCellGatheringFunctional<ParticleStatistics>::PendingReduction PendingStatistics;
+
   static ParticleStatistics calculateVelocityStatistics(HemoCell * hemocell_);
   static ParticleStatistics calculateForceStatistics(HemoCell * hemocell_);
+
+  /// Non-blocking variants, the statistics are available from pending.wait()
+  static void calculateVelocityStatistics(HemoCell * hemocell_, PendingStatistics & pending);
+  static void calculateForceStatistics(HemoCell * hemocell_, PendingStatistics & pending);
 };
 
 }
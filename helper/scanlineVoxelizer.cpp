@@ -0,0 +1,132 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "scanlineVoxelizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hemo {
+
+namespace {
+// Twice the signed area of (u,v,p) projected on the yz plane
+inline T edgeFunction(const hemo::Array<T,3> & u, const hemo::Array<T,3> & v, T py, T pz) {
+  return (v[1]-u[1])*(pz-u[2]) - (v[2]-u[2])*(py-u[1]);
+}
+
+// Tie breaking for rays passing exactly through an edge: an edge shared by two
+// triangles is traversed in opposite directions, so exactly one of them owns it
+inline bool ownsEdge(const hemo::Array<T,3> & u, const hemo::Array<T,3> & v) {
+  const T dy = v[1]-u[1], dz = v[2]-u[2];
+  return dz < 0 || (dz == 0 && dy > 0);
+}
+
+inline bool inside(T w, bool owned) {
+  return w > 0 || (w == 0 && owned);
+}
+}
+
+ScanlineVoxelizer::ScanlineVoxelizer(const std::vector<hemo::Array<plint,3>> & triangles_) {
+  triangles.reserve(triangles_.size());
+  for (const hemo::Array<plint,3> & triangle : triangles_) {
+    triangles.push_back({(int)triangle[0],(int)triangle[1],(int)triangle[2]});
+  }
+}
+
+void ScanlineVoxelizer::refit(const std::vector<HemoCellParticle> & particles, const std::vector<int> & cell) {
+  vertices.resize(cell.size());
+  const hemo::Array<T,3> & first = particles[cell[0]].sv.position;
+  bbox = {first[0],first[0],first[1],first[1],first[2],first[2]};
+  for (unsigned int i = 0 ; i < cell.size() ; i++) {
+    const hemo::Array<T,3> & position = particles[cell[i]].sv.position;
+    vertices[i] = position;
+    for (int d = 0 ; d < 3 ; d++) {
+      bbox[2*d] = std::min(bbox[2*d], position[d]);
+      bbox[2*d+1] = std::max(bbox[2*d+1], position[d]);
+    }
+  }
+}
+
+void ScanlineVoxelizer::findInnerNodes(const plb::Box3D & domain, std::vector<hemo::Array<plint,3>> & innerNodes) {
+  // No ray of the domain passes through the cell
+  if (bbox[3] < domain.y0 || bbox[2] > domain.y1 || bbox[5] < domain.z0 || bbox[4] > domain.z1 ||
+      bbox[1] < domain.x0 || bbox[0] > domain.x1) {
+    return;
+  }
+
+  const plint nz = domain.z1 - domain.z0 + 1;
+  crossings.clear();
+
+  // Intersect every triangle with the x-aligned rays through the (y,z) nodes it covers
+  for (const hemo::Array<int,3> & triangle : triangles) {
+    const hemo::Array<T,3> & a = vertices[triangle[0]];
+    const hemo::Array<T,3> * b = &vertices[triangle[1]];
+    const hemo::Array<T,3> * c = &vertices[triangle[2]];
+
+    T area = edgeFunction(a,*b,(*c)[1],(*c)[2]);
+    if (area == 0) { continue; } // Parallel to the rays
+    if (area < 0) {
+      std::swap(b,c);
+      area = -area;
+    }
+
+    const plint y0 = std::max(domain.y0, (plint)std::ceil(std::min({a[1],(*b)[1],(*c)[1]})));
+    const plint y1 = std::min(domain.y1, (plint)std::floor(std::max({a[1],(*b)[1],(*c)[1]})));
+    const plint z0 = std::max(domain.z0, (plint)std::ceil(std::min({a[2],(*b)[2],(*c)[2]})));
+    const plint z1 = std::min(domain.z1, (plint)std::floor(std::max({a[2],(*b)[2],(*c)[2]})));
+
+    const bool ownsA = ownsEdge(*b,*c), ownsB = ownsEdge(*c,a), ownsC = ownsEdge(a,*b);
+
+    for (plint y = y0 ; y <= y1 ; y++) {
+      for (plint z = z0 ; z <= z1 ; z++) {
+        const T wa = edgeFunction(*b,*c,y,z);
+        const T wb = edgeFunction(*c,a,y,z);
+        const T wc = edgeFunction(a,*b,y,z);
+        if (inside(wa,ownsA) && inside(wb,ownsB) && inside(wc,ownsC)) {
+          const T x = (wa*a[0] + wb*(*b)[0] + wc*(*c)[0])/area;
+          crossings.push_back({(y-domain.y0)*nz + (z-domain.z0), x});
+        }
+      }
+    }
+  }
+
+  std::sort(crossings.begin(), crossings.end());
+
+  // Fill the spans between pairs of crossings on each ray (even-odd rule)
+  for (std::size_t i = 0 ; i + 1 < crossings.size() ; ) {
+    if (crossings[i].ray != crossings[i+1].ray) {
+      i++; // Unmatched crossing, the surface is not closed along this ray
+      continue;
+    }
+    const plint y = domain.y0 + crossings[i].ray / nz;
+    const plint z = domain.z0 + crossings[i].ray % nz;
+    const plint x0 = std::max(domain.x0, (plint)std::floor(crossings[i].x) + 1);
+    const plint x1 = std::min(domain.x1, (plint)std::floor(crossings[i+1].x));
+    for (plint x = x0 ; x <= x1 ; x++) {
+      innerNodes.push_back({x,y,z});
+    }
+    i += 2;
+  }
+}
+
+}
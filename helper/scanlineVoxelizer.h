@@ -0,0 +1,73 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_SCANLINEVOXELIZER_H
+#define HEMO_SCANLINEVOXELIZER_H
+
+#include "hemoCellParticle.h"
+#include "array.h"
+#include "core/geometry3D.h"
+#include <vector>
+
+namespace hemo {
+  /**
+   * Finds the lattice nodes enclosed by a closed, triangulated cell.
+   *
+   * Every triangle is intersected once with the x-aligned rays through the
+   * (y,z) lattice nodes it covers; the crossings of each ray are then sorted
+   * and the nodes between every pair of crossings are inside (even-odd rule).
+   * This costs O(triangles + inner nodes) per cell instead of
+   * O(nodes * triangles) for casting a ray per node.
+   *
+   * One voxelizer is built per cell type topology (see
+   * HemoCellField::getVoxelizer()), refit() then copies the vertex positions
+   * of a cell into its arena, after which findInnerNodes() answers the query
+   * for all rays of a domain at once. The buffers are kept between cells, so
+   * no allocations happen after the first few cells. Not thread safe.
+   */
+  class ScanlineVoxelizer {
+  public:
+    explicit ScanlineVoxelizer(const std::vector<hemo::Array<plint,3>> & triangles);
+
+    /// Load the current vertex positions of a (complete) cell
+    void refit(const std::vector<HemoCellParticle> & particles, const std::vector<int> & cell);
+
+    /// Append the inner nodes of the refitted cell within domain (both in
+    /// absolute lattice coordinates) to innerNodes
+    void findInnerNodes(const plb::Box3D & domain, std::vector<hemo::Array<plint,3>> & innerNodes);
+  private:
+    struct Crossing {
+      plint ray;
+      T x;
+      bool operator<(const Crossing & other) const {
+        return ray < other.ray || (ray == other.ray && x < other.x);
+      }
+    };
+    std::vector<hemo::Array<int,3>> triangles;
+    std::vector<hemo::Array<T,3>> vertices;
+    hemo::Array<T,6> bbox;
+    std::vector<Crossing> crossings;
+  };
+}
+
+#endif
@@ -0,0 +1,256 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "sfcPartitioner.h"
+#include "logfile.h"
+
+#include "multiBlock/threadAttribution.h"
+#include "parallelism/mpiManager.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace hemo {
+  using namespace plb;
+
+static const int sfcBits = 21;
+
+SpaceFillingCurve spaceFillingCurveFromString(std::string name) {
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  if (name == "morton") {
+    return SpaceFillingCurve::Morton;
+  }
+  if (name != "hilbert") {
+    hlog << "(SfcPartitioner) Unknown space filling curve \"" << name << "\", using Hilbert" << std::endl;
+  }
+  return SpaceFillingCurve::Hilbert;
+}
+
+uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z) {
+  uint32_t X[3] = {x,y,z};
+  uint64_t key = 0;
+  for (int b = sfcBits - 1 ; b >= 0 ; b--) {
+    for (int i = 0 ; i < 3 ; i++) {
+      key = (key << 1) | ((X[i] >> b) & 1);
+    }
+  }
+  return key;
+}
+
+// Skilling's transpose algorithm ("Programming the Hilbert curve", 2004):
+// transform the coordinates in place, afterwards the key is their bit interleaving
+uint64_t hilbertKey(uint32_t x, uint32_t y, uint32_t z) {
+  uint32_t X[3] = {x,y,z};
+  const uint32_t M = 1u << (sfcBits - 1);
+  uint32_t P, Q, t;
+
+  // Inverse undo
+  for (Q = M ; Q > 1 ; Q >>= 1) {
+    P = Q - 1;
+    for (int i = 0 ; i < 3 ; i++) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+  for (int i = 1 ; i < 3 ; i++) {
+    X[i] ^= X[i-1];
+  }
+  t = 0;
+  for (Q = M ; Q > 1 ; Q >>= 1) {
+    if (X[2] & Q) {
+      t ^= Q - 1;
+    }
+  }
+  for (int i = 0 ; i < 3 ; i++) {
+    X[i] ^= t;
+  }
+
+  return mortonKey(X[0],X[1],X[2]);
+}
+
+void sortBlocksAlongCurve(SparseBlockStructure3D const & structure,
+                          std::vector<plint> & blockIds,
+                          SpaceFillingCurve curve) {
+  Box3D bb = structure.getBoundingBox();
+  plint extent = std::max(bb.getNx(),std::max(bb.getNy(),bb.getNz()));
+  // Block centres are taken on a doubled grid, scale down if the domain does not fit the curve
+  int shift = 0;
+  while ((2*extent >> shift) >= (plint(1) << sfcBits)) {
+    shift++;
+  }
+
+  std::vector<std::pair<uint64_t,plint>> keys;
+  keys.reserve(blockIds.size());
+  for (plint id : blockIds) {
+    Box3D bulk;
+    structure.getBulk(id,bulk);
+    uint32_t cx = (uint32_t)((bulk.x0 + bulk.x1 - 2*bb.x0) >> shift);
+    uint32_t cy = (uint32_t)((bulk.y0 + bulk.y1 - 2*bb.y0) >> shift);
+    uint32_t cz = (uint32_t)((bulk.z0 + bulk.z1 - 2*bb.z0) >> shift);
+    uint64_t key = curve == SpaceFillingCurve::Morton ? mortonKey(cx,cy,cz) : hilbertKey(cx,cy,cz);
+    keys.push_back(std::make_pair(key,id));
+  }
+  // Ties (equal centres cannot occur in a valid structure, but be deterministic anyway) are broken by id
+  std::sort(keys.begin(),keys.end());
+
+  for (unsigned int i = 0 ; i < keys.size() ; i++) {
+    blockIds[i] = keys[i].second;
+  }
+}
+
+std::map<plint,plint> partitionAlongCurve(SparseBlockStructure3D const & structure,
+                                          std::map<plint,T> const & weights,
+                                          std::vector<plint> const & processes,
+                                          SpaceFillingCurve curve) {
+  std::map<plint,plint> blockToMpi;
+  if (processes.empty()) {
+    return blockToMpi;
+  }
+
+  std::vector<plint> blockIds;
+  for (auto const & pair : structure.getBulks()) {
+    blockIds.push_back(pair.first);
+  }
+  sortBlocksAlongCurve(structure,blockIds,curve);
+
+  std::vector<T> blockWeights(blockIds.size());
+  T total = 0;
+  for (unsigned int i = 0 ; i < blockIds.size() ; i++) {
+    auto w = weights.find(blockIds[i]);
+    if (w != weights.end()) {
+      blockWeights[i] = std::max(w->second,(T)0);
+    } else {
+      Box3D bulk;
+      structure.getBulk(blockIds[i],bulk);
+      blockWeights[i] = bulk.nCells();
+    }
+    total += blockWeights[i];
+  }
+
+  const plint nBlocks = blockIds.size();
+  const plint nParts = processes.size();
+  if (nBlocks < nParts) {
+    hlog << "(SfcPartitioner) Warning: only " << nBlocks << " atomic blocks for " << nParts << " processes, some processes will be idle" << std::endl;
+  }
+
+  // Assign every block to the part containing the midpoint of its weight
+  // interval, while never skipping a part and leaving enough blocks to give
+  // every remaining part at least one.
+  T prefix = 0;
+  plint part = -1;
+  for (plint i = 0 ; i < nBlocks ; i++) {
+    plint target = 0;
+    if (total > 0) {
+      target = (plint)((prefix + 0.5*blockWeights[i]) * nParts / total);
+    }
+    target = std::max(target, part);
+    target = std::max(target, nParts - (nBlocks - i));
+    target = std::min(target, part + 1);
+    target = std::min(target, nParts - 1);
+    target = std::max(target, (plint)0);
+    part = target;
+
+    blockToMpi[blockIds[i]] = processes[part];
+    prefix += blockWeights[i];
+  }
+  return blockToMpi;
+}
+
+SparseBlockStructure3D refineBlockStructure(SparseBlockStructure3D const & structure,
+                                            plint nBlocks, plint minExtent) {
+  minExtent = std::max(minExtent,(plint)1);
+  std::vector<Box3D> boxes;
+  for (auto const & pair : structure.getBulks()) {
+    boxes.push_back(pair.second);
+  }
+
+  auto volumeCompare = [](Box3D const & a, Box3D const & b) { return a.nCells() < b.nCells(); };
+  std::make_heap(boxes.begin(),boxes.end(),volumeCompare);
+
+  // Boxes that cannot be split any further are moved out of the heap
+  std::vector<Box3D> finished;
+  while (!boxes.empty() && (plint)(boxes.size() + finished.size()) < nBlocks) {
+    std::pop_heap(boxes.begin(),boxes.end(),volumeCompare);
+    Box3D box = boxes.back();
+    boxes.pop_back();
+
+    plint nx = box.getNx(), ny = box.getNy(), nz = box.getNz();
+    if (std::max(nx,std::max(ny,nz)) < 2*minExtent) {
+      finished.push_back(box);
+      continue;
+    }
+    Box3D lower = box, upper = box;
+    if (nx >= ny && nx >= nz) {
+      lower.x1 = box.x0 + nx/2 - 1;
+      upper.x0 = lower.x1 + 1;
+    } else if (ny >= nz) {
+      lower.y1 = box.y0 + ny/2 - 1;
+      upper.y0 = lower.y1 + 1;
+    } else {
+      lower.z1 = box.z0 + nz/2 - 1;
+      upper.z0 = lower.z1 + 1;
+    }
+    boxes.push_back(lower);
+    std::push_heap(boxes.begin(),boxes.end(),volumeCompare);
+    boxes.push_back(upper);
+    std::push_heap(boxes.begin(),boxes.end(),volumeCompare);
+  }
+  boxes.insert(boxes.end(),finished.begin(),finished.end());
+
+  SparseBlockStructure3D refined(structure.getBoundingBox());
+  for (unsigned int i = 0 ; i < boxes.size() ; i++) {
+    refined.addBlock(boxes[i],i);
+  }
+  return refined;
+}
+
+MultiBlockManagement3D * createSfcManagement3D(MultiBlockManagement3D const & management,
+                                               plint blocksPerProcess,
+                                               SpaceFillingCurve curve) {
+  plint nProcs = global::mpi().getSize();
+  SparseBlockStructure3D sb = refineBlockStructure(management.getSparseBlockStructure(),
+                                                   blocksPerProcess*nProcs,
+                                                   management.getEnvelopeWidth());
+
+  std::vector<plint> processes(nProcs);
+  for (plint i = 0 ; i < nProcs ; i++) {
+    processes[i] = i;
+  }
+  std::map<plint,T> weights; // Empty, so weighted by volume
+  std::map<plint,plint> blockToMpi = partitionAlongCurve(sb,weights,processes,curve);
+
+  hlog << "(SfcPartitioner) Distributed " << sb.getNumBlocks() << " atomic blocks over " << nProcs << " processes along a "
+       << (curve == SpaceFillingCurve::Morton ? "Morton" : "Hilbert") << " curve" << std::endl;
+
+  return new MultiBlockManagement3D(sb, new ExplicitThreadAttribution(blockToMpi),
+                                    management.getEnvelopeWidth(), management.getRefinementLevel());
+}
+
+}
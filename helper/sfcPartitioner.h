@@ -0,0 +1,96 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SFCPARTITIONER_H
+#define SFCPARTITIONER_H
+
+#include "constant_defaults.h"
+#include "multiBlock/multiBlockManagement3D.h"
+#include "multiBlock/sparseBlockStructure3D.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Space-filling-curve partitioning of atomic blocks.
+ *
+ * Atomic blocks are ordered along a Hilbert (or Morton) curve through their
+ * centres and the resulting sequence is cut into contiguous ranges of roughly
+ * equal weight, one range per MPI process. Contiguous pieces of a Hilbert curve
+ * are spatially compact, which keeps the communication surface low without
+ * needing an external graph partitioner such as ParMETIS.
+ */
+namespace hemo {
+
+enum class SpaceFillingCurve {Hilbert, Morton};
+
+/// Parse "hilbert" or "morton" (case insensitive), defaults to Hilbert
+SpaceFillingCurve spaceFillingCurveFromString(std::string name);
+
+/// Keys of a point on a 2^21 x 2^21 x 2^21 grid
+uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z);
+uint64_t hilbertKey(uint32_t x, uint32_t y, uint32_t z);
+
+/**
+ * Order the blocks of a structure along a space filling curve
+ *
+ * @param blockIds the atomic blocks to order, sorted in place
+ */
+void sortBlocksAlongCurve(plb::SparseBlockStructure3D const & structure,
+                          std::vector<plb::plint> & blockIds,
+                          SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+
+/**
+ * Cut the curve through all blocks of a structure into contiguous ranges of
+ * (roughly) equal weight and assign each range to one of the given processes.
+ *
+ * @param weights the cost per block id, missing blocks are weighted by their volume
+ * @param processes the MPI ranks to distribute over, in curve order
+ * @return a map from block id to MPI rank, usable by ExplicitThreadAttribution
+ */
+std::map<plb::plint,plb::plint> partitionAlongCurve(plb::SparseBlockStructure3D const & structure,
+                                                    std::map<plb::plint,T> const & weights,
+                                                    std::vector<plb::plint> const & processes,
+                                                    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+
+/**
+ * Split the blocks of a structure until there are at least nBlocks of them,
+ * by repeatedly halving the largest block along its longest axis. The covered
+ * domain is left untouched, so sparse structures (e.g. from a voxelized STL)
+ * stay sparse. Blocks are not split below minExtent lattice nodes.
+ */
+plb::SparseBlockStructure3D refineBlockStructure(plb::SparseBlockStructure3D const & structure,
+                                                 plb::plint nBlocks, plb::plint minExtent);
+
+/**
+ * Create a management with blocksPerProcess atomic blocks per MPI process,
+ * derived from an existing (possibly sparse) management and distributed along
+ * a space filling curve, weighted by block volume.
+ */
+plb::MultiBlockManagement3D * createSfcManagement3D(plb::MultiBlockManagement3D const & management,
+                                                    plb::plint blocksPerProcess,
+                                                    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+}
+#endif
@@ -32,6 +32,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "palabos3D.h"
 #include "palabos3D.hh"
 #include "genericFunctions.h"
+#include "sfcPartitioner.h"
+
+#include <mpi.h>
+#include <cmath>
 
 namespace hemo {
   using namespace std;
@@ -151,4 +155,189 @@ void getFlagMatrixFromSTL(std::string meshFileName, plint extendedEnvelopeWidth,
 
 }
 
+// ---------------------- Sparse block decomposition ---------------------------
+
+namespace {
+// Fluid statistics of the bounding box, sampled on a grid of minBlockSize cells
+struct CoarseFluidGrid {
+  plb::Box3D bb;
+  plint cellSize;
+  plint nx, ny, nz;
+  std::vector<long> fluid;   // Fluid nodes per coarse cell
+  std::vector<long> needed;  // Nonzero if the cell (extended by one node) touches fluid
+
+  inline plint index(plint cx, plint cy, plint cz) const { return (cx*ny + cy)*nz + cz; }
+
+  // Returns the number of fluid nodes in a box of coarse cells and counts the cells without fluid nearby
+  long statistics(plb::Box3D const & cbox, plint & emptyCells) const {
+    long sum = 0;
+    emptyCells = 0;
+    for (plint cx = cbox.x0 ; cx <= cbox.x1 ; cx++) {
+      for (plint cy = cbox.y0 ; cy <= cbox.y1 ; cy++) {
+        for (plint cz = cbox.z0 ; cz <= cbox.z1 ; cz++) {
+          sum += fluid[index(cx,cy,cz)];
+          if (!needed[index(cx,cy,cz)]) {
+            emptyCells++;
+          }
+        }
+      }
+    }
+    return sum;
+  }
+
+  plb::Box3D toLattice(plb::Box3D const & cbox) const {
+    return plb::Box3D(bb.x0 + cbox.x0*cellSize, std::min(bb.x0 + (cbox.x1+1)*cellSize - 1, bb.x1),
+                      bb.y0 + cbox.y0*cellSize, std::min(bb.y0 + (cbox.y1+1)*cellSize - 1, bb.y1),
+                      bb.z0 + cbox.z0*cellSize, std::min(bb.z0 + (cbox.z1+1)*cellSize - 1, bb.z1));
+  }
+};
+
+void refineFluidBlock(CoarseFluidGrid const & grid, plb::Box3D const & cbox,
+                      std::vector<plb::Box3D> & blocks, std::vector<long> & weights) {
+  plint emptyCells;
+  long nFluid = grid.statistics(cbox,emptyCells);
+  plint nCells = cbox.nCells();
+  if (emptyCells == nCells) {
+    return; // Entirely solid, do not instantiate
+  }
+  if (emptyCells == 0 || nCells == 1) {
+    blocks.push_back(grid.toLattice(cbox));
+    weights.push_back(nFluid);
+    return;
+  }
+  // Crosses the wall, split in (up to) eight octants
+  plint mx = (cbox.x0 + cbox.x1)/2, my = (cbox.y0 + cbox.y1)/2, mz = (cbox.z0 + cbox.z1)/2;
+  plint xs[3] = {cbox.x0, mx, cbox.x1}, ys[3] = {cbox.y0, my, cbox.y1}, zs[3] = {cbox.z0, mz, cbox.z1};
+  for (int i = 0 ; i < 2 ; i++) {
+    if (i == 1 && cbox.x0 == cbox.x1) continue;
+    for (int j = 0 ; j < 2 ; j++) {
+      if (j == 1 && cbox.y0 == cbox.y1) continue;
+      for (int k = 0 ; k < 2 ; k++) {
+        if (k == 1 && cbox.z0 == cbox.z1) continue;
+        plb::Box3D child(i ? xs[1]+1 : xs[0], i || cbox.x0 == cbox.x1 ? xs[2] : xs[1],
+                         j ? ys[1]+1 : ys[0], j || cbox.y0 == cbox.y1 ? ys[2] : ys[1],
+                         k ? zs[1]+1 : zs[0], k || cbox.z0 == cbox.z1 ? zs[2] : zs[1]);
+        refineFluidBlock(grid,child,blocks,weights);
+      }
+    }
+  }
+}
+}
+
+MultiBlockManagement3D * createSparseFluidManagement(MultiScalarField3D<int> *& flagMatrix, plint blockSize, plint minBlockSize, plint envelopeWidth) {
+  Box3D bb = flagMatrix->getBoundingBox();
+  if (minBlockSize < 1) {
+    minBlockSize = 1;
+  }
+  if (blockSize > 0 && blockSize < minBlockSize) {
+    hlog << "(Voxelizer) (Warning) blockSize (" << blockSize << ") is smaller than minBlockSize, using " << minBlockSize << endl;
+    blockSize = minBlockSize;
+  }
+
+  CoarseFluidGrid grid;
+  grid.bb = bb;
+  grid.cellSize = minBlockSize;
+  grid.nx = (bb.getNx() + minBlockSize - 1)/minBlockSize;
+  grid.ny = (bb.getNy() + minBlockSize - 1)/minBlockSize;
+  grid.nz = (bb.getNz() + minBlockSize - 1)/minBlockSize;
+  plint nCoarse = grid.nx*grid.ny*grid.nz;
+
+  // Count the local fluid nodes, then sum over all processes
+  std::vector<long> local(2*nCoarse,0);
+  std::vector<plint> const & localBlocks = flagMatrix->getLocalInfo().getBlocks();
+  for (plint bid : localBlocks) {
+    ScalarField3D<int> & flags = flagMatrix->getComponent(bid);
+    Dot3D location = flags.getLocation();
+    Box3D bulk;
+    flagMatrix->getSparseBlockStructure().getBulk(bid,bulk);
+    for (plint iX = bulk.x0 ; iX <= bulk.x1 ; iX++) {
+      for (plint iY = bulk.y0 ; iY <= bulk.y1 ; iY++) {
+        for (plint iZ = bulk.z0 ; iZ <= bulk.z1 ; iZ++) {
+          if (flags.get(iX-location.x,iY-location.y,iZ-location.z) <= 0) {
+            continue;
+          }
+          plint x = iX - bb.x0, y = iY - bb.y0, z = iZ - bb.z0;
+          local[grid.index(x/minBlockSize,y/minBlockSize,z/minBlockSize)]++;
+          // The solid nodes next to the fluid must exist as well for the bounce back
+          for (plint cx = std::max(x-1,(plint)0)/minBlockSize ; cx <= std::min(x+1,bb.getNx()-1)/minBlockSize ; cx++) {
+            for (plint cy = std::max(y-1,(plint)0)/minBlockSize ; cy <= std::min(y+1,bb.getNy()-1)/minBlockSize ; cy++) {
+              for (plint cz = std::max(z-1,(plint)0)/minBlockSize ; cz <= std::min(z+1,bb.getNz()-1)/minBlockSize ; cz++) {
+                local[nCoarse + grid.index(cx,cy,cz)] = 1;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  std::vector<long> total(2*nCoarse);
+  MPI_Allreduce(&local[0],&total[0],2*nCoarse,MPI_LONG,MPI_SUM,MPI_COMM_WORLD);
+  grid.fluid.assign(total.begin(),total.begin()+nCoarse);
+  grid.needed.assign(total.begin()+nCoarse,total.end());
+
+  // Without a blockSize, give every process about one block worth of fluid
+  if (blockSize <= 0) {
+    long nFluid = 0;
+    for (long n : grid.fluid) {
+      nFluid += n;
+    }
+    blockSize = plint(ceil(cbrt(T(nFluid)/global::mpi().getSize())));
+    blockSize = std::max(minBlockSize, ((blockSize + minBlockSize - 1)/minBlockSize)*minBlockSize);
+    hlog << "(Voxelizer) No blockSize given, using " << blockSize << " from " << nFluid << " fluid nodes over " << global::mpi().getSize() << " processes" << endl;
+  }
+
+  // Tile with blocks of blockSize and refine those at the wall
+  plint rootSize = (blockSize + minBlockSize - 1)/minBlockSize;
+  std::vector<Box3D> blocks;
+  std::vector<long> fluidPerBlock;
+  for (plint cx = 0 ; cx < grid.nx ; cx += rootSize) {
+    for (plint cy = 0 ; cy < grid.ny ; cy += rootSize) {
+      for (plint cz = 0 ; cz < grid.nz ; cz += rootSize) {
+        Box3D root(cx, std::min(cx+rootSize,grid.nx)-1,
+                   cy, std::min(cy+rootSize,grid.ny)-1,
+                   cz, std::min(cz+rootSize,grid.nz)-1);
+        refineFluidBlock(grid,root,blocks,fluidPerBlock);
+      }
+    }
+  }
+
+  SparseBlockStructure3D sb(bb);
+  std::map<plint,T> weights;
+  plint allocated = 0;
+  for (unsigned int i = 0 ; i < blocks.size() ; i++) {
+    sb.addBlock(blocks[i],i);
+    weights[i] = 1 + fluidPerBlock[i];
+    allocated += blocks[i].nCells();
+  }
+
+  std::vector<plint> processes(global::mpi().getSize());
+  for (unsigned int i = 0 ; i < processes.size() ; i++) {
+    processes[i] = i;
+  }
+  std::map<plint,plint> blockToMpi = partitionAlongCurve(sb,weights,processes);
+
+  hlog << "(Voxelizer) Sparse decomposition: " << blocks.size() << " atomic blocks, allocating " << allocated
+       << " of " << bb.nCells() << " nodes (" << (100.*allocated)/bb.nCells() << "%) of the bounding box" << endl;
+
+  MultiBlockManagement3D * management = new MultiBlockManagement3D(sb, new ExplicitThreadAttribution(blockToMpi), envelopeWidth);
+
+  // Move the flags to the new decomposition, nodes that did not exist before become solid
+  MultiScalarField3D<int> * newFlagMatrix = new MultiScalarField3D<int>(*management,
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiScalarAccess<int>(), 0);
+  copy(*flagMatrix, bb, *newFlagMatrix, bb, modif::staticVariables);
+  delete flagMatrix;
+  flagMatrix = newFlagMatrix;
+
+  return management;
+}
+
+MultiBlockManagement3D * createSparseFluidManagement(std::auto_ptr<MultiScalarField3D<int>> & flagMatrix, plint blockSize, plint minBlockSize, plint envelopeWidth) {
+  MultiScalarField3D<int> * flagMatrix_t = flagMatrix.release();
+  MultiBlockManagement3D * management = createSparseFluidManagement(flagMatrix_t, blockSize, minBlockSize, envelopeWidth);
+  flagMatrix = std::auto_ptr<MultiScalarField3D<int>>(flagMatrix_t);
+  return management;
+}
+
 }
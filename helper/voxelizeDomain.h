@@ -51,5 +51,20 @@ void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeW
                           plb::VoxelizedDomain3D<T> *&voxelizedDomain, plb::MultiScalarField3D<int> *&flagMatrix, plint blockSize, int particleEnvelope = 0);
 void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeWidth, plb::plint refDirLength, plb::plint refDir,
                           std::auto_ptr<plb::VoxelizedDomain3D<T>> & voxelizedDomain, std::auto_ptr<plb::MultiScalarField3D<int>> &flagMatrix, plint blockSize, int particleEnvelope = 0);
+
+/**
+ * Create a sparse domain management that only instantiates atomic blocks
+ * containing fluid nodes (flag > 0) or the solid layer next to them. The
+ * bounding box is tiled with blocks of blockSize, blocks that cross the wall
+ * are split octree-style down to minBlockSize so that the allocated volume
+ * follows the vessel. The blocks are distributed over the processes along a
+ * Hilbert curve, weighted by their number of fluid nodes. A blockSize <= 0
+ * (e.g. <blockSize> -1) is derived from the number of fluid nodes per process.
+ *
+ * The flagMatrix is replaced by a copy on the new management, so it can be used
+ * directly with defineDynamics on a lattice created from the returned management.
+ */
+plb::MultiBlockManagement3D * createSparseFluidManagement(plb::MultiScalarField3D<int> *& flagMatrix, plint blockSize, plint minBlockSize, plint envelopeWidth);
+plb::MultiBlockManagement3D * createSparseFluidManagement(std::auto_ptr<plb::MultiScalarField3D<int>> & flagMatrix, plint blockSize, plint minBlockSize, plint envelopeWidth);
 }
 #endif
@@ -0,0 +1,171 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "wallDistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hemo {
+
+WallDistanceField::WallDistanceField(plb::BlockLattice3D<T,DESCRIPTOR> & lattice_, plint range_)
+  : lattice(lattice_), box(lattice_.getBoundingBox()), range(std::min<plint>(std::max<plint>(range_,1),127)),
+    cells(box.getNx()*box.getNy()*box.getNz())
+{
+  for (plint x = box.x0 ; x <= box.x1 ; x++) {
+    for (plint y = box.y0 ; y <= box.y1 ; y++) {
+      for (plint z = box.z0 ; z <= box.z1 ; z++) {
+        cells[index(x,y,z)].flags = lattice.get(x,y,z).getDynamics().isBoundary() ? WALL : 0;
+      }
+    }
+  }
+  computeNearest(box);
+}
+
+void WallDistanceField::ensureRange(plint range_) {
+  if (range_ <= range) { return; }
+  range = std::min<plint>(range_,127);
+  computeNearest(box);
+}
+
+void WallDistanceField::refresh(const plb::Box3D & domain) {
+  plb::Box3D changed;
+  if (!plb::intersect(domain, box, changed)) { return; }
+  for (plint x = changed.x0 ; x <= changed.x1 ; x++) {
+    for (plint y = changed.y0 ; y <= changed.y1 ; y++) {
+      for (plint z = changed.z0 ; z <= changed.z1 ; z++) {
+        Cell & cell = cells[index(x,y,z)];
+        cell.flags = (cell.flags & ~WALL) | (lattice.get(x,y,z).getDynamics().isBoundary() ? WALL : 0);
+      }
+    }
+  }
+  // The surface changes up to a node beyond the changed nodes, and so do the
+  // nearest surface nodes up to range beyond that
+  plb::Box3D affected;
+  plb::intersect(changed.enlarge(range+1), box, affected);
+  computeNearest(affected);
+}
+
+bool WallDistanceField::isSurface(plint x, plint y, plint z) const {
+  if (!(cells[index(x,y,z)].flags & WALL)) { return false; }
+  for (plint xx = std::max(x-1,box.x0) ; xx <= std::min(x+1,box.x1) ; xx++) {
+    for (plint yy = std::max(y-1,box.y0) ; yy <= std::min(y+1,box.y1) ; yy++) {
+      for (plint zz = std::max(z-1,box.z0) ; zz <= std::min(z+1,box.z1) ; zz++) {
+        if (!(cells[index(xx,yy,zz)].flags & WALL)) { return true; }
+      }
+    }
+  }
+  return false;
+}
+
+void WallDistanceField::computeNearest(const plb::Box3D & domain) {
+  for (plint x = domain.x0 ; x <= domain.x1 ; x++) {
+    for (plint y = domain.y0 ; y <= domain.y1 ; y++) {
+      for (plint z = domain.z0 ; z <= domain.z1 ; z++) {
+        cells[index(x,y,z)].flags &= ~KNOWN;
+      }
+    }
+  }
+
+  // Every surface node that can be the nearest of a node in domain stamps the
+  // nodes of domain within range, keeping the closest
+  plb::Box3D sources;
+  plb::intersect(domain.enlarge(range), box, sources);
+  const plint range2 = range*range;
+  for (plint x = sources.x0 ; x <= sources.x1 ; x++) {
+    for (plint y = sources.y0 ; y <= sources.y1 ; y++) {
+      for (plint z = sources.z0 ; z <= sources.z1 ; z++) {
+        if (!isSurface(x,y,z)) { continue; }
+        for (plint tx = std::max(x-range,domain.x0) ; tx <= std::min(x+range,domain.x1) ; tx++) {
+          for (plint ty = std::max(y-range,domain.y0) ; ty <= std::min(y+range,domain.y1) ; ty++) {
+            for (plint tz = std::max(z-range,domain.z0) ; tz <= std::min(z+range,domain.z1) ; tz++) {
+              const plint ox = x-tx, oy = y-ty, oz = z-tz;
+              const plint distance2 = ox*ox + oy*oy + oz*oz;
+              if (distance2 > range2) { continue; }
+              Cell & cell = cells[index(tx,ty,tz)];
+              if (cell.flags & KNOWN) {
+                const plint current2 = cell.offset[0]*cell.offset[0] + cell.offset[1]*cell.offset[1] + cell.offset[2]*cell.offset[2];
+                if (current2 <= distance2) { continue; }
+              }
+              cell.offset[0] = ox;
+              cell.offset[1] = oy;
+              cell.offset[2] = oz;
+              cell.flags |= KNOWN;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+T WallDistanceField::signedDistance(plint x, plint y, plint z) const {
+  const Cell & cell = cells[index(x,y,z)];
+  const T sign = (cell.flags & WALL) ? -1. : 1.;
+  if (!(cell.flags & KNOWN)) { return sign*(range+1); }
+  return sign*std::sqrt(T(cell.offset[0]*cell.offset[0] + cell.offset[1]*cell.offset[1] + cell.offset[2]*cell.offset[2]));
+}
+
+hemo::Array<T,3> WallDistanceField::gradient(plint x, plint y, plint z) const {
+  const Cell & cell = cells[index(x,y,z)];
+  hemo::Array<T,3> direction = {0.,0.,0.};
+  if (!(cell.flags & KNOWN)) { return direction; }
+  const T length = std::sqrt(T(cell.offset[0]*cell.offset[0] + cell.offset[1]*cell.offset[1] + cell.offset[2]*cell.offset[2]));
+  if (length == 0) { return direction; }
+  const T sign = (cell.flags & WALL) ? 1. : -1.; // The offset points towards the surface
+  for (int d = 0 ; d < 3 ; d++) {
+    direction[d] = sign*cell.offset[d]/length;
+  }
+  return direction;
+}
+
+plb::Dot3D WallDistanceField::clamp(const plb::Dot3D & node) const {
+  return plb::Dot3D(std::min(std::max(node.x,box.x0),box.x1),
+                    std::min(std::max(node.y,box.y0),box.y1),
+                    std::min(std::max(node.z,box.z0),box.z1));
+}
+
+bool WallDistanceField::fromWall(const hemo::Array<T,3> & position, hemo::Array<T,3> & fromWall) const {
+  const plb::Dot3D & location = lattice.getLocation();
+  const plb::Dot3D node((plint)(position[0]-location.x+0.5), (plint)(position[1]-location.y+0.5), (plint)(position[2]-location.z+0.5));
+  if (!contains(node.x,node.y,node.z)) { return false; }
+  const Cell & cell = cells[index(node.x,node.y,node.z)];
+  if (!(cell.flags & KNOWN)) { return false; }
+  fromWall = {position[0] - (node.x + cell.offset[0] + location.x),
+              position[1] - (node.y + cell.offset[1] + location.y),
+              position[2] - (node.z + cell.offset[2] + location.z)};
+  return true;
+}
+
+bool WallDistanceField::nearWall(const plb::Dot3D & node, T distance) const {
+  const plb::Dot3D inside = clamp(node);
+  const Cell & cell = cells[index(inside.x,inside.y,inside.z)];
+  if (contains(node.x,node.y,node.z) && (cell.flags & WALL)) { return true; }
+  if (!(cell.flags & KNOWN)) { return false; }
+  const plint ox = inside.x + cell.offset[0] - node.x;
+  const plint oy = inside.y + cell.offset[1] - node.y;
+  const plint oz = inside.z + cell.offset[2] - node.z;
+  return ox*ox + oy*oy + oz*oz <= distance*distance;
+}
+
+}
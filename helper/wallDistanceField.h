@@ -0,0 +1,104 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_WALLDISTANCEFIELD_H
+#define HEMO_WALLDISTANCEFIELD_H
+
+#include "constant_defaults.h"
+#include "array.h"
+#include "core/geometry3D.h"
+#include "atomicBlock/blockLattice3D.h"
+#include <vector>
+
+namespace hemo {
+  /**
+   * Signed distance from every node of an atomic lattice block to the wall.
+   *
+   * The wall surface consists of the boundary nodes next to a fluid node.
+   * Every node within range of the surface stores the offset to its nearest
+   * surface node, so the distance to the wall and its gradient (the direction
+   * away from the wall) are a lookup, also for off-lattice positions. Nodes
+   * further away than the range are only known to be far. Distances are
+   * positive in the fluid and negative within the wall.
+   *
+   * Built from the dynamics of the block on first use, see
+   * HemoCellParticleField::getWallDistance(). When nodes become walls (e.g.
+   * solidification) refresh() updates the affected region.
+   */
+  class WallDistanceField {
+  public:
+    WallDistanceField(plb::BlockLattice3D<T,DESCRIPTOR> & lattice, plint range);
+
+    /// Rebuild with a larger range when range exceeds the current one
+    void ensureRange(plint range);
+    plint getRange() const { return range; }
+
+    /// Walls changed within domain (relative to the block), update what depends on it
+    void refresh(const plb::Box3D & domain);
+
+    bool isWall(plint x, plint y, plint z) const { return cells[index(x,y,z)].flags & WALL; }
+    /// A wall node (relative) next to a non-wall node
+    bool isSurface(plint x, plint y, plint z) const;
+
+    /// Signed distance of a node (relative) to the wall, or +-(range+1) when further away
+    T signedDistance(plint x, plint y, plint z) const;
+
+    /// Unit vector pointing away from the wall at a node, zero when far away or on the surface
+    hemo::Array<T,3> gradient(plint x, plint y, plint z) const;
+
+    /**
+     * Vector from the nearest wall surface node to an absolute position,
+     * looked up at the node nearest to the position. Returns false when that
+     * node is outside the block or no wall surface node lies within range.
+     */
+    bool fromWall(const hemo::Array<T,3> & position, hemo::Array<T,3> & fromWall) const;
+
+    /// True when a node (relative, may lie outside the block) is a wall or
+    /// lies within distance of the wall surface
+    bool nearWall(const plb::Dot3D & node, T distance) const;
+
+  private:
+    enum : unsigned char { WALL = 1, KNOWN = 2 };
+    struct Cell {
+      signed char offset[3]; // To the nearest surface node, valid when KNOWN
+      unsigned char flags;
+    };
+
+    plb::BlockLattice3D<T,DESCRIPTOR> & lattice;
+    plb::Box3D box;
+    plint range;
+    std::vector<Cell> cells;
+
+    plint index(plint x, plint y, plint z) const {
+      return ((x-box.x0)*box.getNy() + (y-box.y0))*box.getNz() + (z-box.z0);
+    }
+    bool contains(plint x, plint y, plint z) const {
+      return x >= box.x0 && x <= box.x1 && y >= box.y0 && y <= box.y1 && z >= box.z0 && z <= box.z1;
+    }
+    plb::Dot3D clamp(const plb::Dot3D & node) const;
+    /// Recompute the nearest surface nodes of the nodes in domain
+    void computeNearest(const plb::Box3D & domain);
+  };
+}
+
+#endif
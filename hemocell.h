@@ -41,7 +41,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /* Helpers */
 #include "preInlet.h"
-// #include "leesEdwardsBC.h"
 
 /* Always used palabos functions in case files*/
 #ifndef COMPILING_HEMOCELL_LIBRARY
@@ -54,6 +53,8 @@ using namespace plb;
 
 namespace hemo { 
 
+class LeesEdwardsBC;
+
 /*!
  * The HemoCell class contains all the information, data and methods to set up a
  * basic HemoCell simulation.
@@ -142,12 +143,23 @@ class HemoCell {
   bool boundaryRepulsionEnabled = false;
   void setRepulsion(T repulsionConstant, T repulsionCutoff);
 
-  // Lees-Edwards boundary condition
-  bool leesEdwardsBC = false;
-  double * LEcurrentDisplacement;
+  // Lees-Edwards boundary condition, registered by its constructor and applied after every collideAndStream
+  LeesEdwardsBC * leesEdwards = 0;
+
+  //Clear the spread force on the kernel nodes of the particles, after the velocity interpolation, instead of the
+  //external force of the whole lattice. Only valid when the external force holds nothing but the spread force,
+  //e.g. when a driving force is given to GuoBodyForceBGKdynamics instead of set with setExternalVector
+  bool sparseForceReset = false;
+  void enableSparseForceReset() {
+    hlog << "(HemoCell) Clearing the spread force on the kernel nodes of the particles only" << endl;
+    sparseForceReset = true;
+  }
 
   //Set the timescale separation of the particles of a particle type
   void setMaterialTimeScaleSeparation(string name, unsigned int separation);
+
+  //Sub-cycle the membrane of a particle type this many times per fluid step (stiff cells), overrides <substeps> of the cell xml
+  void setMaterialSubsteps(string name, unsigned int substeps);
   
   //Enable solidify mechanics of a celltype
   void enableSolidifyMechanics(string name) {
@@ -165,6 +177,9 @@ class HemoCell {
 
   //Set the timescale separation of the interior viscosity, in between update and raytracing (expensive) update
   void setInteriorViscosityTimeScaleSeperation(unsigned int separation, unsigned int separation_entire_grid);
+
+  //Only recompute the interior of cells with a vertex that moved further than displacement (lbm units) since its last entire grid refresh, and apply the difference
+  void setInteriorViscosityRefreshDisplacement(T displacement);
   
   //Enable Boundary particles and set the boundary particle constants
   void enableBoundaryParticles(T boundaryRepulsionConstant, T boundaryRepulsionCutoff, unsigned int timestep = 1);
@@ -217,6 +232,9 @@ public:
   ///Load balance the domain (only necessary with nAtomic blocks > nMpi processors, also checkpoints
   void doLoadBalance();
   
+  ///Rebalance automatically from iterate() when the monitored imbalance makes it worthwhile, must be called after initializeCellfield(), see LoadBalancer::enableAutoBalance
+  void setAutoLoadBalance(unsigned int checkEvery, T minimumImbalance = 0.1, unsigned int horizon = 0);
+  
   ///Restructure the grid, has an optional argument to specify whether a checkpoint from this iteration is available, default is YES!
   void doRestructure(bool checkpoint_avail = true);
   
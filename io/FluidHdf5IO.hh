@@ -359,6 +359,10 @@ private:
         for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
 
           output[n] = ablock->get(iX,iY,iZ).getDynamics().getOmega();
+          // The fused collision may take the tau of interior nodes from the field
+          if (particlefield->interiorViscosityField && particlefield->interiorViscosityField->get(iX,iY,iZ)) {
+            output[n] = 1./particlefield->interiorViscosityField->get(iX,iY,iZ);
+          }
           n++;
         }
       }
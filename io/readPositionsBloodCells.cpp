@@ -22,8 +22,11 @@ You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "readPositionsBloodCells.h"
-#include "tools/packCells/geometry.h"
+#include "wallDistanceField.h"
 #include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <mpi.h>
 #include "logfile.h"
 #include "hemocell.h"
 #include "preInlet.h"
@@ -33,37 +36,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
 
-/// Rotates a triangular surface mesh inplace. The rotation is applied in order
+namespace {
+
+/// Rotation matrix for the cell templates. The rotation is applied in order
 /// X, Y, Z. NOTE: plb::TriangularSurfaceMesh does provide an method to rotate
 /// the surface mesh, however, that routine is defined in ZYX order.
-template<typename T>
-void rotateTriangularMeshXYZ(plb::TriangularSurfaceMesh<T>* mesh, T alpha, T beta, T gamma) {
-  PLB_ASSERT((theta > T() || util::fpequal(theta, T(), eps0)) &&
-             (theta < PI  || util::fpequal(theta, PI, eps0)));
+void rotationMatrixXYZ(const hemo::Array<T,3> & angles, T rotation[3][3]) {
+  const T alpha = angles[0], beta = angles[1], gamma = angles[2];
 
   // Rotation matrix around x axis (column-first)
-  T a[3][3];
-  a[0][0] =  (T) 1.0;
-  a[0][1] =  (T) 0.0;
-  a[0][2] =  (T) 0.0;
-  a[1][0] =  (T) 0.0;
-  a[1][1] =  std::cos(alpha);
-  a[1][2] =  std::sin(alpha);
-  a[2][0] =  (T) 0.0;
-  a[2][1] = -std::sin(alpha);
-  a[2][2] =  std::cos(alpha);
+  const T a[3][3] = {{(T)1.0, (T)0.0, (T)0.0},
+                     {(T)0.0, std::cos(alpha), std::sin(alpha)},
+                     {(T)0.0, -std::sin(alpha), std::cos(alpha)}};
 
   // Rotation matrix around y axis (column-first)
-  T b[3][3];
-  b[0][0] =  std::cos(beta);
-  b[0][1] =  (T) 0.0;
-  b[0][2] =  -std::sin(beta);
-  b[1][0] =  (T) 0.0;
-  b[1][1] =  (T) 1.0;
-  b[1][2] =  (T) 0.0;
-  b[2][0] =  std::sin(beta);
-  b[2][1] =  (T) 0.0;
-  b[2][2] =  std::cos(beta);
+  const T b[3][3] = {{std::cos(beta), (T)0.0, -std::sin(beta)},
+                     {(T)0.0, (T)1.0, (T)0.0},
+                     {std::sin(beta), (T)0.0, std::cos(beta)}};
+
+  // Rotation matrix around z axis (column-first)
+  const T g[3][3] = {{std::cos(gamma), std::sin(gamma), (T)0.0},
+                     {-std::sin(gamma), std::cos(gamma), (T)0.0},
+                     {(T)0.0, (T)0.0, (T)1.0}};
 
   // Ry * Rx
   T c[3][3];
@@ -76,115 +70,290 @@ void rotateTriangularMeshXYZ(plb::TriangularSurfaceMesh<T>* mesh, T alpha, T bet
       }
   }
 
-  // Rotation matrix around z axis (column-first)
-  b[0][0] =  std::cos(gamma);
-  b[0][1] =  std::sin(gamma);
-  b[0][2] =  (T) 0.0;
-  b[1][0] = -std::sin(gamma);
-  b[1][1] =  std::cos(gamma);
-  b[1][2] =  (T) 0.0;
-  b[2][0] =  (T) 0.0;
-  b[2][1] =  (T) 0.0;
-  b[2][2] =  (T) 1.0;
-
   // Rz * [Ry*Rx]
   for (int i = 0; i < 3; i++) {
       for (int j = 0; j < 3; j++) {
-          a[i][j] = (T) 0.0;
+          rotation[i][j] = (T) 0.0;
           for (int k = 0; k < 3; k++) {
-              a[i][j] += c[k][j]*b[i][k];
-          }
-      }
-  }
-
-  for (auto iVertex = 0; iVertex < mesh->getNumVertices(); iVertex++) {
-      Array<T,3> x = mesh->getVertex(iVertex);
-      for (int i = 0; i < 3; i++) {
-          mesh->getVertex(iVertex)[i] = (T) 0.0;
-          for (int j = 0; j < 3; j++) {
-              mesh->getVertex(iVertex)[i] += a[i][j]*x[j];
+              rotation[i][j] += c[k][j]*g[i][k];
           }
       }
   }
 }
 
-inline void meshRotation (TriangularSurfaceMesh<T> * mesh, hemo::Array<T,3> rotationAngles) {
-    plb::Array<T,2> xRange, yRange, zRange;
-    mesh->computeBoundingBox (xRange, yRange, zRange);
-    plb::Array<T,3> meshCenter = plb::Array<T,3>(xRange[1] + xRange[0], yRange[1] + yRange[0], zRange[1] + zRange[0]) * (T)0.5;
-    mesh->translate((T)-1.0 * meshCenter);
-    rotateTriangularMeshXYZ(mesh, rotationAngles[0], rotationAngles[1], rotationAngles[2]);
-    mesh->translate(meshCenter);
+/// Vertices of a cell type centred on their bounding box, every cell of the
+/// type is placed by rotating and translating this template
+vector<hemo::Array<T,3>> centredTemplate(TriangularSurfaceMesh<T> & mesh) {
+  plb::Array<T,2> xRange, yRange, zRange;
+  mesh.computeBoundingBox (xRange, yRange, zRange);
+  const hemo::Array<T,3> center = {(xRange[0]+xRange[1])/(T)2.0, (yRange[0]+yRange[1])/(T)2.0, (zRange[0]+zRange[1])/(T)2.0};
+  vector<hemo::Array<T,3>> vertices(mesh.getNumVertices());
+  for (plint iVertex = 0; iVertex < mesh.getNumVertices(); ++iVertex) {
+    const plb::Array<T,3> & vertex = mesh.getVertex(iVertex);
+    vertices[iVertex] = {vertex[0]-center[0], vertex[1]-center[1], vertex[2]-center[2]};
+  }
+  return vertices;
 }
 
+/// Append the vertices of a cell that can be placed in the particle field to batch
 inline void positionCellInParticleField(HemoCellParticleField& particleField, BlockLattice3D<T,DESCRIPTOR>& fluid,
-                                            TriangularSurfaceMesh<T> * mesh, hemo::Array<T,3> startingPoint, plint cellId, pluint celltype) {
-    plint nVertices=mesh->getNumVertices();
-    Box3D fluidbb = fluid.getBoundingBox();
-    Dot3D rrelfluidloc; // used later;
-    int denyLayerSize; // used later;
-    HemoCellParticle::serializeValues_t to_add_particle; // used_later
-
-    for (plint iVertex=0; iVertex < nVertices; ++iVertex) {
-        hemo::Array<T,3> vertex = startingPoint + mesh->getVertex(iVertex);
+                                        const WallDistanceField & walls, const vector<hemo::Array<T,3>> & cellTemplate,
+                                        const T rotation[3][3], hemo::Array<T,3> startingPoint, plint cellId, pluint celltype,
+                                        plint denyLayerSize, vector<HemoCellParticle::serializeValues_t> & batch) {
+    const Dot3D & location = fluid.getLocation();
+
+    for (plint iVertex = 0; iVertex < (plint)cellTemplate.size(); ++iVertex) {
+        const hemo::Array<T,3> & local = cellTemplate[iVertex];
+        hemo::Array<T,3> vertex = startingPoint;
+        for (int i = 0; i < 3; i++) {
+            vertex[i] += rotation[i][0]*local[0] + rotation[i][1]*local[1] + rotation[i][2]*local[2];
+        }
         
         //If we cannot place it in the particle field continue
         if (!particleField.isContainedABS(vertex,particleField.getBoundingBox())) { continue; }
         
-        //Custom contains function for generic blocklattice3D structure
-        Dot3D absfluidloc(int(vertex[0]+0.5),int(vertex[1]+0.5),int(vertex[2]+0.5));
-        Dot3D relfluidloc = absfluidloc - fluid.getLocation();
-        
-        
-        if (!(relfluidloc.x < fluidbb.x0 || relfluidloc.x > fluidbb.x1 ||
-            relfluidloc.y < fluidbb.y0 || relfluidloc.y > fluidbb.y1 ||
-            relfluidloc.z < fluidbb.z0 || relfluidloc.z > fluidbb.z1)) {
-              // Test when particle is inside if in a boundary -> dont add this particle
-            if (fluid.get(relfluidloc.x,relfluidloc.y,relfluidloc.z).getDynamics().isBoundary()) {
-        	goto no_add;
-            }
-        } 
-            
-      //bool neighboringBoundariesAnywhere = false;  
-      // Deny particles that are in the outer most layer, aka. the "shear layer"    
-      denyLayerSize = ((*particleField.cellFields)[celltype]->minimumDistanceFromSolid*1e-6)/param::dx;
-      for (int px = -denyLayerSize; px <= denyLayerSize; ++px) {  
-        for (int py = -denyLayerSize; py <= denyLayerSize; ++py) { 
-          for (int pz = -denyLayerSize; pz <= denyLayerSize; ++pz) {
-            rrelfluidloc = {relfluidloc.x+px,relfluidloc.y+py,relfluidloc.z+pz};
-            if (!(rrelfluidloc.x < fluidbb.x0 || rrelfluidloc.x > fluidbb.x1 ||
-                  rrelfluidloc.y < fluidbb.y0 || rrelfluidloc.y > fluidbb.y1 ||
-                  rrelfluidloc.z < fluidbb.z0 || rrelfluidloc.z > fluidbb.z1)) {
-              if (fluid.get(rrelfluidloc.x,rrelfluidloc.y,rrelfluidloc.z).getDynamics().isBoundary()) {
-        	goto no_add;
-              }
-            }
-          }  
-        }  
+        // Deny particles in or near a boundary, aka. the "shear layer"
+        Dot3D relfluidloc = Dot3D(int(vertex[0]+0.5),int(vertex[1]+0.5),int(vertex[2]+0.5)) - location;
+        if (walls.nearWall(relfluidloc, denyLayerSize)) { continue; }
+
+        batch.push_back(HemoCellParticle(vertex,cellId,iVertex,celltype).sv);
+    }
+}
+
+}
+
+namespace {
+
+/// One cell of a position file, positions in µm, rotations in radians
+struct CellPlacement {
+  double position[3];
+  double angles[3];
+  long long cellId;
+  long long cellType;
+};
+
+/// Binary position files start with this tag, followed by the number of cells
+/// (uint64) and six doubles (X Y Z in µm, rotation X Y Z in degrees) per cell
+const char binaryPositionsTag[8] = {'H','C','P','O','S','B','I','N'};
+
+/// The cells that may end up on the blocks of this process, sorted on X
+vector<CellPlacement> localPlacements;
+
+/// Read the position file of a cell type as raw numbers, returns false when missing
+bool readPositionFile(const std::string & fileName, long long & nCells, vector<double> & values) {
+  ifstream fIn(fileName, ios::in | ios::binary);
+  if (!fIn.is_open()) { return false; }
+  string contents((istreambuf_iterator<char>(fIn)), istreambuf_iterator<char>());
+
+  if (contents.size() >= sizeof(binaryPositionsTag) + sizeof(uint64_t) &&
+      !memcmp(contents.data(), binaryPositionsTag, sizeof(binaryPositionsTag))) {
+    uint64_t n;
+    memcpy(&n, contents.data() + sizeof(binaryPositionsTag), sizeof(uint64_t));
+    const size_t available = (contents.size() - sizeof(binaryPositionsTag) - sizeof(uint64_t))/(6*sizeof(double));
+    if (n > available) {
+      cout << "*** WARNING! particle positions input file " << fileName << " is truncated, reading " << available << " of " << n << " cells" << endl;
+      n = available;
+    }
+    nCells = n;
+    values.resize(6*n);
+    memcpy(values.data(), contents.data() + sizeof(binaryPositionsTag) + sizeof(uint64_t), 6*n*sizeof(double));
+    return true;
+  }
+
+  // Text: the number of cells, followed by "X Y Z rotX rotY rotZ" per cell
+  const char * current = contents.c_str();
+  char * end;
+  nCells = strtoll(current, &end, 10);
+  current = end;
+  values.resize(6*max(nCells,0LL));
+  for (double & value : values) {
+    value = strtod(current, &end);
+    current = end;
+  }
+  return true;
+}
+
+/// Absolute bulk of every block of the lattice together with the rank it is on
+struct BlockTarget {
+  Box3D box;
+  int rank;
+};
+
+/**
+ * Read every position file once on the first process of comm and send each
+ * process only the cells whose center falls within one of its blocks
+ * (extended by the particle envelope). Cells are routed through a uniform
+ * grid of bins that list the blocks overlapping them, so a cell is only
+ * tested against a handful of blocks. Returns the total number of cells in
+ * the files on the first process.
+ */
+long long distributeCellPlacements(MPI_Comm comm, HemoCellFields & cellFields, T posRatio, Config & cfg) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  MPI_Datatype placementType;
+  MPI_Type_contiguous(sizeof(CellPlacement), MPI_BYTE, &placementType);
+  MPI_Type_commit(&placementType);
+
+  long long totalCells = 0;
+  vector<CellPlacement> sendBuffer;
+  vector<int> sendCounts, sendDispls;
+
+  if (!rank) {
+    const int envelope = cfg["domain"]["particleEnvelope"].read<int>();
+    hemo::Array<T,3> offset = {0.,0.,0.};
+    if (cellFields.hemocell.preInlet && cellFields.hemocell.preInlet->initialized) {
+      //Translate system to preInlet Location (set 0,0,0 point)
+      offset = {cellFields.hemocell.preInlet->location.x0/posRatio,
+                cellFields.hemocell.preInlet->location.y0/posRatio,
+                cellFields.hemocell.preInlet->location.z0/posRatio};
+    }
+
+    // Blocks of the lattice with the rank (within comm) they are on
+    MPI_Group worldGroup, commGroup;
+    MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+    MPI_Comm_group(comm, &commGroup);
+    const ThreadAttribution & attribution = cellFields.lattice->getMultiBlockManagement().getThreadAttribution();
+    vector<BlockTarget> targets;
+    for (const auto & bulk : cellFields.lattice->getSparseBlockStructure().getBulks()) {
+      int worldRank = attribution.getMpiProcess(bulk.first), commRank;
+      MPI_Group_translate_ranks(worldGroup, 1, &worldRank, commGroup, &commRank);
+      if (commRank == MPI_UNDEFINED) { continue; }
+      targets.push_back({bulk.second.enlarge(envelope), commRank});
+    }
+    MPI_Group_free(&worldGroup);
+    MPI_Group_free(&commGroup);
+
+    // Bins at least as large as the largest block, so a block overlaps at most two per direction
+    Box3D extent = targets.empty() ? Box3D(0,0,0,0,0,0) : targets[0].box;
+    plint binSize[3] = {1,1,1};
+    for (const BlockTarget & target : targets) {
+      extent = bound(extent, target.box);
+      binSize[0] = max(binSize[0], target.box.getNx());
+      binSize[1] = max(binSize[1], target.box.getNy());
+      binSize[2] = max(binSize[2], target.box.getNz());
+    }
+    const plint nBins[3] = {extent.getNx()/binSize[0]+1, extent.getNy()/binSize[1]+1, extent.getNz()/binSize[2]+1};
+    vector<vector<unsigned int>> bins(nBins[0]*nBins[1]*nBins[2]);
+    for (unsigned int t = 0 ; t < targets.size() ; t++) {
+      const Box3D & box = targets[t].box;
+      for (plint bx = (box.x0-extent.x0)/binSize[0] ; bx <= (box.x1-extent.x0)/binSize[0] ; bx++) {
+        for (plint by = (box.y0-extent.y0)/binSize[1] ; by <= (box.y1-extent.y0)/binSize[1] ; by++) {
+          for (plint bz = (box.z0-extent.z0)/binSize[2] ; bz <= (box.z1-extent.z0)/binSize[2] ; bz++) {
+            bins[(bx*nBins[1]+by)*nBins[2]+bz].push_back(t);
+          }
+        }
       }
-      
-      to_add_particle = HemoCellParticle(vertex,cellId,iVertex,celltype).sv;
-      particleField.addParticle(to_add_particle);
-no_add:;
     }
+
+    // Read every file once and route its cells
+    vector<CellPlacement> placements;
+    vector<int> destinations; // Flattened (placement, rank) pairs
+    vector<long long> lastPlacement(size,-1); // Avoid sending a cell twice to a rank
+    vector<double> values;
+    long long cellId = 0;
+    for (pluint ctype = 0 ; ctype < cellFields.size() ; ctype++) {
+      long long nCells = 0;
+      if (!readPositionFile(cellFields[ctype]->name + ".pos", nCells, values)) {
+        cout << "*** WARNING! particle positions input file " << cellFields[ctype]->name << ".pos does not exist!" << endl;
+      }
+      hlog << "(readPositionsBloodCells) Particle count in file (" << cellFields[ctype]->name << "): " << nCells << "." << endl;
+
+      for (long long i = 0 ; i < nCells ; i++, cellId++) {
+        CellPlacement placement;
+        for (int d = 0 ; d < 3 ; d++) {
+          placement.position[d] = values[6*i+d] + offset[d];
+          placement.angles[d] = -values[6*i+3+d]*PI/180.0; // Deg to Rad, right- to left-handed coordinate system
+        }
+        placement.cellId = cellId;
+        placement.cellType = ctype;
+
+        const hemo::Array<T,3> center = {placement.position[0]*posRatio, placement.position[1]*posRatio, placement.position[2]*posRatio};
+        plint bin[3];
+        bool outside = false;
+        for (int d = 0 ; d < 3 ; d++) {
+          const T start = d == 0 ? extent.x0 : (d == 1 ? extent.y0 : extent.z0);
+          bin[d] = floor((center[d]-start)/binSize[d]);
+          outside |= bin[d] < 0 || bin[d] >= nBins[d];
+        }
+        if (outside) { continue; }
+
+        bool routed = false;
+        for (const unsigned int t : bins[(bin[0]*nBins[1]+bin[1])*nBins[2]+bin[2]]) {
+          const Box3D & box = targets[t].box;
+          if (center[0] < box.x0 || center[0] > box.x1 ||
+              center[1] < box.y0 || center[1] > box.y1 ||
+              center[2] < box.z0 || center[2] > box.z1 ||
+              lastPlacement[targets[t].rank] == (long long)placements.size()) {
+            continue;
+          }
+          lastPlacement[targets[t].rank] = placements.size();
+          destinations.push_back(placements.size());
+          destinations.push_back(targets[t].rank);
+          routed = true;
+        }
+        if (routed) {
+          placements.push_back(placement);
+        }
+      }
+    }
+    totalCells = cellId;
+
+    // Group the routed cells per rank
+    sendCounts.assign(size,0);
+    sendDispls.assign(size,0);
+    for (unsigned int i = 1 ; i < destinations.size() ; i += 2) {
+      sendCounts[destinations[i]]++;
+    }
+    for (int r = 1 ; r < size ; r++) {
+      sendDispls[r] = sendDispls[r-1] + sendCounts[r-1];
+    }
+    sendBuffer.resize(destinations.size()/2);
+    vector<int> fill = sendDispls;
+    for (unsigned int i = 0 ; i < destinations.size() ; i += 2) {
+      sendBuffer[fill[destinations[i+1]]++] = placements[destinations[i]];
+    }
+  }
+
+  int receiveCount;
+  MPI_Scatter(sendCounts.data(), 1, MPI_INT, &receiveCount, 1, MPI_INT, 0, comm);
+  localPlacements.resize(receiveCount);
+  MPI_Scatterv(sendBuffer.data(), sendCounts.data(), sendDispls.data(), placementType,
+               localPlacements.data(), receiveCount, placementType, 0, comm);
+  MPI_Type_free(&placementType);
+
+  std::sort(localPlacements.begin(), localPlacements.end(), [](const CellPlacement & a, const CellPlacement & b) {
+    return a.position[0] < b.position[0];
+  });
+  return totalCells;
+}
+
 }
 
 int getTotalNumberOfCells(HemoCellFields & cellFields){
-  int nCells, totalCells = 0;
+  int totalCells = 0;
   for (pluint j = 0; j < cellFields.size(); j++) {
-    fstream fIn;
-    fIn.open(cellFields[j]->name + ".pos", fstream::in);
-    fIn >> nCells;
-    totalCells += nCells;
-    fIn.close();
+    ifstream fIn(cellFields[j]->name + ".pos", ios::in | ios::binary);
+    char tag[sizeof(binaryPositionsTag)] = {};
+    fIn.read(tag, sizeof(tag));
+    if (fIn && !memcmp(tag, binaryPositionsTag, sizeof(tag))) {
+      uint64_t nCells = 0;
+      fIn.read((char*)&nCells, sizeof(nCells));
+      totalCells += nCells;
+    } else {
+      fIn.clear();
+      fIn.seekg(0);
+      int nCells = 0;
+      fIn >> nCells;
+      totalCells += nCells;
+    }
   }
   return totalCells;
   
 }
 
-bool first_time =true;
 void getReadPositionsBloodCellsVector(Box3D realDomain,
-                                            std::vector<TriangularSurfaceMesh<T>* > & meshes,
                                             std::vector<plint> & Np,
                                             std::vector<std::vector<hemo::Array<T,3> > > & positions,
                                             std::vector<std::vector<plint> > & cellIds,
@@ -192,96 +361,41 @@ void getReadPositionsBloodCellsVector(Box3D realDomain,
                                             T dx, Config & cfg, HemoCellFields & cellFields,
                                             HemoCellParticleField & particleField)
 {
+    const int envelope = cfg["domain"]["particleEnvelope"].read<int>();
 
-    
-
-
-    vector<vector3> packPositions[cellFields.size()];
-    vector<vector3> packAngles[cellFields.size()];
-    vector<plint> cellIdss[cellFields.size()];
-
-    Np.resize(cellFields.size());
-
-    int cellid = 0;
-    // TODO: proper try-catch
-    for(pluint j = 0; j < Np.size(); j++) {
-
-        // Reading data from file
-        fstream fIn;
-        fIn.open(cellFields[j]->name + ".pos", fstream::in);
-
-        if(!fIn.is_open())
-        {
-            cout << "*** WARNING! particle positions input file " << cellFields[j]->name << ".pos does not exist!" << endl;
-        }
-
-        fIn >> Np[j];
-        if (first_time) {
-          hlog << "(readPositionsBloodCells) Particle count in file (" << cellFields[j]->name << "): " << Np[j] << "." << endl;
-        }
-        packPositions[j].resize(Np[j]); packAngles[j].resize(Np[j]);cellIdss[j].resize(Np[j]);
-        int less = 0;
-        for (plint i = 0; i < Np[j]; i++) {
-            fIn >> 
-              packPositions[j][i-less][0] >> packPositions[j][i-less][1] >> packPositions[j][i-less][2] >> 
-              packAngles[j][i-less][0] >> packAngles[j][i-less][1] >> packAngles[j][i-less][2];
-            packAngles[j][i-less] *= PI/180.0; // Deg to Rad
-            packAngles[j][i-less] *= -1.0;  // Right- to left-handed coordinate system
-            cellIdss[j][i-less] = cellid;
-
-            if (cellFields.hemocell.preInlet && cellFields.hemocell.preInlet->initialized) {
-              //Translate system to preInlet Location (set 0,0,0 point)
-              packPositions[j][i-less][0] += cellFields.hemocell.preInlet->location.x0/dx;
-              packPositions[j][i-less][1] += cellFields.hemocell.preInlet->location.y0/dx;
-              packPositions[j][i-less][2] += cellFields.hemocell.preInlet->location.z0/dx;
-            }
-            
-            //Check if it actually fits (mostly) in this atomic block
-            if (packPositions[j][i-less][0]*dx < realDomain.x0 - cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][0]*dx > realDomain.x1 + cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][1]*dx < realDomain.y0 - cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][1]*dx > realDomain.y1 + cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][2]*dx < realDomain.z0 - cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][2]*dx > realDomain.z1 + cfg["domain"]["particleEnvelope"].read<int>()) {
-              less ++;
-            }
-            cellid++;
-
-        }
-        //Destroy unwanted particles and adjust list size;
-        Np[j] -= less;
-        packPositions[j].resize(Np[j]);
-        packAngles[j].resize(Np[j]);
-        cellIdss[j].resize(Np[j]);
-
-        fIn.close();
-    }
-    
-    cellFields.number_of_cells = getTotalNumberOfCells(cellFields);
-    
-    // Copy results of packing to appropriate hemo::Arrays for ficsion
+    Np.assign(cellFields.size(), 0);
     positions.clear();	positions.resize(Np.size());
     randomAngles.clear(); randomAngles.resize(Np.size());
     cellIds.clear();	cellIds.resize(Np.size());
 
-
-    for (pluint i = 0; i < Np.size(); ++i)
-    {
-        positions[i].resize(Np[i]);
-        cellIds[i].resize(Np[i]);
-        randomAngles[i].resize(Np[i]);
-
-        for (plint j = 0; j < Np[i]; ++j)
-        {
-            // Store mesh positions and rotations
-            //randomAngles[i][j] = hemo::Array<T, 3>(1.0,0.0,0.0);
-            randomAngles[i][j] = hemo::Array<T, 3>({packAngles[i][j][0], packAngles[i][j][1], packAngles[i][j][2]});
-            positions[i][j] =hemo::Array<T,3>({packPositions[i][j][0], packPositions[i][j][1], packPositions[i][j][2]});
-            cellIds[i][j] = cellIdss[i][j];
-
-        }
+    // The placements are sorted on X, only look at the slice that can overlap
+    // (with a node of slack for the conversion to lattice units)
+    auto first = std::lower_bound(localPlacements.begin(), localPlacements.end(), (realDomain.x0 - envelope - 1)/dx,
+      [](const CellPlacement & placement, T x) { return placement.position[0] < x; });
+    vector<const CellPlacement *> selected;
+    for (auto it = first ; it != localPlacements.end() && it->position[0] <= (realDomain.x1 + envelope + 1)/dx ; ++it) {
+      //Check if it actually fits (mostly) in this atomic block
+      if (it->position[0]*dx < realDomain.x0 - envelope ||
+          it->position[0]*dx > realDomain.x1 + envelope ||
+          it->position[1]*dx < realDomain.y0 - envelope ||
+          it->position[1]*dx > realDomain.y1 + envelope ||
+          it->position[2]*dx < realDomain.z0 - envelope ||
+          it->position[2]*dx > realDomain.z1 + envelope) {
+        continue;
+      }
+      selected.push_back(&*it);
+    }
+    std::sort(selected.begin(), selected.end(), [](const CellPlacement * a, const CellPlacement * b) {
+      return a->cellId < b->cellId;
+    });
+
+    for (const CellPlacement * placement : selected) {
+      const pluint ctype = placement->cellType;
+      Np[ctype]++;
+      positions[ctype].push_back({placement->position[0], placement->position[1], placement->position[2]});
+      randomAngles[ctype].push_back({placement->angles[0], placement->angles[1], placement->angles[2]});
+      cellIds[ctype].push_back(placement->cellId);
     }
-    first_time = false;
 }
 
 
@@ -291,39 +405,26 @@ void ReadPositionsBloodCellField3D::processGenericBlocks (
         Box3D domain, std::vector<AtomicBlock3D*> blocks )
 {  
     int numberOfCellFields = blocks.size() -1;
-    //T ratio;
     BlockLattice3D<T,DESCRIPTOR>& fluid =
             *dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
     std::vector<HemoCellParticleField* > particleFields(numberOfCellFields);
-    std::vector<T> volumes(numberOfCellFields);
-    std::vector<TriangularSurfaceMesh<T>* > meshes(numberOfCellFields);
-    std::vector<ElementsOfTriangularSurfaceMesh<T> > emptyEoTSM(numberOfCellFields);
     std::vector<plint> Np(numberOfCellFields);
-
-    T totalVolumeFraction=0;
-
-    //T Vdomain = domain.getNx() * domain.getNy() * domain.getNz();
+    std::vector<plint> denyLayerSizes(numberOfCellFields);
+    plint maxDenyLayerSize = 0;
 
     Dot3D fLocation(fluid.getLocation());
     Box3D realDomain(
             domain.x0 + fLocation.x, domain.x1 + fLocation.x,
             domain.y0 + fLocation.y, domain.y1 + fLocation.y,
             domain.z0 + fLocation.z, domain.z1 + fLocation.z );
-    plb::Array<T,2> xRange, yRange, zRange;
 
     for (pluint iCF = 0; iCF < cellFields.size(); ++iCF) {
-
-        TriangularSurfaceMesh<T> * mesh = copyTriangularSurfaceMesh(cellFields[iCF]->getMesh(), emptyEoTSM[iCF]);
-        mesh->computeBoundingBox (xRange, yRange, zRange);
-        mesh->translate(plb::Array<T,3>(-(xRange[0]+xRange[1])/2.0, -(yRange[0]+yRange[1])/2.0, -(zRange[0]+zRange[1])/2.0));
-        meshes[iCF] = mesh;
-        volumes[iCF] = MeshMetrics<T>(*mesh).getVolume();
-
-        totalVolumeFraction += volumes[iCF];
         particleFields[iCF] = ( dynamic_cast<HemoCellParticleField*>(blocks[iCF+1]) );
         particleFields[iCF]->removeParticles(particleFields[iCF]->getBoundingBox());
+        // Vertices within this many nodes of a boundary are not placed
+        denyLayerSizes[iCF] = (cellFields[iCF]->minimumDistanceFromSolid*1e-6)/param::dx;
+        maxDenyLayerSize = std::max(maxDenyLayerSize, denyLayerSizes[iCF]);
     }
-   
 
     std::vector<std::vector<hemo::Array<T,3> > > positions;
     std::vector<std::vector<plint> > cellIds;
@@ -331,30 +432,34 @@ void ReadPositionsBloodCellField3D::processGenericBlocks (
 
     // Note: this method uses the center of the particles for location
     T posRatio = 1e-6/dx;
-    getReadPositionsBloodCellsVector(realDomain, meshes, Np, positions, cellIds, randomAngles, posRatio, cfg, cellFields,*particleFields[0]);
+    getReadPositionsBloodCellsVector(realDomain, Np, positions, cellIds, randomAngles, posRatio, cfg, cellFields,*particleFields[0]);
+
+    bool anyCells = false;
+    for (const plint n : Np) { anyCells |= n > 0; }
+    if (!anyCells) { return; }
+    const WallDistanceField & walls = particleFields[0]->getWallDistance(maxDenyLayerSize);
 
     // Change positions to match dx (it is in um originally)
     T wallWidth = 0; // BB wall in [lu]. Offset to count in width of the wall in particle position (useful for pipeflow, not necessarily useful elswhere)
     
+    std::vector<HemoCellParticle::serializeValues_t> batch;
     for (pluint iCF = 0; iCF < positions.size(); ++iCF)
     {
+        if (positions[iCF].empty()) { continue; }
+        const vector<hemo::Array<T,3>> cellTemplate = centredTemplate(cellFields[iCF]->getMesh());
+        batch.clear();
+        batch.reserve(positions[iCF].size()*cellTemplate.size());
         for (pluint c = 0; c < positions[iCF].size(); ++c)
         {
-            ElementsOfTriangularSurfaceMesh<T> emptyEoTSMCopy;
-    	    TriangularSurfaceMesh<T> * meshCopy = copyTriangularSurfaceMesh(*meshes[iCF], emptyEoTSMCopy);
-    	    
-            meshRotation (meshCopy, randomAngles[iCF][c]);
-            
-            positionCellInParticleField(*(particleFields[iCF]), fluid,
-                                         meshCopy, positions[iCF][c]*posRatio+wallWidth, cellIds[iCF][c], iCF); 
-			delete meshCopy;
+            T rotation[3][3];
+            rotationMatrixXYZ(randomAngles[iCF][c], rotation);
+            positionCellInParticleField(*(particleFields[iCF]), fluid, walls, cellTemplate, rotation,
+                                        positions[iCF][c]*posRatio+wallWidth, cellIds[iCF][c], iCF,
+                                        denyLayerSizes[iCF], batch);
         }
+        particleFields[iCF]->addParticles(batch);
 
         particleFields[iCF]->deleteIncompleteCells(iCF,false);
-        std::vector<HemoCellParticle*> particles;
-        particleFields[iCF]->findParticles(particleFields[iCF]->getBoundingBox(), particles, iCF);
-        
-        delete meshes[iCF];
     }
     //cout << "Atomic Block ID: " << particleFields[0]->atomicBlockId;
     //cout    << " Total complete cells (with periodicity): " << particleFields[0]->get_lpc().size() << std::endl;
@@ -399,13 +504,23 @@ void readPositionsBloodCellField3D(HemoCellFields & cellFields, T dx, Config & c
     }
     hlog << "(readPositionsBloodCells) Reading particle positions..." << std::endl;
     
-    if (cellFields.hemocell.preInlet && cellFields.hemocell.preInlet->initialized && !cellFields.hemocell.partOfpreInlet) { } else {
-    applyProcessingFunctional(
-            new ReadPositionsBloodCellField3D(cellFields, dx, cfg),
-            cellFields.lattice->getBoundingBox(), fluidAndParticleFieldsArg);
-    hlogfile << "Mpi Process: " << global::mpi().getRank()  << " Completed loading particles" << std::endl;
+    // The processes of the lattice that is loaded read the files together
+    const bool loading = !(cellFields.hemocell.preInlet && cellFields.hemocell.preInlet->initialized && !cellFields.hemocell.partOfpreInlet);
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, loading ? 0 : MPI_UNDEFINED, global::mpi().getRank(), &comm);
+
+    long long totalCells = 0;
+    if (loading) {
+        totalCells = distributeCellPlacements(comm, cellFields, 1e-6/dx, cfg);
+        MPI_Comm_free(&comm);
+        applyProcessingFunctional(
+                new ReadPositionsBloodCellField3D(cellFields, dx, cfg),
+                cellFields.lattice->getBoundingBox(), fluidAndParticleFieldsArg);
+        vector<CellPlacement>().swap(localPlacements);
+        hlogfile << "Mpi Process: " << global::mpi().getRank()  << " Completed loading particles" << std::endl;
     }
-    cellFields.number_of_cells = getTotalNumberOfCells(cellFields);
+    MPI_Allreduce(MPI_IN_PLACE, &totalCells, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    cellFields.number_of_cells = totalCells;
 }
 
 }
@@ -32,16 +32,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "offLattice/triangularSurfaceMesh.hh"
 
 namespace hemo {
+/**
+ * Place the cells of every <name>.pos file in the particle fields.
+ *
+ * The first process reads each file once (text, or the binary layout written
+ * by packCells --binary) and sends every process only the cells that fall
+ * within its blocks, which then position them block by block.
+ */
 void readPositionsBloodCellField3D(HemoCellFields & cellFields, T dx, Config & cfg);
 int getTotalNumberOfCells(HemoCellFields & cellFields);
 
+/// The cells sent to this process that fall within realDomain (extended by
+/// the particle envelope), only valid during readPositionsBloodCellField3D
 void getReadPositionsBloodCellsVector(plb::Box3D realDomain,
-                                           std::vector<plb::TriangularSurfaceMesh<T>* > & meshes,
                                            std::vector<plint> & Np,
                                            std::vector<std::vector<hemo::Array<T,3> > > & positions,
                                            std::vector<std::vector<plint> > & cellIds,
                                            std::vector<std::vector<hemo::Array<T,3> > > & randomAngles,
-                                           Config & cfg, HemoCellFields & cellFields,
+                                           T dx, Config & cfg, HemoCellFields & cellFields,
                                            HemoCellParticleField & particleField);
 
 class ReadPositionsBloodCellField3D : public plb::BoxProcessingFunctional3D
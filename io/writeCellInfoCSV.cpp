@@ -31,7 +31,8 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
   global.statistics.getCurrent()["writeCellCSVInfo"].start();
 
   map<int,CellInformation> info_per_cell;
-  CellInformationFunctionals::calculateCellInformation(&hemocell,info_per_cell);
+  CellInformationFunctionals::calculateCellInformation(&hemocell,info_per_cell,
+      CELLINFO_VOLUME | CELLINFO_AREA | CELLINFO_VELOCITY | CELLINFO_SHAPE);
   for (auto it = info_per_cell.cbegin(); it != info_per_cell.cend() ;) 
   {
     if (!it->second.centerLocal) {
@@ -41,7 +42,7 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
     }
   }
   
-  HemoCellGatheringFunctional<CellInformation>::gather(info_per_cell);
+  HemoCellGatheringFunctional<CellInformation>::gatherToRoot(info_per_cell);
  
   if (!global::mpi().getRank()) {
     vector<std::string> fileNames = vector<std::string>(hemocell.cellfields->size());
@@ -49,7 +50,7 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
     for (unsigned int i = 0 ; i < fileNames.size(); i++ ) {
       fileNames[i] = global::directories().getOutputDir() + "/csv/" +  (*hemocell.cellfields)[i]->name + "." + zeroPadNumber(hemocell.iter) + ".csv";
       csvFiles[i].open(fileNames[i], ofstream::trunc);
-      csvFiles[i] << "X,Y,Z,area,volume,atomic_block,cellId,baseCellId,velocity_x,velocity_y,velocity_z" << endl;
+      csvFiles[i] << "X,Y,Z,area,volume,atomic_block,cellId,baseCellId,velocity_x,velocity_y,velocity_z,stretch,axis_major,axis_middle,axis_minor,deformation_index,major_axis_x,major_axis_y,major_axis_z" << endl;
     }
 
     for (auto & pair : info_per_cell) {
@@ -61,12 +62,16 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
         cinfo.area *= param::dx*param::dx;
         cinfo.velocity *= param::dx/param::dt;
         cinfo.volume *= param::dx*param::dx*param::dx;
+        cinfo.stretch *= param::dx;
+        cinfo.principalAxes *= param::dx;
       }
 
       if (cinfo.centerLocal) {
         csvFiles[cinfo.cellType] << cinfo.position[0] << "," << cinfo.position[1] << "," << cinfo.position[2] << ",";
         csvFiles[cinfo.cellType] << cinfo.area << "," << cinfo.volume << "," << cinfo.blockId << "," << cid  << "," << cinfo.base_cell_id << ",";
-        csvFiles[cinfo.cellType] << cinfo.velocity[0] << "," << cinfo.velocity[1] << "," << cinfo.velocity[2] << endl;
+        csvFiles[cinfo.cellType] << cinfo.velocity[0] << "," << cinfo.velocity[1] << "," << cinfo.velocity[2] << ",";
+        csvFiles[cinfo.cellType] << cinfo.stretch << "," << cinfo.principalAxes[0] << "," << cinfo.principalAxes[1] << "," << cinfo.principalAxes[2] << ",";
+        csvFiles[cinfo.cellType] << cinfo.deformationIndex << "," << cinfo.majorAxis[0] << "," << cinfo.majorAxis[1] << "," << cinfo.majorAxis[2] << endl;
       }
     }
 
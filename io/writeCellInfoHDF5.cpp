@@ -0,0 +1,227 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "writeCellInfoHDF5.h"
+#include "cellInfo.h"
+#include "hemocell.h"
+
+#include <hdf5.h>
+#include <hdf5_hl.h>
+#include <mpi.h>
+#include <algorithm>
+
+namespace hemo {
+
+namespace {
+
+/// One row of the cell information table, exchanged as raw bytes
+struct CellInfoRecord {
+  double position[3];
+  double velocity[3];
+  double area;
+  double volume;
+  double stretch;
+  double principalAxes[3];
+  double majorAxis[3];
+  double deformationIndex;
+  long long cellId;
+  long long baseCellId;
+  long long blockId;
+  int cellType;
+};
+
+/// Communicator connecting the ranks served by one writer, the writer is rank 0 within it
+MPI_Comm writerComm = MPI_COMM_NULL;
+int writerCommWriters = 0;
+
+MPI_Comm getWriterComm(int writers, int & writerIndex) {
+  const int rank = global::mpi().getRank();
+  const int size = global::mpi().getSize();
+  writerIndex = (int)(((long long)rank * writers) / size);
+  if (writers != writerCommWriters) {
+    if (writerComm != MPI_COMM_NULL) {
+      MPI_Comm_free(&writerComm);
+    }
+    MPI_Comm_split(MPI_COMM_WORLD, writerIndex, rank, &writerComm);
+    writerCommWriters = writers;
+  }
+  return writerComm;
+}
+
+void writeColumn(hid_t group, const char * name, hid_t type, const void * data, hsize_t n) {
+  hid_t sid = H5Screate_simple(1,&n,NULL);
+  hid_t plist_id = H5Pcreate (H5P_DATASET_CREATE);
+  if (n > 0) {
+    hsize_t chunk = 10000 < n ? 10000 : n;
+    H5Pset_chunk(plist_id, 1, &chunk);
+    H5Pset_deflate(plist_id, 7);
+  }
+  hid_t did = H5Dcreate2(group,name,type,sid,H5P_DEFAULT,plist_id,H5P_DEFAULT);
+  if (n > 0) {
+    H5Dwrite(did,type,H5S_ALL,H5S_ALL,H5P_DEFAULT,data);
+  }
+  H5Dclose(did);
+  H5Pclose(plist_id);
+  H5Sclose(sid);
+}
+
+}
+
+void writeCellInfo_HDF5(HemoCell & hemocell) {
+  global.statistics.getCurrent()["writeCellInfoHDF5"].start();
+
+  // Partial results: every cell is summarised on the block owning its center
+  map<int,CellInformation> info_per_cell;
+  CellInformationFunctionals::calculateCellInformation(&hemocell,info_per_cell,
+      CELLINFO_VOLUME | CELLINFO_AREA | CELLINFO_VELOCITY | CELLINFO_SHAPE);
+
+  const T dxScale = hemocell.outputInSiUnits ? param::dx : 1.;
+  const T dtScale = hemocell.outputInSiUnits ? param::dt : 1.;
+
+  vector<CellInfoRecord> records;
+  records.reserve(info_per_cell.size());
+  for (const auto & pair : info_per_cell) {
+    const CellInformation & cinfo = pair.second;
+    if (!cinfo.centerLocal) { continue; }
+    CellInfoRecord record;
+    for (int d = 0 ; d < 3 ; d++) {
+      record.position[d] = cinfo.position[d]*dxScale;
+      record.velocity[d] = cinfo.velocity[d]*dxScale/dtScale;
+    }
+    record.area = cinfo.area*dxScale*dxScale;
+    record.volume = cinfo.volume*dxScale*dxScale*dxScale;
+    record.stretch = cinfo.stretch*dxScale;
+    for (int d = 0 ; d < 3 ; d++) {
+      record.principalAxes[d] = cinfo.principalAxes[d]*dxScale;
+      record.majorAxis[d] = cinfo.majorAxis[d];
+    }
+    record.deformationIndex = cinfo.deformationIndex;
+    record.cellId = pair.first;
+    record.baseCellId = cinfo.base_cell_id;
+    record.blockId = cinfo.blockId;
+    record.cellType = cinfo.cellType;
+    records.push_back(record);
+  }
+  info_per_cell.clear();
+
+  // Collect the records on the writers, one writer per contiguous range of ranks
+  const int writers = std::max(1,std::min(global.cellInfoWriters,global::mpi().getSize()));
+  int writerIndex;
+  MPI_Comm comm = getWriterComm(writers, writerIndex);
+  int commRank, commSize;
+  MPI_Comm_rank(comm,&commRank);
+  MPI_Comm_size(comm,&commSize);
+
+  int localBytes = records.size()*sizeof(CellInfoRecord);
+  vector<int> counts(commRank ? 0 : commSize), displs(commRank ? 0 : commSize);
+  MPI_Gather(&localBytes,1,MPI_INT,counts.data(),1,MPI_INT,0,comm);
+
+  vector<CellInfoRecord> collected;
+  if (!commRank) {
+    int total = 0;
+    for (int i = 0 ; i < commSize ; i++) {
+      displs[i] = total;
+      total += counts[i];
+    }
+    collected.resize(total/sizeof(CellInfoRecord));
+  }
+  MPI_Gatherv(records.data(),localBytes,MPI_BYTE,collected.data(),counts.data(),displs.data(),MPI_BYTE,0,comm);
+  records.clear();
+
+  if (!commRank) {
+    std::string folder = global::directories().getOutputDir() + "/hdf5/" + zeroPadNumber(hemocell.iter);
+    mkpath(folder.c_str(), 0777);
+    std::string fileName = folder + "/CellInfo." + zeroPadNumber(hemocell.iter) + ".w." + to_string(writerIndex) + ".h5";
+    hid_t file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    double dx = param::dx, dt = param::dt;
+    long int iterHDF5 = hemocell.iter;
+    H5LTset_attribute_double (file_id, "/", "dx", &dx, 1);
+    H5LTset_attribute_double (file_id, "/", "dt", &dt, 1);
+    H5LTset_attribute_long (file_id, "/", "iteration", &iterHDF5, 1);
+    H5LTset_attribute_int (file_id, "/", "writerId", &writerIndex, 1);
+    H5LTset_attribute_int (file_id, "/", "numberOfWriters", &writers, 1);
+    int siUnits = hemocell.outputInSiUnits;
+    H5LTset_attribute_int (file_id, "/", "siUnits", &siUnits, 1);
+
+    std::sort(collected.begin(), collected.end(), [](const CellInfoRecord & a, const CellInfoRecord & b) {
+      return a.cellType < b.cellType || (a.cellType == b.cellType && a.cellId < b.cellId);
+    });
+
+    // One group per cell type, also when empty, so readers always find every type
+    auto begin = collected.begin();
+    for (unsigned int ctype = 0 ; ctype < hemocell.cellfields->size() ; ctype++) {
+      auto end = begin;
+      while (end != collected.end() && end->cellType == (int)ctype) { end++; }
+      const hsize_t n = end - begin;
+
+      vector<double> real(n);
+      vector<long long> integer(n);
+      hid_t group = H5Gcreate2(file_id, (*hemocell.cellfields)[ctype]->name.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      long int nCells = n;
+      H5LTset_attribute_long (group, ".", "numberOfCells", &nCells, 1);
+
+      const char * positionNames[3] = {"X","Y","Z"};
+      const char * velocityNames[3] = {"velocity_x","velocity_y","velocity_z"};
+      for (int d = 0 ; d < 3 ; d++) {
+        for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].position[d]; }
+        writeColumn(group,positionNames[d],H5T_NATIVE_DOUBLE,real.data(),n);
+      }
+      for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].area; }
+      writeColumn(group,"area",H5T_NATIVE_DOUBLE,real.data(),n);
+      for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].volume; }
+      writeColumn(group,"volume",H5T_NATIVE_DOUBLE,real.data(),n);
+      for (hsize_t i = 0 ; i < n ; i++) { integer[i] = begin[i].blockId; }
+      writeColumn(group,"atomic_block",H5T_NATIVE_LLONG,integer.data(),n);
+      for (hsize_t i = 0 ; i < n ; i++) { integer[i] = begin[i].cellId; }
+      writeColumn(group,"cellId",H5T_NATIVE_LLONG,integer.data(),n);
+      for (hsize_t i = 0 ; i < n ; i++) { integer[i] = begin[i].baseCellId; }
+      writeColumn(group,"baseCellId",H5T_NATIVE_LLONG,integer.data(),n);
+      for (int d = 0 ; d < 3 ; d++) {
+        for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].velocity[d]; }
+        writeColumn(group,velocityNames[d],H5T_NATIVE_DOUBLE,real.data(),n);
+      }
+      for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].stretch; }
+      writeColumn(group,"stretch",H5T_NATIVE_DOUBLE,real.data(),n);
+      const char * axisNames[3] = {"axis_major","axis_middle","axis_minor"};
+      for (int d = 0 ; d < 3 ; d++) {
+        for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].principalAxes[d]; }
+        writeColumn(group,axisNames[d],H5T_NATIVE_DOUBLE,real.data(),n);
+      }
+      for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].deformationIndex; }
+      writeColumn(group,"deformation_index",H5T_NATIVE_DOUBLE,real.data(),n);
+      const char * majorAxisNames[3] = {"major_axis_x","major_axis_y","major_axis_z"};
+      for (int d = 0 ; d < 3 ; d++) {
+        for (hsize_t i = 0 ; i < n ; i++) { real[i] = begin[i].majorAxis[d]; }
+        writeColumn(group,majorAxisNames[d],H5T_NATIVE_DOUBLE,real.data(),n);
+      }
+
+      H5Gclose(group);
+      begin = end;
+    }
+    H5Fclose(file_id);
+  }
+  global.statistics.getCurrent().stop();
+}
+
+}
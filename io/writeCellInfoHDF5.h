@@ -0,0 +1,43 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WRITECELLINFOHDF5_H
+#define WRITECELLINFOHDF5_H
+
+#include "hemocell.h"
+
+namespace hemo {
+  /**
+   * Write the per-cell information (the columns of writeCellInfo_CSV) as a
+   * columnar HDF5 table.
+   *
+   * Every cell is summarised on the process that owns its center, the records
+   * are then collected by global.cellInfoWriters I/O processes (each serving a
+   * contiguous range of ranks), which each write
+   * hdf5/<iter>/CellInfo.<iter>.w.<writer>.h5 with one group per cell type and
+   * one dataset per column. No process ever holds the information of all cells.
+   * tools/cellinfo_to_csv converts these files to the CSV layout.
+   */
+  void writeCellInfo_HDF5(HemoCell &);
+}
+#endif /* WRITECELLINFOHDF5_H */
@@ -23,8 +23,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #ifndef HEMO_CELLMECHANICS
 #define HEMO_CELLMECHANICS
+#include "constant_defaults.h"
+#include "array.h"
+#include <map>
+#include <vector>
+
 namespace hemo {
   class CellMechanics;
+
+  /// Geometry of a cell as computed by its constitutive model, cached in
+  /// HemoCellParticleField::cellGeometry until the particles are advanced
+  struct CellGeometry {
+    bool valid = false;
+    T volume = 0.;
+    T area = 0.;
+    hemo::Array<T,3> centroid = {0.,0.,0.};
+    std::vector<T> triangleAreas;
+    std::vector<hemo::Array<T,3>> triangleNormals; ///< Outward unit normals
+    /// Sum of the outward normals of the adjacent triangles, weighted by
+    /// their area relative to area_mean_eq
+    std::vector<hemo::Array<T,3>> vertexNormals;
+  };
 }
 
 #include "hemoCellParticleField.h"
@@ -38,6 +57,8 @@ class CellMechanics {
   public:
   const CommonCellConstants cellConstants;
   Config & cfg;
+  /// Set during ParticleMechanics() to the geometry cache of the block
+  std::map<int,CellGeometry> * cellGeometry = 0;
   
   CellMechanics(HemoCellField & cellfield, Config & modelCfg_) : cellConstants(CommonCellConstants::CommonCellConstantsConstructor(cellfield, modelCfg_)), cfg(modelCfg_) {}
   virtual ~CellMechanics() {};
@@ -46,6 +67,35 @@ class CellMechanics {
   virtual void statistics() = 0;
   virtual void solidifyMechanics(const std::map<int,std::vector<int>>&,std::vector<HemoCellParticle>&,plb::BlockLattice3D<T,DESCRIPTOR> *,plb::BlockLattice3D<T,CEPAC_DESCRIPTOR> *, pluint ctype, HemoCellParticleField &) {};
   
+protected:
+  /// Cache entry for cell cid with empty triangle lists and zeroed vertex normals
+  CellGeometry & beginGeometry(int cid, std::size_t vertices) {
+    CellGeometry & geometry = cellGeometry ? (*cellGeometry)[cid] : scratchGeometry;
+    geometry.valid = false;
+    geometry.triangleAreas.clear();
+    geometry.triangleAreas.reserve(cellConstants.triangle_list.size());
+    geometry.triangleNormals.clear();
+    geometry.triangleNormals.reserve(cellConstants.triangle_list.size());
+    geometry.vertexNormals.assign(vertices, {0.,0.,0.});
+    return geometry;
+  }
+
+  /// Complete a cache entry once the triangle pass is done
+  void finishGeometry(CellGeometry & geometry, const std::vector<HemoCellParticle *> & cell, T volume, T area) {
+    geometry.volume = volume;
+    geometry.area = area;
+    geometry.centroid = {0.,0.,0.};
+    for (const HemoCellParticle * particle : cell) {
+      geometry.centroid += particle->sv.position;
+    }
+    geometry.centroid /= T(cell.size());
+    geometry.valid = true;
+  }
+
+private:
+  CellGeometry scratchGeometry; // Used when no cache is attached
+public:
+  
   
   T calculate_kLink(Config & cfg, plb::MeshMetrics<T> & meshmetric){
     T kLink = cfg["MaterialModel"]["kLink"].read<T>();
@@ -23,7 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "pltSimpleModel.h"
 #include "logfile.h"
-#include "octree.h"
+#include "scanlineVoxelizer.h"
 #include "mollerTrumbore.h"
 
 #include "palabos3D.h"
@@ -50,10 +50,12 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
 
     //Calculate Cell Values that need all particles (but do it efficiently,
     //tailored to this class)
-    T volume = 0.0;
+    T volume = 0.0, total_area = 0.0;
     int triangle_n = 0;
-    vector<T> triangle_areas;
-    vector<hemo::Array<T,3>> triangle_normals; 
+    CellGeometry & geometry = beginGeometry(cid, cell.size());
+    vector<T> & triangle_areas = geometry.triangleAreas;
+    vector<hemo::Array<T,3>> & triangle_normals = geometry.triangleNormals;
+    vector<hemo::Array<T,3>> & vertex_normals = geometry.vertexNormals;
 
     // Per-triangle calculations
     for (const hemo::Array<plint,3> & triangle : cellConstants.triangle_list) {
@@ -95,12 +97,14 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
 
       //Store values necessary later
       triangle_areas.push_back(area);
+      total_area += area;
       triangle_normals.push_back(t_normal);
 
       triangle_n++;
     }
 
     volume *= (1.0/6.0);
+    finishGeometry(geometry, cell, volume, total_area);
 
     //Volume
     const T volume_frac = (volume-cellConstants.volume_eq)/cellConstants.volume_eq;
@@ -115,6 +119,12 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
       *cell[triangle[1]]->force_volume += local_volume_force;
       *cell[triangle[2]]->force_volume += local_volume_force;
 
+      // Area weighted vertex normals, always pointing outward
+      const hemo::Array<T, 3> local_normal_dir = (triangle_normals[triangle_n])*(triangle_areas[triangle_n]/cellConstants.area_mean_eq);
+      vertex_normals[triangle[0]] += local_normal_dir;
+      vertex_normals[triangle[1]] += local_normal_dir;
+      vertex_normals[triangle[2]] += local_normal_dir;
+
       triangle_n++;
     }
 
@@ -209,6 +219,12 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
 
 #ifdef SOLIDIFY_MECHANICS
 void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc,std::vector<HemoCellParticle>& particles,plb::BlockLattice3D<T,DESCRIPTOR> * fluid,plb::BlockLattice3D<T,CEPAC_DESCRIPTOR> * CEPAC, pluint ctype, HemoCellParticleField & pf) {
+  const Dot3D & location = fluid->getLocation();
+  const Box3D absoluteDomain(location.x, location.x + fluid->getNx()-1,
+                             location.y, location.y + fluid->getNy()-1,
+                             location.z, location.z + fluid->getNz()-1);
+  vector<hemo::Array<plint,3>> innerNodes;
+
   //For all cells
   for (auto & pair : ppc) {
     bool broken = false;
@@ -233,16 +249,24 @@ void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc
 
     // If it was tagged last round, solidify it now
     if (solidify) {
-      hemo::OctreeStructCell octCell(3, 1, 30, cellConstants.triangle_list, particles, cell);
- 
-      set<Array<plint,3>> innerNodes;
-      octCell.findInnerNodes(fluid,particles,cell,innerNodes);
+      ScanlineVoxelizer & voxelizer = cellField.getVoxelizer();
+      voxelizer.refit(particles, cell);
+      innerNodes.clear();
+      voxelizer.findInnerNodes(absoluteDomain, innerNodes);
+      bool changed = false;
+      Box3D changedDomain;
       for (const Array<plint,3> & node : innerNodes) {
-          if (!fluid->get(node[0],node[1],node[2]).getDynamics().isBoundary()) {
-          defineDynamics(*fluid,node[0],node[1],node[2],new BounceBack<T,DESCRIPTOR>(1.));
-          bindingFieldHelper::get(*pf.cellFields).add(pf, {node[0],node[1],node[2]});
+        const plint x = node[0]-location.x, y = node[1]-location.y, z = node[2]-location.z;
+        if (!fluid->get(x,y,z).getDynamics().isBoundary()) {
+          defineDynamics(*fluid,x,y,z,new BounceBack<T,DESCRIPTOR>(1.));
+          bindingFieldHelper::get(*pf.cellFields).add(pf, {x,y,z});
+          changedDomain = changed ? bound(changedDomain, Box3D(x,x,y,y,z,z)) : Box3D(x,x,y,y,z,z);
+          changed = true;
         }
       }
+      if (changed) {
+        pf.wallsChanged(changedDomain);
+      }
      
       for (const int & particle : cell) {
         particles[particle].tag = 1; //tag for removal
@@ -47,12 +47,12 @@ void RbcMalariaModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & pa
 
     //Calculate Cell Values that need all particles (but do it most efficient
     //tailored to this class)
-    T volume = 0.0;
+    T volume = 0.0, total_area = 0.0;
     int triangle_n = 0;
-    vector<T> triangle_areas;
-    triangle_areas.reserve(cellConstants.triangle_list.size());
-    vector<hemo::Array<T,3>> triangle_normals;
-    triangle_normals.reserve(cellConstants.triangle_list.size());
+    CellGeometry & geometry = beginGeometry(cid, cell.size());
+    vector<T> & triangle_areas = geometry.triangleAreas;
+    vector<hemo::Array<T,3>> & triangle_normals = geometry.triangleNormals;
+    vector<hemo::Array<T,3>> & vertex_normals = geometry.vertexNormals;
 
     // Per-triangle calculations
     for (const hemo::Array<plint,3> & triangle : cellConstants.triangle_list) {
@@ -94,12 +94,14 @@ void RbcMalariaModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & pa
 
       //Store values necessary later
       triangle_areas.push_back(area);
+      total_area += area;
       triangle_normals.push_back(t_normal);
 
       triangle_n++;
     }
     
     volume *= (1.0/6.0);
+    finishGeometry(geometry, cell, volume, total_area);
 
     //Volume
     const T volume_frac = (volume-cellConstants.volume_eq)/cellConstants.volume_eq;
@@ -114,6 +116,12 @@ void RbcMalariaModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & pa
       *cell[triangle[1]]->force_volume += local_volume_force;
       *cell[triangle[2]]->force_volume += local_volume_force;
 
+      // Area weighted vertex normals, always pointing outward
+      const hemo::Array<T, 3> local_normal_dir = (triangle_normals[triangle_n])*(triangle_areas[triangle_n]/cellConstants.area_mean_eq);
+      vertex_normals[triangle[0]] += local_normal_dir;
+      vertex_normals[triangle[1]] += local_normal_dir;
+      vertex_normals[triangle[2]] += local_normal_dir;
+
       triangle_n++;
     }
 
@@ -0,0 +1,31 @@
+#ifndef HEMO_TESTS_TESTLATTICE_H
+#define HEMO_TESTS_TESTLATTICE_H
+
+#include "hemocell.h"
+#include "palabos3D.h"
+
+#include <map>
+
+// A lattice of nx x ny x nz nodes split into blocksX x blocksY x blocksZ
+// blocks, which are dealt out over the processes so that every process owns
+// some whenever there are at least as many blocks as processes. The internal
+// statistics are off, as in HemoCell.
+inline plb::MultiBlockLattice3D<T,DESCRIPTOR> * roundRobinLattice(plint nx, plint ny, plint nz,
+        plint blocksX, plint blocksY, plint blocksZ, plint envelopeWidth,
+        plb::Dynamics<T,DESCRIPTOR> * backgroundDynamics) {
+  plb::SparseBlockStructure3D blocks = plb::createRegularDistribution3D(nx, ny, nz, blocksX, blocksY, blocksZ);
+  std::map<plint,plint> blockToMpi;
+  for (auto const & pair : blocks.getBulks()) {
+    blockToMpi[pair.first] = pair.first % plb::global::mpi().getSize();
+  }
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * lattice = new plb::MultiBlockLattice3D<T,DESCRIPTOR>(
+        plb::MultiBlockManagement3D(blocks, new plb::ExplicitThreadAttribution(blockToMpi), envelopeWidth),
+        plb::defaultMultiBlockPolicy3D().getBlockCommunicator(),
+        plb::defaultMultiBlockPolicy3D().getCombinedStatistics(),
+        plb::defaultMultiBlockPolicy3D().getMultiCellAccess<T,DESCRIPTOR>(),
+        backgroundDynamics);
+  lattice->toggleInternalStatistics(false);
+  return lattice;
+}
+
+#endif
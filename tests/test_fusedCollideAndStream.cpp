@@ -0,0 +1,236 @@
+#include "gtest/gtest.h"
+#include "hemocell.h"
+#include "fusedCollideAndStream.h"
+#include "guoBodyForceDynamics.h"
+#include "hemoCellParticleField.h"
+#include "interiorViscosity.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+#include "testLattice.h"
+
+#include <cmath>
+#include <random>
+
+namespace {
+const plint nx = 12, ny = 10, nz = 9;
+
+// A periodic lattice of 2x2x1 blocks dealt out over the processes, with random
+// populations and forces, the inline dynamics with two relaxation times and a
+// body force, and a wall
+plb::MultiBlockLattice3D<T,DESCRIPTOR> * randomLattice() {
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * lattice = roundRobinLattice(nx, ny, nz, 2, 2, 1, 2,
+        new plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>(1./0.9));
+  lattice->periodicity().toggleAll(true);
+
+  plb::defineDynamics(*lattice, plb::Box3D(2, 5, 0, ny-1, 3, 6), new plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>(1./1.3));
+  plb::defineDynamics(*lattice, plb::Box3D(7, 10, 2, 8, 0, nz-1),
+                      new hemo::GuoBodyForceBGKdynamics<T,DESCRIPTOR>(1./0.8, plb::Array<T,3>(1e-4, -2e-4, 3e-5)));
+  plb::defineDynamics(*lattice, plb::Box3D(0, nx-1, 0, ny-1, 0, 0), new plb::BounceBack<T,DESCRIPTOR>(1.));
+
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<T> noise(-0.5, 0.5);
+  for (plint x = 0; x < nx; x++) {
+    for (plint y = 0; y < ny; y++) {
+      for (plint z = 0; z < nz; z++) {
+        plb::Cell<T,DESCRIPTOR> & cell = lattice->get(x, y, z);
+        for (plint iPop = 0; iPop < DESCRIPTOR<T>::q; iPop++) {
+          cell[iPop] = 1e-2*noise(generator);
+        }
+        T * force = cell.getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt);
+        for (int d = 0; d < 3; d++) {
+          force[d] = 1e-3*noise(generator);
+        }
+      }
+    }
+  }
+  lattice->duplicateOverlaps(plb::modif::staticVariables);
+  return lattice;
+}
+
+void expectEqualLattices(plb::MultiBlockLattice3D<T,DESCRIPTOR> & fused, plb::MultiBlockLattice3D<T,DESCRIPTOR> & reference) {
+  for (plint x = 0; x < nx; x++) {
+    for (plint y = 0; y < ny; y++) {
+      for (plint z = 0; z < nz; z++) {
+        plb::Cell<T,DESCRIPTOR> & a = fused.get(x, y, z);
+        plb::Cell<T,DESCRIPTOR> & b = reference.get(x, y, z);
+        for (plint iPop = 0; iPop < DESCRIPTOR<T>::q; iPop++) {
+          ASSERT_NEAR(a[iPop], b[iPop], 1e-14) << "node " << x << " " << y << " " << z << " population " << iPop;
+        }
+        for (int d = 0; d < 3; d++) {
+          ASSERT_EQ(a.getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt)[d],
+                    b.getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt)[d]);
+        }
+      }
+    }
+  }
+}
+
+// The force spread on a node of the periodic lattice, zero on most nodes
+T spreadForce(plint x, plint y, plint z, int d) {
+  x = (x + nx) % nx;
+  y = (y + ny) % ny;
+  z = (z + nz) % nz;
+  return (x + 2*y + 3*z) % 5 ? 0 : 1e-3*std::sin(1.1*x + 1.3*y + 0.7*z + d);
+}
+
+// Nodes with a tau in the interior viscosity field relax as if they had
+// dynamics with that tau
+void expectInteriorTau(plb::MultiBlockLattice3D<T,DESCRIPTOR> & fused, plb::MultiScalarField3D<T> & tau,
+                       plb::MultiBlockLattice3D<T,DESCRIPTOR> & reference) {
+  const plb::Box3D interior(3, 8, 1, 6, 2, 7);
+  const T interiorTau = 1.7;
+
+  plb::setToConstant(tau, tau.getBoundingBox(), (T)0);
+  plb::setToConstant(tau, interior, interiorTau);
+  tau.duplicateOverlaps(plb::modif::staticVariables);
+  plb::defineDynamics(reference, interior, new plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>(1./interiorTau));
+
+  // Walls keep their own collision
+  plb::defineDynamics(fused, plb::Box3D(3, 8, 1, 6, 2, 2), new plb::BounceBack<T,DESCRIPTOR>(1.));
+  plb::defineDynamics(reference, plb::Box3D(3, 8, 1, 6, 2, 2), new plb::BounceBack<T,DESCRIPTOR>(1.));
+
+  for (int iter = 0; iter < 3; iter++) {
+    hemo::fusedCollideAndStream(fused, &tau);
+    reference.collideAndStream();
+    expectEqualLattices(fused, reference);
+  }
+}
+}
+
+TEST(FusedCollideAndStream, MatchesCollideAndStream)
+{
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * fused = randomLattice();
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * reference = randomLattice();
+  ASSERT_TRUE(hemo::fusedCollideAndStreamApplies(*fused));
+
+  for (int iter = 0; iter < 3; iter++) {
+    hemo::fusedCollideAndStream(*fused);
+    reference->collideAndStream();
+    expectEqualLattices(*fused, *reference);
+  }
+  delete fused;
+  delete reference;
+}
+
+TEST(FusedCollideAndStream, InteriorTau)
+{
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * fused = randomLattice();
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * reference = randomLattice();
+  plb::MultiScalarField3D<T> tau(*fused);
+  tau.periodicity().toggleAll(true);
+  expectInteriorTau(*fused, tau, *reference);
+  delete fused;
+  delete reference;
+}
+
+// The field of InteriorViscosityHelper is created after
+// HemoCell::initializeCellfield() set the envelope of the fluid management to
+// 1, its atomic blocks must still match those of the fluid
+TEST(FusedCollideAndStream, InteriorTauFieldOfHelper)
+{
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * fused = randomLattice();
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> * reference = randomLattice();
+  const plint fluidEnvelope = fused->getMultiBlockManagement().getEnvelopeWidth();
+  ASSERT_EQ(fluidEnvelope, 2);
+  for (plb::MultiBlockLattice3D<T,DESCRIPTOR> * lattice : {fused, reference}) {
+    lattice->getMultiBlockManagement().changeEnvelopeWidth(1);
+    lattice->signalPeriodicity();
+  }
+
+  plb::MultiScalarField3D<T> * tau = hemo::InteriorViscosityHelper::createTauField(*fused, fluidEnvelope);
+  for (plint id : fused->getLocalInfo().getBlocks()) {
+    EXPECT_EQ(tau->getComponent(id).getNx(), fused->getComponent(id).getNx());
+    EXPECT_EQ(tau->getComponent(id).getNy(), fused->getComponent(id).getNy());
+    EXPECT_EQ(tau->getComponent(id).getNz(), fused->getComponent(id).getNz());
+  }
+  expectInteriorTau(*fused, *tau, *reference);
+  delete tau;
+  delete fused;
+  delete reference;
+}
+
+// The force in the tiles of the particle fields acts as if it were added to
+// the external force, which is left as it was. Without reading the external
+// force it must be zero, as with HemoCell::enableSparseForceReset()
+TEST(FusedCollideAndStream, SpreadForceTiles)
+{
+  for (bool readExternal : {true, false}) {
+    plb::MultiBlockLattice3D<T,DESCRIPTOR> * fused = randomLattice();
+    plb::MultiBlockLattice3D<T,DESCRIPTOR> * reference = randomLattice();
+    plb::MultiBlockLattice3D<T,DESCRIPTOR> * initial = randomLattice();
+    if (!readExternal) {
+      for (plb::MultiBlockLattice3D<T,DESCRIPTOR> * lattice : {fused, reference, initial}) {
+        plb::setExternalVector(*lattice, lattice->getBoundingBox(), DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+                               plb::Array<T,3>(0., 0., 0.));
+      }
+    }
+    plb::MultiParticleField3D<hemo::HemoCellParticleField> particles(plb::MultiBlockManagement3D(
+        *fused->getSparseBlockStructure().clone(),
+        fused->getMultiBlockManagement().getThreadAttribution().clone(),
+        fused->getMultiBlockManagement().getEnvelopeWidth(),
+        fused->getMultiBlockManagement().getRefinementLevel()), plb::defaultMultiBlockPolicy3D().getCombinedStatistics());
+
+    for (int iter = 0; iter < 3; iter++) {
+      // Every node of the atomic blocks, envelope included, gets the force of its periodic image
+      for (plint id : fused->getLocalInfo().getBlocks()) {
+        plb::BlockLattice3D<T,DESCRIPTOR> & block = fused->getComponent(id);
+        hemo::IbmForceTiles & tiles = particles.getComponent(id).forceTiles;
+        tiles.begin(block);
+        const plb::Dot3D location = block.getLocation();
+        for (plint x = 0; x < block.getNx(); x++) {
+          for (plint y = 0; y < block.getNy(); y++) {
+            for (plint z = 0; z < block.getNz(); z++) {
+              const hemo::Array<T,3> force = {spreadForce(x + location.x, y + location.y, z + location.z, 0),
+                                              spreadForce(x + location.x, y + location.y, z + location.z, 1),
+                                              spreadForce(x + location.x, y + location.y, z + location.z, 2)};
+              if (force[0] != 0 || force[1] != 0 || force[2] != 0) {
+                tiles.add(&block.get(x, y, z), force);
+              }
+            }
+          }
+        }
+      }
+      for (plint x = 0; x < nx; x++) {
+        for (plint y = 0; y < ny; y++) {
+          for (plint z = 0; z < nz; z++) {
+            T * force = reference->get(x, y, z).getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt);
+            for (int d = 0; d < 3; d++) {
+              force[d] += spreadForce(x, y, z, d);
+            }
+          }
+        }
+      }
+      reference->duplicateOverlaps(plb::modif::staticVariables);
+
+      hemo::fusedCollideAndStream(*fused, 0, &particles, readExternal);
+      reference->collideAndStream();
+
+      for (plint x = 0; x < nx; x++) {
+        for (plint y = 0; y < ny; y++) {
+          for (plint z = 0; z < nz; z++) {
+            const T * external = initial->get(x, y, z).getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt);
+            T * force = reference->get(x, y, z).getExternal(DESCRIPTOR<T>::ExternalField::forceBeginsAt);
+            for (int d = 0; d < 3; d++) {
+              force[d] = external[d];
+            }
+          }
+        }
+      }
+      reference->duplicateOverlaps(plb::modif::staticVariables);
+      expectEqualLattices(*fused, *reference);
+    }
+    delete fused;
+    delete reference;
+    delete initial;
+  }
+}
+
+TEST(FusedCollideAndStream, Inlines)
+{
+  plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR> guo(1.);
+  hemo::GuoBodyForceBGKdynamics<T,DESCRIPTOR> bodyForce(1.);
+  plb::BGKdynamics<T,DESCRIPTOR> bgk(1.);
+  EXPECT_TRUE(hemo::fusedCollideAndStreamInlines(guo));
+  EXPECT_TRUE(hemo::fusedCollideAndStreamInlines(bodyForce));
+  EXPECT_FALSE(hemo::fusedCollideAndStreamInlines(bgk));
+}
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "geometryUtils.h"
+
+#include <random>
+
+namespace {
+// Eigenvalues are the roots of det(A - lambda I), so they are fixed by the
+// trace, the sum of the principal 2x2 minors and the determinant
+void expectEigenvaluesOf(const hemo::Array<T,6> & a, const hemo::Array<T,3> & lambda, T tolerance) {
+  const T trace = a[0] + a[3] + a[5];
+  const T minors = a[0]*a[3] - a[1]*a[1] + a[0]*a[5] - a[2]*a[2] + a[3]*a[5] - a[4]*a[4];
+  const T det = a[0]*(a[3]*a[5] - a[4]*a[4]) - a[1]*(a[1]*a[5] - a[4]*a[2]) + a[2]*(a[1]*a[4] - a[3]*a[2]);
+  EXPECT_LE(lambda[0], lambda[1]);
+  EXPECT_LE(lambda[1], lambda[2]);
+  EXPECT_NEAR(lambda[0] + lambda[1] + lambda[2], trace, tolerance);
+  EXPECT_NEAR(lambda[0]*lambda[1] + lambda[0]*lambda[2] + lambda[1]*lambda[2], minors, tolerance);
+  EXPECT_NEAR(lambda[0]*lambda[1]*lambda[2], det, tolerance);
+}
+
+// A v = lambda v for the unit vector v returned for lambda
+void expectEigenvectorOf(const hemo::Array<T,6> & a, T lambda, T tolerance) {
+  const hemo::Array<T,3> v = symmetricEigenvector(a, lambda);
+  const hemo::Array<T,3> av = {a[0]*v[0] + a[1]*v[1] + a[2]*v[2],
+                               a[1]*v[0] + a[3]*v[1] + a[4]*v[2],
+                               a[2]*v[0] + a[4]*v[1] + a[5]*v[2]};
+  EXPECT_NEAR(dot(v,v), 1., 1e-12);
+  for (int d = 0; d < 3; d++) {
+    EXPECT_NEAR(av[d], lambda*v[d], tolerance) << "lambda " << lambda << " component " << d;
+  }
+}
+}
+
+TEST(GeometryUtils, SymmetricEigenvaluesDiagonal)
+{
+  const hemo::Array<T,3> lambda = symmetricEigenvalues({3., 0., 0., -1., 0., 2.});
+  EXPECT_EQ(lambda[0], -1.);
+  EXPECT_EQ(lambda[1], 2.);
+  EXPECT_EQ(lambda[2], 3.);
+}
+
+TEST(GeometryUtils, SymmetricEigenvaluesKnown)
+{
+  // {{2,1,0},{1,2,0},{0,0,5}} has eigenvalues 1, 3 and 5
+  hemo::Array<T,3> lambda = symmetricEigenvalues({2., 1., 0., 2., 0., 5.});
+  EXPECT_NEAR(lambda[0], 1., 1e-12);
+  EXPECT_NEAR(lambda[1], 3., 1e-12);
+  EXPECT_NEAR(lambda[2], 5., 1e-12);
+
+  // A double eigenvalue: {{1,1,1},{1,1,1},{1,1,1}} has eigenvalues 0, 0 and 3
+  lambda = symmetricEigenvalues({1., 1., 1., 1., 1., 1.});
+  EXPECT_NEAR(lambda[0], 0., 1e-12);
+  EXPECT_NEAR(lambda[1], 0., 1e-12);
+  EXPECT_NEAR(lambda[2], 3., 1e-12);
+
+  // A multiple of the identity with off-diagonal round-off
+  lambda = symmetricEigenvalues({4., 1e-17, 0., 4., 0., 4.});
+  EXPECT_NEAR(lambda[0], 4., 1e-12);
+  EXPECT_NEAR(lambda[2], 4., 1e-12);
+}
+
+TEST(GeometryUtils, SymmetricEigenvaluesRandom)
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<T> element(-1., 1.);
+  for (int i = 0; i < 1000; i++) {
+    hemo::Array<T,6> a;
+    for (T & value : a) {
+      value = element(generator);
+    }
+    expectEigenvaluesOf(a, symmetricEigenvalues(a), 1e-10);
+  }
+}
+
+// The Tresca stress of a strain rate tensor is half the spread of its eigenvalues
+TEST(GeometryUtils, SymmetricEigenvaluesSimpleShear)
+{
+  const T shearRate = 2e-3;
+  const hemo::Array<T,3> lambda = symmetricEigenvalues({0., shearRate/2, 0., 0., 0., 0.});
+  EXPECT_NEAR((lambda[2] - lambda[0])/2, shearRate/2, 1e-15);
+}
+
+TEST(GeometryUtils, SymmetricEigenvectorDistinct)
+{
+  // {{2,1,0},{1,2,0},{0,0,5}} has eigenvalues 1, 3 and 5
+  for (T lambda : {1., 3., 5.}) {
+    expectEigenvectorOf({2., 1., 0., 2., 0., 5.}, lambda, 1e-12);
+  }
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<T> element(-1., 1.);
+  for (int i = 0; i < 1000; i++) {
+    hemo::Array<T,6> a;
+    for (T & value : a) {
+      value = element(generator);
+    }
+    for (T lambda : symmetricEigenvalues(a)) {
+      expectEigenvectorOf(a, lambda, 1e-8);
+    }
+  }
+}
+
+// A - lambda I has rank one for a double eigenvalue
+TEST(GeometryUtils, SymmetricEigenvectorDouble)
+{
+  // {{1,1,1},{1,1,1},{1,1,1}} has eigenvalues 0, 0 and 3
+  expectEigenvectorOf({1., 1., 1., 1., 1., 1.}, 0., 1e-12);
+  expectEigenvectorOf({1., 1., 1., 1., 1., 1.}, 3., 1e-12);
+  // Diagonal, with the double eigenvalue 2
+  expectEigenvectorOf({2., 0., 0., 2., 0., 5.}, 2., 1e-12);
+  expectEigenvectorOf({2., 0., 0., 2., 0., 5.}, 5., 1e-12);
+}
+
+// Every vector is an eigenvector of a multiple of the identity
+TEST(GeometryUtils, SymmetricEigenvectorTriple)
+{
+  expectEigenvectorOf({4., 0., 0., 4., 0., 4.}, 4., 1e-12);
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "hemocell.h"
+#include "guoTRTdynamics.h"
+
+#include <random>
+
+namespace {
+typedef DESCRIPTOR<T> Lattice;
+typedef hemo::GuoExternalForceTRTdynamics<T,DESCRIPTOR> TRTdynamics;
+
+// A cell near equilibrium with a random force
+void randomCell(plb::Cell<T,DESCRIPTOR> & cell, std::mt19937 & generator) {
+  std::uniform_real_distribution<T> noise(-0.5, 0.5);
+  for (plint iPop = 0; iPop < Lattice::q; iPop++) {
+    cell[iPop] = Lattice::t[iPop]*0.02*noise(generator);
+  }
+  T * force = cell.getExternal(Lattice::ExternalField::forceBeginsAt);
+  for (int d = 0; d < 3; d++) {
+    force[d] = 1e-3*noise(generator);
+  }
+  cell.specifyStatisticsStatus(false);
+}
+
+void moments(plb::Cell<T,DESCRIPTOR> & cell, T & rhoBar, plb::Array<T,3> & j) {
+  rhoBar = 0.;
+  j.resetToZero();
+  for (plint iPop = 0; iPop < Lattice::q; iPop++) {
+    rhoBar += cell[iPop];
+    for (int d = 0; d < 3; d++) {
+      j[d] += Lattice::c[iPop][d]*cell[iPop];
+    }
+  }
+}
+}
+
+TEST(GuoTRTdynamics, OmegaMinusKeepsMagic)
+{
+  for (T tau = 0.51; tau < 3.; tau += 0.17) {
+    const T omegaMinus = TRTdynamics::omegaMinus(1./tau, 3./16.);
+    EXPECT_NEAR((tau - 0.5)*(1./omegaMinus - 0.5), 3./16., 1e-12) << "tau " << tau;
+  }
+}
+
+// With Lambda = (1/omega - 1/2)^2 both parts relax with omega, which is BGK
+TEST(GuoTRTdynamics, ReducesToBGK)
+{
+  std::mt19937 generator(11);
+  plb::BlockStatistics statistics;
+  for (T tau = 0.55; tau < 2.5; tau += 0.15) {
+    const T omega = 1./tau;
+    TRTdynamics trt(omega, (tau - 0.5)*(tau - 0.5));
+    plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR> bgk(omega);
+    EXPECT_NEAR(TRTdynamics::omegaMinus(omega, trt.getMagic()), omega, 1e-12);
+
+    plb::Cell<T,DESCRIPTOR> a(&trt), b(&bgk);
+    randomCell(a, generator);
+    b = a;
+    b.attributeDynamics(&bgk);
+    trt.collide(a, statistics);
+    bgk.collide(b, statistics);
+    for (plint iPop = 0; iPop < Lattice::q; iPop++) {
+      EXPECT_NEAR(a[iPop], b[iPop], 1e-15) << "tau " << tau << " population " << iPop;
+    }
+  }
+}
+
+// Any magic parameter conserves mass and adds the force to the momentum
+TEST(GuoTRTdynamics, ConservesMassAndMomentum)
+{
+  std::mt19937 generator(5);
+  plb::BlockStatistics statistics;
+  for (T magic : {1./12., 3./16., 1./4.}) {
+    TRTdynamics trt(1./0.52, magic);
+    plb::Cell<T,DESCRIPTOR> cell(&trt);
+    randomCell(cell, generator);
+    T rhoBar0, rhoBar1;
+    plb::Array<T,3> j0, j1;
+    // At unit density the momentum gains exactly the force
+    moments(cell, rhoBar0, j0);
+    cell[0] -= rhoBar0;
+    moments(cell, rhoBar0, j0);
+    trt.collide(cell, statistics);
+    moments(cell, rhoBar1, j1);
+    EXPECT_NEAR(rhoBar1, rhoBar0, 1e-15) << "magic " << magic;
+    const T * force = cell.getExternal(Lattice::ExternalField::forceBeginsAt);
+    for (int d = 0; d < 3; d++) {
+      EXPECT_NEAR(j1[d] - j0[d], force[d], 1e-15) << "magic " << magic;
+    }
+  }
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "hemocell.h"
+#include "immersedBoundaryMethod.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace {
+// The weights of the W nodes that the kernel spans sum to one, and the kernel
+// vanishes outside of them
+template<int W, T(*phi)(T)>
+void expectPartitionOfUnity() {
+  for (T x = 0.; x < 2.; x += 0.0625) {
+    const plint first = plint(floor(x - 0.5*(W-2)));
+    T sum = 0.;
+    for (plint node = first; node < first + W; node++) {
+      EXPECT_GE(phi(x - node), 0.);
+      sum += phi(x - node);
+    }
+    EXPECT_NEAR(sum, 1., 1e-12) << "at " << x;
+    EXPECT_NEAR(phi(x - (first - 1)), 0., 1e-12) << "at " << x;
+    EXPECT_NEAR(phi(x - (first + W)), 0., 1e-12) << "at " << x;
+  }
+}
+
+typedef void (*KernelMethod)(plb::BlockLattice3D<T,DESCRIPTOR> &, hemo::HemoCellParticle &);
+
+T sumOfWeights(const hemo::HemoCellParticle & particle) {
+  T sum = 0.;
+  for (T weight : particle.kernelWeights) {
+    sum += weight;
+  }
+  return sum;
+}
+}
+
+TEST(ImmersedBoundaryMethod, KernelsArePartitionsOfUnity)
+{
+  expectPartitionOfUnity<2, hemo::phi2>();
+  expectPartitionOfUnity<3, hemo::phi3>();
+  expectPartitionOfUnity<4, hemo::phi4>();
+  expectPartitionOfUnity<4, hemo::phi4c>();
+}
+
+TEST(ImmersedBoundaryMethod, KernelWeights)
+{
+  const KernelMethod kernels[] = {hemo::interpolationCoefficientsPhi2, hemo::interpolationCoefficientsPhi3,
+                                  hemo::interpolationCoefficientsPhi4, hemo::interpolationCoefficientsPhi4c};
+  const unsigned int widths[] = {2, 3, 4, 4};
+  T (* const phis[])(T) = {hemo::phi2, hemo::phi3, hemo::phi4, hemo::phi4c};
+
+  for (int k = 0; k < 4; k++) {
+    plb::BlockLattice3D<T,DESCRIPTOR> block(12, 12, 12, new plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>(1.));
+
+    // Within the block all nodes with a nonzero weight take part, and the
+    // weight of a node is the product of the 1D weights
+    hemo::HemoCellParticle particle({5.3, 6.7, 4.45}, 0, 0, 0);
+    kernels[k](block, particle);
+    EXPECT_NEAR(sumOfWeights(particle), 1., 1e-12) << "kernel " << k;
+    EXPECT_LE(particle.kernelWeights.size(), widths[k]*widths[k]*widths[k]);
+    EXPECT_EQ(particle.kernelWeights.size(), particle.kernelLocations.size());
+    for (plint x = 0; x < 12; x++) {
+      for (plint y = 0; y < 12; y++) {
+        for (plint z = 0; z < 12; z++) {
+          const T expected = phis[k](5.3 - x) * phis[k](6.7 - y) * phis[k](4.45 - z);
+          T weight = 0.;
+          for (unsigned int i = 0; i < particle.kernelLocations.size(); i++) {
+            if (particle.kernelLocations[i] == &block.get(x, y, z)) {
+              weight += particle.kernelWeights[i];
+            }
+          }
+          EXPECT_NEAR(weight, expected, 1e-12) << "kernel " << k << " node " << x << " " << y << " " << z;
+        }
+      }
+    }
+
+    // Near the edge of the block the nodes outside belong to the neighbouring
+    // block, the weights are not normalized over the nodes inside
+    hemo::HemoCellParticle edge({-0.3, 6.7, 4.45}, 0, 0, 0);
+    kernels[k](block, edge);
+    T inside = 0.;
+    for (plint x = 0; x < 4; x++) {
+      inside += phis[k](-0.3 - x);
+    }
+    EXPECT_NEAR(sumOfWeights(edge), inside, 1e-12) << "kernel " << k;
+    EXPECT_LT(sumOfWeights(edge), 1.) << "kernel " << k;
+
+    // A boundary node is left out and the other nodes take over its weight
+    block.attributeDynamics(5, 7, 4, new plb::BounceBack<T,DESCRIPTOR>(1.));
+    kernels[k](block, particle);
+    EXPECT_NEAR(sumOfWeights(particle), 1., 1e-12) << "kernel " << k;
+    for (plb::Cell<T,DESCRIPTOR> * cell : particle.kernelLocations) {
+      EXPECT_NE(cell, &block.get(5, 7, 4)) << "kernel " << k;
+    }
+  }
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "hemocell.h"
+#include "leesEdwardsBC.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+#include "testLattice.h"
+
+#include <cmath>
+
+namespace {
+typedef DESCRIPTOR<T> Lattice;
+const plint n[3] = {7, 9, 11};
+
+T population(plint iPop, plint x, plint y, plint z) {
+  return 0.01*std::sin(0.7*x + 1.3*y + 2.1*z + 0.5*iPop);
+}
+
+// 2x2x3 blocks, so that the planes are split between processes whenever
+// there is more than one
+plb::MultiBlockLattice3D<T,DESCRIPTOR> * blockLattice() {
+  return roundRobinLattice(n[0], n[1], n[2], 2, 2, 3, 1, new plb::GuoExternalForceBGKdynamics<T,DESCRIPTOR>(1.));
+}
+
+// Call function(x, y, z, cell) for every node of the blocks of this process
+template<typename Function>
+void forEachLocalNode(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice, Function function) {
+  plb::MultiBlockManagement3D const & management = lattice.getMultiBlockManagement();
+  for (plint id : lattice.getLocalInfo().getBlocks()) {
+    plb::Box3D bulk;
+    management.getSparseBlockStructure().getBulk(id, bulk);
+    plb::BlockLattice3D<T,DESCRIPTOR> & block = lattice.getComponent(id);
+    const plb::Dot3D location = block.getLocation();
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+      for (plint y = bulk.y0; y <= bulk.y1; y++) {
+        for (plint z = bulk.z0; z <= bulk.z1; z++) {
+          function(x, y, z, block.get(x - location.x, y - location.y, z - location.z));
+        }
+      }
+    }
+  }
+}
+}
+
+// The populations entering a plane are those of the plane, displaced along the
+// flow axis and interpolated linearly, no matter which process owns the nodes
+// they are taken from. Run with mpirun to exercise the transfers between
+// processes, on a single process all of them are local.
+TEST(LeesEdwardsBC, DisplacedPopulations)
+{
+  char *args[] = {(char *)"test", (char *)"path", NULL};
+  char *inp = (char *)"validation/pipeflow/config_pipeflow.xml";
+  hemo::HemoCell hemocell(inp, 0, args, hemo::HemoCell::MPIHandle::External);
+  hemocell.lattice = blockLattice();
+  plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice = *hemocell.lattice;
+
+  for (int normal = 0; normal < 3; normal++) {
+    for (int flow = 0; flow < 3; flow++) {
+      if (flow == normal) { continue; }
+      const int other = 3 - normal - flow;
+      hemo::LeesEdwardsBC leesEdwards(hemocell, 0.37, 1., normal, flow);
+
+      // Includes displacements that wrap around the flow axis
+      for (unsigned int iter : {0, 1, 2, 5, 13, 14, 40, 41}) {
+        hemocell.iter = iter;
+        forEachLocalNode(lattice, [](plint x, plint y, plint z, plb::Cell<T,DESCRIPTOR> & cell) {
+          for (plint iPop = 0; iPop < Lattice::q; iPop++) {
+            cell[iPop] = population(iPop, x, y, z);
+          }
+        });
+        leesEdwards.apply();
+        const double displacement = leesEdwards.getDisplacement();
+        EXPECT_NEAR(displacement, std::fmod(0.37*iter, (double)n[flow]), 1e-12);
+
+        long checked = 0;
+        forEachLocalNode(lattice, [&](plint x, plint y, plint z, plb::Cell<T,DESCRIPTOR> & cell) {
+          const plint position[3] = {x, y, z};
+          const int plane = position[normal] == 0 ? 0 : (position[normal] == n[normal] - 1 ? 1 : -1);
+          for (plint iPop = 0; iPop < Lattice::q; iPop++) {
+            if (plane < 0) {
+              ASSERT_EQ(cell[iPop], population(iPop, x, y, z)) << "node " << x << " " << y << " " << z;
+              continue;
+            }
+            if (Lattice::c[iPop][normal] != (plane ? -1 : 1)) { continue; }
+            // Taken from the population with the mirrored flow component
+            plint mirrored = -1;
+            for (plint jPop = 0; jPop < Lattice::q; jPop++) {
+              if (Lattice::c[jPop][normal] == Lattice::c[iPop][normal] && Lattice::c[jPop][other] == Lattice::c[iPop][other] &&
+                  Lattice::c[jPop][flow] == -Lattice::c[iPop][flow]) {
+                mirrored = jPop;
+              }
+            }
+            const double shifted = position[flow] + (plane ? displacement : -displacement);
+            const plint left = std::floor(shifted);
+            const T weight = shifted - left;
+            plint p1[3] = {x, y, z}, p2[3] = {x, y, z};
+            p1[flow] = ((left % n[flow]) + n[flow]) % n[flow];
+            p2[flow] = (((left + 1) % n[flow]) + n[flow]) % n[flow];
+            const T expected = (1 - weight)*population(mirrored, p1[0], p1[1], p1[2]) + weight*population(mirrored, p2[0], p2[1], p2[2]);
+            ASSERT_NEAR(cell[iPop], expected, 1e-14) << "normal " << normal << " flow " << flow << " iteration " << iter
+                                                     << " node " << x << " " << y << " " << z << " population " << iPop;
+            checked++;
+          }
+        });
+
+        // Every node of both planes received its five populations
+        long total = 0;
+        MPI_Allreduce(&checked, &total, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+        EXPECT_EQ(total, 2*5*n[flow]*n[other]);
+      }
+    }
+  }
+}
@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+#include "scanlineVoxelizer.h"
+
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace {
+typedef std::set<hemo::Array<plint,3>> NodeSet;
+
+struct Mesh {
+  std::vector<hemo::HemoCellParticle> particles;
+  std::vector<hemo::Array<plint,3>> triangles;
+  std::vector<int> cell;
+
+  void addVertex(T x, T y, T z) {
+    cell.push_back(particles.size());
+    particles.push_back(hemo::HemoCellParticle({x, y, z}, 0, particles.size(), 0));
+  }
+};
+
+// Axis aligned box between lo and hi, with outward facing triangles
+Mesh box(hemo::Array<T,3> lo, hemo::Array<T,3> hi) {
+  Mesh mesh;
+  for (int i = 0; i < 8; i++) {
+    mesh.addVertex(i & 4 ? hi[0] : lo[0], i & 2 ? hi[1] : lo[1], i & 1 ? hi[2] : lo[2]);
+  }
+  mesh.triangles = {{0,1,3}, {0,3,2}, {4,6,7}, {4,7,5},  // x faces
+                    {0,4,5}, {0,5,1}, {2,3,7}, {2,7,6},  // y faces
+                    {0,2,6}, {0,6,4}, {1,5,7}, {1,7,3}}; // z faces
+  return mesh;
+}
+
+// The set |x-c| + |y-c| + |z-c| <= r
+Mesh octahedron(hemo::Array<T,3> c, T r) {
+  Mesh mesh;
+  for (int d = 0; d < 3; d++) {
+    for (int sign = -1; sign <= 1; sign += 2) {
+      hemo::Array<T,3> p = c;
+      p[d] += sign*r;
+      mesh.addVertex(p[0], p[1], p[2]);
+    }
+  }
+  // Vertices 0/1 are -x/+x, 2/3 -y/+y, 4/5 -z/+z
+  for (int ix = 0; ix < 2; ix++) {
+    for (int iy = 2; iy < 4; iy++) {
+      for (int iz = 4; iz < 6; iz++) {
+        mesh.triangles.push_back({ix, iy, iz});
+      }
+    }
+  }
+  return mesh;
+}
+
+NodeSet innerNodes(Mesh & mesh, const plb::Box3D & domain) {
+  hemo::ScanlineVoxelizer voxelizer(mesh.triangles);
+  voxelizer.refit(mesh.particles, mesh.cell);
+  std::vector<hemo::Array<plint,3>> nodes;
+  voxelizer.findInnerNodes(domain, nodes);
+  NodeSet unique(nodes.begin(), nodes.end());
+  EXPECT_EQ(unique.size(), nodes.size()) << "nodes are reported more than once";
+  return unique;
+}
+}
+
+TEST(ScanlineVoxelizer, Box)
+{
+  Mesh mesh = box({2.5, 3.5, 1.5}, {7.5, 6.5, 8.5});
+  const NodeSet nodes = innerNodes(mesh, plb::Box3D(0, 10, 0, 10, 0, 10));
+  EXPECT_EQ(nodes.size(), 5u*3u*7u);
+  for (const hemo::Array<plint,3> & node : nodes) {
+    EXPECT_TRUE(node[0] >= 3 && node[0] <= 7 && node[1] >= 4 && node[1] <= 6 && node[2] >= 2 && node[2] <= 8);
+  }
+}
+
+// Rays through the diagonal edges of the faces and through the vertices of the
+// octahedron must cross its surface exactly once per side
+TEST(ScanlineVoxelizer, RaysThroughEdgesAndVertices)
+{
+  Mesh mesh = box({2.5, 3., 1.}, {7.5, 7., 5.});
+  const NodeSet nodes = innerNodes(mesh, plb::Box3D(0, 10, 0, 10, 0, 10));
+  // Nodes on the y and z faces are inside or outside, but every ray holds
+  // the same five x positions or none
+  std::map<std::pair<plint,plint>, int> perRay;
+  for (const hemo::Array<plint,3> & node : nodes) {
+    EXPECT_TRUE(node[0] >= 3 && node[0] <= 7);
+    perRay[std::make_pair(node[1], node[2])]++;
+  }
+  for (auto const & ray : perRay) {
+    EXPECT_EQ(ray.second, 5) << "ray y=" << ray.first.first << " z=" << ray.first.second;
+  }
+  // The open interior (y in 4..6, z in 2..4) is always found
+  for (plint y = 4; y <= 6; y++) {
+    for (plint z = 2; z <= 4; z++) {
+      EXPECT_EQ(perRay[std::make_pair(y, z)], 5);
+    }
+  }
+
+  Mesh diamond = octahedron({10., 10., 10.}, 4.);
+  const NodeSet diamondNodes = innerNodes(diamond, plb::Box3D(0, 20, 0, 20, 0, 20));
+  for (const hemo::Array<plint,3> & node : diamondNodes) {
+    EXPECT_LE(std::abs(node[0]-10) + std::abs(node[1]-10) + std::abs(node[2]-10), 4);
+  }
+  for (plint x = 0; x <= 20; x++) {
+    for (plint y = 0; y <= 20; y++) {
+      for (plint z = 0; z <= 20; z++) {
+        if (std::abs(x-10) + std::abs(y-10) + std::abs(z-10) < 4) {
+          EXPECT_EQ(diamondNodes.count({x, y, z}), 1u) << x << " " << y << " " << z;
+        }
+      }
+    }
+  }
+}
+
+TEST(ScanlineVoxelizer, MatchesBruteForce)
+{
+  const hemo::Array<T,3> c = {10.3, 9.8, 10.1};
+  const T r = 6.35;
+  Mesh mesh = octahedron(c, r);
+  const NodeSet nodes = innerNodes(mesh, plb::Box3D(0, 20, 0, 20, 0, 20));
+  size_t expected = 0;
+  for (plint x = 0; x <= 20; x++) {
+    for (plint y = 0; y <= 20; y++) {
+      for (plint z = 0; z <= 20; z++) {
+        const bool inside = std::fabs(x-c[0]) + std::fabs(y-c[1]) + std::fabs(z-c[2]) < r;
+        expected += inside;
+        EXPECT_EQ(nodes.count({x, y, z}), (size_t)inside) << x << " " << y << " " << z;
+      }
+    }
+  }
+  EXPECT_EQ(nodes.size(), expected);
+}
+
+// Splitting the domain splits the result
+TEST(ScanlineVoxelizer, Subdomains)
+{
+  Mesh mesh = octahedron({10.3, 9.8, 10.1}, 6.35);
+  const NodeSet all = innerNodes(mesh, plb::Box3D(0, 20, 0, 20, 0, 20));
+  NodeSet joined;
+  const plb::Box3D parts[] = {plb::Box3D(0, 9, 0, 20, 0, 20), plb::Box3D(10, 20, 0, 11, 0, 20),
+                              plb::Box3D(10, 20, 12, 20, 0, 6), plb::Box3D(10, 20, 12, 20, 7, 20)};
+  for (const plb::Box3D & part : parts) {
+    for (const hemo::Array<plint,3> & node : innerNodes(mesh, part)) {
+      EXPECT_TRUE(part.x0 <= node[0] && node[0] <= part.x1 && part.y0 <= node[1] && node[1] <= part.y1 &&
+                  part.z0 <= node[2] && node[2] <= part.z1);
+      EXPECT_TRUE(joined.insert(node).second);
+    }
+  }
+  EXPECT_EQ(joined, all);
+
+  // Outside the cell
+  EXPECT_TRUE(innerNodes(mesh, plb::Box3D(30, 40, 0, 20, 0, 20)).empty());
+}
@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include "sfcPartitioner.h"
+
+#include <array>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+// Every point of a 2^k cube at the origin gets a unique key, and the curve
+// moves to a face neighbour between consecutive keys.
+TEST(SfcPartitioner, HilbertKeyIsContinuous)
+{
+  std::map<uint64_t, std::array<int,3>> points;
+  for (int x = 0; x < 8; x++) {
+    for (int y = 0; y < 8; y++) {
+      for (int z = 0; z < 8; z++) {
+        points[hemo::hilbertKey(x, y, z)] = {x, y, z};
+      }
+    }
+  }
+  ASSERT_EQ(points.size(), 512u);
+  // The curve starts in the origin, so the cube holds its first 512 keys
+  EXPECT_EQ(points.begin()->first, 0u);
+  EXPECT_EQ(points.rbegin()->first, 511u);
+
+  auto previous = points.begin();
+  for (auto current = std::next(previous); current != points.end(); previous = current++) {
+    const int distance = std::abs(current->second[0] - previous->second[0])
+                       + std::abs(current->second[1] - previous->second[1])
+                       + std::abs(current->second[2] - previous->second[2]);
+    EXPECT_EQ(distance, 1) << "between keys " << previous->first << " and " << current->first;
+  }
+}
+
+TEST(SfcPartitioner, MortonKeyInterleavesBits)
+{
+  EXPECT_EQ(hemo::mortonKey(0, 0, 0), 0u);
+  EXPECT_EQ(hemo::mortonKey(0, 0, 1), 1u);
+  EXPECT_EQ(hemo::mortonKey(0, 1, 0), 2u);
+  EXPECT_EQ(hemo::mortonKey(1, 0, 0), 4u);
+  EXPECT_EQ(hemo::mortonKey(3, 3, 3), 63u);
+}
+
+// Equal blocks are spread evenly, every process gets a contiguous, compact
+// piece of the domain.
+TEST(SfcPartitioner, PartitionAlongCurveBalancesBlocks)
+{
+  plb::SparseBlockStructure3D structure(plb::Box3D(0, 31, 0, 31, 0, 31));
+  plb::plint id = 0;
+  for (int x = 0; x < 4; x++) {
+    for (int y = 0; y < 4; y++) {
+      for (int z = 0; z < 4; z++) {
+        structure.addBlock(plb::Box3D(8*x, 8*x+7, 8*y, 8*y+7, 8*z, 8*z+7), id++);
+      }
+    }
+  }
+  const std::vector<plb::plint> processes = {0, 1, 2, 3, 4, 5, 6, 7};
+  const std::map<plb::plint,T> weights;
+  const std::map<plb::plint,plb::plint> blockToMpi = hemo::partitionAlongCurve(structure, weights, processes);
+
+  ASSERT_EQ(blockToMpi.size(), 64u);
+  std::map<plb::plint, std::vector<plb::Box3D>> perProcess;
+  for (auto const & pair : blockToMpi) {
+    plb::Box3D bulk;
+    structure.getBulk(pair.first, bulk);
+    perProcess[pair.second].push_back(bulk);
+  }
+  ASSERT_EQ(perProcess.size(), processes.size());
+  for (auto const & pair : perProcess) {
+    EXPECT_EQ(pair.second.size(), 8u) << "process " << pair.first;
+    // Eight consecutive blocks of a Hilbert curve on a 4^3 grid form a 2^3 octant
+    plb::Box3D bound = pair.second[0];
+    for (plb::Box3D const & bulk : pair.second) {
+      bound.x0 = std::min(bound.x0, bulk.x0); bound.x1 = std::max(bound.x1, bulk.x1);
+      bound.y0 = std::min(bound.y0, bulk.y0); bound.y1 = std::max(bound.y1, bulk.y1);
+      bound.z0 = std::min(bound.z0, bulk.z0); bound.z1 = std::max(bound.z1, bulk.z1);
+    }
+    EXPECT_EQ(bound.nCells(), 16*16*16) << "process " << pair.first;
+  }
+}
+
+// A block that costs as much as all others together gets a process of its own
+TEST(SfcPartitioner, PartitionAlongCurveUsesWeights)
+{
+  plb::SparseBlockStructure3D structure(plb::Box3D(0, 63, 0, 7, 0, 7));
+  for (plb::plint id = 0; id < 8; id++) {
+    structure.addBlock(plb::Box3D(8*id, 8*id+7, 0, 7, 0, 7), id);
+  }
+  std::map<plb::plint,T> weights;
+  for (plb::plint id = 0; id < 8; id++) {
+    weights[id] = 1.;
+  }
+  weights[0] = 7.;
+  const std::map<plb::plint,plb::plint> blockToMpi = hemo::partitionAlongCurve(structure, weights, {3, 5});
+
+  ASSERT_EQ(blockToMpi.size(), 8u);
+  const plb::plint heavy = blockToMpi.at(0);
+  for (plb::plint id = 1; id < 8; id++) {
+    EXPECT_NE(blockToMpi.at(id), heavy) << "block " << id;
+  }
+  std::set<plb::plint> used;
+  for (auto const & pair : blockToMpi) {
+    used.insert(pair.second);
+  }
+  EXPECT_EQ(used, std::set<plb::plint>({3, 5}));
+}
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Convert the HDF5 cell information tables of HemoCell to CSV.
+
+HemoCell writes ``hdf5/<iter>/CellInfo.<iter>.w.<writer>.h5`` when
+``<parameters><cellInfoOutput>`` is ``hdf5`` or ``both``. Every file holds one
+group per cell type with one dataset per column. This script merges the files
+of the writers and produces the same ``<celltype>.<iter>.csv`` files as
+``writeCellInfo_CSV``.
+"""
+import argparse
+import glob
+import os
+import re
+import sys
+
+import h5py
+import numpy as np
+
+COLUMNS = ["X", "Y", "Z", "area", "volume", "atomic_block", "cellId",
+           "baseCellId", "velocity_x", "velocity_y", "velocity_z", "stretch",
+           "axis_major", "axis_middle", "axis_minor", "deformation_index",
+           "major_axis_x", "major_axis_y", "major_axis_z"]
+INTEGER_COLUMNS = {"atomic_block", "cellId", "baseCellId"}
+
+
+def convert_iteration(files, outdir, iteration):
+    tables = {}
+    for path in sorted(files):
+        with h5py.File(path, "r") as f:
+            for celltype, group in f.items():
+                table = tables.setdefault(celltype,
+                                          {c: [] for c in COLUMNS})
+                for column in COLUMNS:
+                    table[column].append(group[column][()])
+
+    for celltype, table in tables.items():
+        columns = {c: np.concatenate(v) for c, v in table.items()}
+        order = np.argsort(columns["cellId"], kind="stable")
+        path = os.path.join(outdir, "{}.{}.csv".format(celltype, iteration))
+        with open(path, "w") as out:
+            out.write(",".join(COLUMNS) + "\n")
+            for row in order:
+                out.write(",".join(
+                    str(int(columns[c][row])) if c in INTEGER_COLUMNS
+                    else repr(float(columns[c][row])) for c in COLUMNS) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("output", help="HemoCell output directory (containing hdf5/)")
+    parser.add_argument("-o", "--csv-dir", help="Directory for the csv files (default: <output>/csv)")
+    parser.add_argument("-i", "--iteration", action="append", type=int,
+                        help="Only convert this iteration, may be repeated")
+    args = parser.parse_args()
+
+    outdir = args.csv_dir or os.path.join(args.output, "csv")
+    os.makedirs(outdir, exist_ok=True)
+
+    per_iteration = {}
+    pattern = re.compile(r"CellInfo\.(\d+)\.w\.\d+\.h5$")
+    for path in glob.glob(os.path.join(args.output, "hdf5", "*", "CellInfo.*.h5")):
+        match = pattern.search(path)
+        if match:
+            per_iteration.setdefault(match.group(1), []).append(path)
+
+    if not per_iteration:
+        sys.exit("No CellInfo.*.h5 files found in {}".format(os.path.join(args.output, "hdf5")))
+
+    for iteration, files in sorted(per_iteration.items()):
+        if args.iteration and int(iteration) not in args.iteration:
+            continue
+        convert_iteration(files, outdir, iteration)
+
+
+if __name__ == "__main__":
+    main()
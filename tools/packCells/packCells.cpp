@@ -46,6 +46,7 @@ void PrintHelp() {
           "  --noRotate                              Disallow rotation of ellipsoids\n"
           "  --scale <ratio>                      -s Scales the neighbourhood grid (only change this if you know what you are doing!)\n"
           "  --maxiter <n>                           Maximum number of iterations\n"
+          "  --binary                                Write the <Cell>.pos files in binary format\n"
           "  --help                                  Print this"
           "\n"
           "OUTPUT:\n"
@@ -81,6 +82,7 @@ const option long_opts[] = {
             {"scale",      1, nullptr, 7},
             {"maxiter",    1, nullptr, 8},
             {"help",       0, nullptr, 9},
+            {"binary",     0, nullptr, 15},
             {NULL, 0, 0, 0}
 };
 
@@ -108,6 +110,7 @@ int main(int argc, char *argv[])
   bool hematocrit_set = false;
   bool RBC_PLT_set = false;
   bool doRotate = true;
+  bool binary = false;
   vector<CellType> cellTypes;
   
   
@@ -178,6 +181,9 @@ int main(int argc, char *argv[])
       case(8):
         maxIter = atoi(optarg);
         break;
+      case(15):
+        binary = true;
+        break;
       case(9):
       case('?'):
       default:
@@ -266,7 +272,7 @@ int main(int argc, char *argv[])
 
   pack.execute();
 
-  pack.saveBloodCellPositions();
+  pack.saveBloodCellPositions(binary);
   
   //pack.savePov(povFileName.c_str(), sX, sY, sZ, wbcNumber);
 
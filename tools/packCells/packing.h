@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <cstdint>
 #include <cmath>
 
 #include <iomanip>
@@ -98,7 +99,7 @@ public:
   void initBlood(float sizeX, float sizeY, float sizeZ, int maxSteps, double sizing, vector<CellType> & ctypes);
   // void initSuspension(vector<int> nPartsPerComponent, vector<vector3> diametersPerComponent, vector<int> domainSize, double nominalPackingDensity, int maxSteps, double sizing);
   void savePov(const char * fileName, int wbcNumber);
-  void saveBloodCellPositions();
+  void saveBloodCellPositions(bool binary = false);
   void getOutput(vector<vector<vector3> > &positions, vector<vector<vector3> > &angles);
   void setRndRotation(bool rndRotation_) {rndRotation = rndRotation_;}
 };
@@ -614,17 +615,24 @@ void Packing::savePov(const char *fileName, int wbcNumber)
     povf.close();
 }
 
-void Packing::saveBloodCellPositions()
+void Packing::saveBloodCellPositions(bool binary)
 {
 	int speciesCounter = 0;
 
 	for (int j = 0; j < NumSpecies; j++){
 
-		ofstream cellsFile (species[j]->name + ".pos");
+		ofstream cellsFile (species[j]->name + ".pos", binary ? ios::out | ios::binary : ios::out);
 
 		//cellsFile << No_cells_x << " " << No_cells_y << " " << No_cells_z << endl; // Dimensions
 
-		cellsFile << species[j]->getNum() << endl; // Num. of cells of this type
+		if (binary) {
+			// "HCPOSBIN", the number of cells as uint64 and six doubles per cell
+			const uint64_t num = species[j]->getNum();
+			cellsFile.write("HCPOSBIN", 8);
+			cellsFile.write((const char *)&num, sizeof(num));
+		} else {
+			cellsFile << species[j]->getNum() << endl; // Num. of cells of this type
+		}
 
 		for(int i = speciesCounter; i < (speciesCounter+species[j]->getNum() ); i++)
 		{
@@ -635,6 +643,11 @@ void Packing::saveBloodCellPositions()
 			vector3 euler(atan2(Q(1,2),Q(2,2)), -asin(Q(0,2)), atan2(Q(0,1),Q(0,0)));
 			euler *= 180 / PI; //Rad to Deg
 
+			if (binary) {
+				const double values[6] = {pos[0], pos[1], pos[2], euler[0], euler[1], euler[2]};
+				cellsFile.write((const char *)values, sizeof(values));
+				continue;
+			}
 			//if(i < species[0]->getn())
 			cellsFile << pos[0] << " " << pos[1] << " " << pos[2] << " " << euler[0] << " " << euler[1] << " " << euler[2] << endl;
 			//else